@@ -0,0 +1,411 @@
+// End-to-end throughput benchmark for tplt.
+//
+// Generates synthetic delimited datasets, then times the reader (parse only),
+// the builder (binning pre-parsed points), the renderer and the whole
+// read-bin-render pipeline separately. By default every dataset is written
+// comma- and pipe-delimited, each with and without a header row. Results are printed one JSON object
+// per line so they can be collected and compared across releases.
+//
+// Usage: tplt_bench [--rows N] [--dist uniform,clustered,heavy]
+//                   [--columns 3,32] [--delimiters ",|"] [--header on,off]
+//                   [--threads N] [--grid WxH] [--dir PATH] [--keep]
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <charconv>
+#include <thread>
+#include <cstdio>
+#include <cmath>
+#include "heatmap_builder.hpp"
+#include "heatmap_renderer.hpp"
+#include "data_reader.hpp"
+
+using namespace tplt;
+
+namespace {
+
+enum class Distribution { Uniform, Clustered, HeavyTailed };
+
+const char* distribution_name(Distribution dist) {
+    switch (dist) {
+        case Distribution::Uniform: return "uniform";
+        case Distribution::Clustered: return "clustered";
+        default: return "heavy";
+    }
+}
+
+struct BenchConfig {
+    size_t rows = 1000000;
+    std::vector<Distribution> distributions = {
+        Distribution::Uniform, Distribution::Clustered, Distribution::HeavyTailed
+    };
+    std::vector<int> columns = {3, 32};
+    std::string delimiters = ",|";
+    std::vector<bool> headers = {true, false};
+    int threads = 0;
+    int grid_width = 200;
+    int grid_height = 100;
+    std::string dir = "/tmp";
+    bool keep = false;
+};
+
+// One dataset variant
+struct Dataset {
+    Distribution dist;
+    int columns;
+    char delimiter;
+    bool header;
+};
+
+// Draws (x, y, value) triples from a distribution
+class PointGenerator {
+private:
+    Distribution dist_;
+    std::mt19937_64 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1000.0};
+    std::normal_distribution<double> normal_{0.0, 1.0};
+    std::uniform_int_distribution<int> cluster_{0, 7};
+    std::lognormal_distribution<double> lognormal_{0.0, 1.5};
+
+public:
+    explicit PointGenerator(Distribution dist, uint64_t seed = 42) : dist_(dist), rng_(seed) {}
+
+    void next(double& x, double& y, double& v) {
+        switch (dist_) {
+            case Distribution::Uniform:
+                x = uniform_(rng_);
+                y = uniform_(rng_);
+                break;
+            case Distribution::Clustered: {
+                int c = cluster_(rng_);
+                x = 100.0 + 100.0 * c + 15.0 * normal_(rng_);
+                y = 500.0 + 300.0 * std::sin(c) + 15.0 * normal_(rng_);
+                break;
+            }
+            default:
+                x = lognormal_(rng_);
+                y = lognormal_(rng_);
+                break;
+        }
+        v = uniform_(rng_);
+    }
+};
+
+// Append value with fixed precision to buffer
+void append_number(std::string& buffer, double value) {
+    char text[64];
+    auto [end, ec] = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, 4);
+    buffer.append(text, end);
+}
+
+// Write a dataset file; returns its size in bytes
+size_t generate_file(const std::string& path, const Dataset& set, size_t rows) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+
+    std::string buffer;
+    size_t bytes = 0;
+
+    if (set.header) {
+        buffer += "x";
+        buffer += set.delimiter;
+        buffer += "y";
+        buffer += set.delimiter;
+        buffer += "value";
+        for (int c = 3; c < set.columns; ++c) {
+            buffer += set.delimiter;
+            buffer += "extra" + std::to_string(c);
+        }
+        buffer += '\n';
+    }
+
+    PointGenerator gen(set.dist);
+    std::mt19937_64 filler(7);
+    std::uniform_real_distribution<double> filler_value(0.0, 100.0);
+
+    for (size_t r = 0; r < rows; ++r) {
+        double x, y, v;
+        gen.next(x, y, v);
+        append_number(buffer, x);
+        buffer += set.delimiter;
+        append_number(buffer, y);
+        buffer += set.delimiter;
+        append_number(buffer, v);
+        for (int c = 3; c < set.columns; ++c) {
+            buffer += set.delimiter;
+            append_number(buffer, filler_value(filler));
+        }
+        buffer += '\n';
+
+        if (buffer.size() >= (1 << 22)) {
+            out.write(buffer.data(), buffer.size());
+            bytes += buffer.size();
+            buffer.clear();
+        }
+    }
+
+    out.write(buffer.data(), buffer.size());
+    bytes += buffer.size();
+    return bytes;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// c as the inside of a JSON string
+std::string json_char(char c) {
+    switch (c) {
+        case '"': return "\\\"";
+        case '\\': return "\\\\";
+        case '\t': return "\\t";
+        default: return std::string(1, c);
+    }
+}
+
+// Print one result line
+void report(const char* stage, const Dataset& set, size_t threads, size_t rows, size_t bytes, double seconds) {
+    std::ostringstream line;
+    line << "{\"stage\":\"" << stage << "\""
+         << ",\"dist\":\"" << distribution_name(set.dist) << "\""
+         << ",\"columns\":" << set.columns
+         << ",\"delimiter\":\"" << json_char(set.delimiter) << "\""
+         << ",\"header\":" << (set.header ? "true" : "false")
+         << ",\"threads\":" << threads
+         << ",\"rows\":" << rows
+         << ",\"bytes\":" << bytes
+         << ",\"seconds\":" << seconds
+         << ",\"rows_per_s\":" << (seconds > 0 ? rows / seconds : 0.0)
+         << ",\"mb_per_s\":" << (seconds > 0 ? bytes / seconds / 1e6 : 0.0)
+         << "}";
+    std::cout << line.str() << std::endl;
+}
+
+Options make_options(const Dataset& set) {
+    Options options;
+    options.command = CommandType::Heatmap;
+    options.delimiter = set.delimiter;
+    options.header_mode = set.header ? Options::HeaderMode::ForceOn : Options::HeaderMode::ForceOff;
+    options.x_field = FieldSpec(1);
+    options.y_field = FieldSpec(2);
+    options.aggregation.function = AggregationSpec::Function::Avg;
+    options.aggregation.field = FieldSpec(3);
+    return options;
+}
+
+void run_dataset(const BenchConfig& config, const Dataset& set) {
+    size_t threads = config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::string path = config.dir + "/tplt_bench_" + distribution_name(set.dist) + "_" +
+                       std::to_string(set.columns) + "_" + std::to_string(static_cast<int>(set.delimiter)) +
+                       (set.header ? "_h" : "") + ".txt";
+
+    size_t bytes = generate_file(path, set, config.rows);
+    Options options = make_options(set);
+    DataReader reader(set.delimiter);
+    MappedFile file(path);
+
+    // Reader: parse every row, keeping only a per-thread checksum
+    {
+        std::vector<double> sums(threads, 0.0);
+        std::vector<size_t> counts(threads, 0);
+        auto make_visitor = [&](size_t i) {
+            return [&sums, &counts, i](const DataPoint<double>& point) {
+                sums[i] += point.x + point.y;
+                counts[i]++;
+            };
+        };
+        std::vector<decltype(make_visitor(0))> visitors;
+        for (size_t i = 0; i < threads; ++i) visitors.push_back(make_visitor(i));
+
+        auto start = std::chrono::steady_clock::now();
+        reader.for_each_point_parallel<double>(file.view(), options, visitors);
+        double seconds = seconds_since(start);
+
+        size_t rows = 0;
+        for (size_t c : counts) rows += c;
+        report("reader", set, threads, rows, bytes, seconds);
+    }
+
+    // Bounds for the binners, from an untimed pass
+    PointBounds bounds;
+    reader.for_each_point<double>(file.view(), options, [&](const DataPoint<double>& point) {
+        bounds.add(point.x, point.y);
+    });
+
+    // Builder: bin points that are already in memory. Points are parsed into
+    // a fixed-size batch and only binning the full batch is timed, so memory
+    // stays bounded however many rows the dataset has.
+    Grid<double> heatmap;
+    {
+        constexpr size_t BATCH = 1 << 20;
+        std::vector<double> xs, ys, vs;
+        xs.reserve(BATCH);
+        ys.reserve(BATCH);
+        vs.reserve(BATCH);
+
+        HeatmapBinner<AvgAccumulator> binner(config.grid_width, config.grid_height,
+                                             bounds.min_x, bounds.max_x, bounds.min_y, bounds.max_y);
+        double seconds = 0;
+        size_t rows = 0;
+        auto bin_batch = [&] {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < xs.size(); ++i) {
+                binner.add(xs[i], ys[i], vs[i]);
+            }
+            seconds += seconds_since(start);
+            rows += xs.size();
+            xs.clear();
+            ys.clear();
+            vs.clear();
+        };
+
+        reader.for_each_point<double>(file.view(), options, [&](const DataPoint<double>& point) {
+            xs.push_back(point.x);
+            ys.push_back(point.y);
+            vs.push_back(point.value.value_or(0.0));
+            if (xs.size() == BATCH) bin_batch();
+        });
+        bin_batch();
+
+        auto start = std::chrono::steady_clock::now();
+        heatmap = binner.result();
+        seconds += seconds_since(start);
+        report("builder", set, 1, rows, rows * 3 * sizeof(double), seconds);
+    }
+
+    // Renderer: render the grid repeatedly into memory
+    {
+        const int iterations = 20;
+        size_t rendered = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            std::ostringstream out;
+            render_heatmap(heatmap, true, out);
+            rendered += out.str().size();
+        }
+        double seconds = seconds_since(start);
+        report("renderer", set, 1, heatmap.cells() * iterations, rendered, seconds);
+    }
+
+    // End to end: parallel parse and bin with known bounds, then render
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<HeatmapBinner<AvgAccumulator>> partials(
+            threads, HeatmapBinner<AvgAccumulator>(config.grid_width, config.grid_height,
+                                                   bounds.min_x, bounds.max_x, bounds.min_y, bounds.max_y));
+        auto make_visitor = [&](size_t i) {
+            return [&partials, i](const DataPoint<double>& point) {
+                if (point.value.has_value()) partials[i].add(point.x, point.y, *point.value);
+            };
+        };
+        std::vector<decltype(make_visitor(0))> visitors;
+        for (size_t i = 0; i < threads; ++i) visitors.push_back(make_visitor(i));
+
+        reader.for_each_point_parallel<double>(file.view(), options, visitors);
+        for (size_t i = 1; i < threads; ++i) partials[0].merge(partials[i]);
+
+        std::ostringstream out;
+        render_heatmap(partials[0].result(), true, out);
+        double seconds = seconds_since(start);
+        report("end_to_end", set, threads, partials[0].points(), bytes, seconds);
+    }
+
+    if (!config.keep) {
+        std::remove(path.c_str());
+    }
+}
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+BenchConfig parse_args(int argc, char* argv[]) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("Missing value after " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--rows") {
+            config.rows = std::stoull(value());
+        } else if (arg == "--dist") {
+            config.distributions.clear();
+            for (const auto& name : split_list(value())) {
+                if (name == "uniform") config.distributions.push_back(Distribution::Uniform);
+                else if (name == "clustered") config.distributions.push_back(Distribution::Clustered);
+                else if (name == "heavy") config.distributions.push_back(Distribution::HeavyTailed);
+                else throw std::runtime_error("Unknown distribution: " + name);
+            }
+        } else if (arg == "--columns") {
+            config.columns.clear();
+            for (const auto& n : split_list(value())) {
+                config.columns.push_back(std::max(3, std::stoi(n)));
+            }
+        } else if (arg == "--delimiters") {
+            config.delimiters = value();
+        } else if (arg == "--header") {
+            config.headers.clear();
+            for (const auto& mode : split_list(value())) {
+                config.headers.push_back(mode == "on");
+            }
+        } else if (arg == "--threads") {
+            config.threads = std::stoi(value());
+        } else if (arg == "--grid") {
+            std::string grid = value();
+            size_t x = grid.find('x');
+            if (x == std::string::npos) throw std::runtime_error("Invalid grid size: " + grid);
+            config.grid_width = std::stoi(grid.substr(0, x));
+            config.grid_height = std::stoi(grid.substr(x + 1));
+        } else if (arg == "--dir") {
+            config.dir = value();
+        } else if (arg == "--keep") {
+            config.keep = true;
+        } else {
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+
+    return config;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        BenchConfig config = parse_args(argc, argv);
+
+        for (Distribution dist : config.distributions) {
+            for (int columns : config.columns) {
+                for (char delimiter : config.delimiters) {
+                    for (bool header : config.headers) {
+                        run_dataset(config, Dataset{dist, columns, delimiter, header});
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::cerr << "Usage: tplt_bench [--rows N] [--dist uniform,clustered,heavy] [--columns 3,32]" << std::endl;
+        std::cerr << "                  [--delimiters \",|\"] [--header on,off] [--threads N]" << std::endl;
+        std::cerr << "                  [--grid WxH] [--dir PATH] [--keep]" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <concepts>
+#include "quantile_sketch.hpp"
+#include "hyperloglog.hpp"
+
+// Enum for aggregation functions
+enum class AggregateFunc {
+    Sum,        // Sum of all values
+    Avg,        // Average of all values
+    Count,      // Number of values (default)
+    Min,        // Smallest value
+    Max,        // Largest value
+    Variance,   // Population variance of the values
+    Stddev,     // Population standard deviation of the values
+    Quantile,   // Approximate quantile of the values (e.g. the median)
+    Distinct    // Approximate number of distinct keys
+};
+
+// What an accumulator's add() takes: a number, unless the accumulator
+// declares its own Input (distinct counts take 64-bit keys)
+template<typename A>
+struct accumulator_input {
+    using type = double;
+};
+
+template<typename A>
+    requires requires { typename A::Input; }
+struct accumulator_input<A> {
+    using type = typename A::Input;
+};
+
+template<typename A>
+using accumulator_input_t = typename accumulator_input<A>::type;
+
+// Per-cell aggregation. An accumulator describes how a cell's State starts
+// (init), absorbs one value (add), absorbs another cell built the same way
+// (merge) and turns into the rendered number (finalize). merge must be exact:
+// binning a set of rows in pieces and merging the pieces gives the same state
+// as binning them in one go, which is what lets partial grids from threads,
+// time slices or files be combined. Accumulators are small value types; any
+// parameters (such as a quantile) live in the accumulator, not in each cell.
+template<typename A>
+concept Accumulator = requires(const A& acc, typename A::State& state,
+                               const typename A::State& other, accumulator_input_t<A> v) {
+    typename A::Result;
+    { acc.init() } -> std::convertible_to<typename A::State>;
+    acc.add(state, v);
+    acc.merge(state, other);
+    { acc.finalize(other) } -> std::convertible_to<typename A::Result>;
+};
+
+// Accumulators whose state can be divided between cells in proportion to the
+// rows each gets, as when a coarse cell is spread over the finer cells it
+// overlaps. split(state, from, to) is the part of state standing for the
+// fraction [from, to) of its rows; the parts for consecutive ranges covering
+// [0, 1) merge back into the whole state.
+template<typename A>
+concept SplittableAccumulator = Accumulator<A> &&
+    requires(const A& acc, const typename A::State& state, double f) {
+        { acc.split(state, f, f) } -> std::convertible_to<typename A::State>;
+    };
+
+// Whole-row share of count for the fraction [from, to), rounded so the
+// shares of consecutive ranges add up to count exactly
+inline uint64_t split_count(uint64_t count, double from, double to) {
+    double n = static_cast<double>(count);
+    return static_cast<uint64_t>(std::llround(to * n) - std::llround(from * n));
+}
+
+// Number of values; add() ignores the value itself
+struct CountAccumulator {
+    using State = uint64_t;
+    using Result = int64_t;
+
+    State init() const { return 0; }
+    void add(State& state, double) const { state++; }
+    void merge(State& state, const State& other) const { state += other; }
+    Result finalize(const State& state) const { return static_cast<Result>(state); }
+    State split(const State& state, double from, double to) const { return split_count(state, from, to); }
+};
+
+struct SumAccumulator {
+    using State = double;
+    using Result = double;
+
+    State init() const { return 0.0; }
+    void add(State& state, double v) const { state += v; }
+    void merge(State& state, const State& other) const { state += other; }
+    Result finalize(const State& state) const { return state; }
+    State split(const State& state, double from, double to) const { return state * (to - from); }
+};
+
+// Sum and count kept side by side, divided only at the end
+struct AvgAccumulator {
+    struct State {
+        double sum = 0.0;
+        uint64_t count = 0;
+    };
+    using Result = double;
+
+    State init() const { return {}; }
+
+    void add(State& state, double v) const {
+        state.sum += v;
+        state.count++;
+    }
+
+    void merge(State& state, const State& other) const {
+        state.sum += other.sum;
+        state.count += other.count;
+    }
+
+    Result finalize(const State& state) const {
+        return state.count > 0 ? state.sum / state.count : 0.0;
+    }
+
+    // Every part keeps the mean of the whole
+    State split(const State& state, double from, double to) const {
+        State part;
+        part.count = split_count(state.count, from, to);
+        part.sum = state.count > 0 ? state.sum * part.count / state.count : 0.0;
+        return part;
+    }
+};
+
+// Smallest value; empty cells finalize to 0 like every other aggregate
+struct MinAccumulator {
+    using State = double;
+    using Result = double;
+
+    State init() const { return std::numeric_limits<double>::infinity(); }
+    void add(State& state, double v) const { state = std::min(state, v); }
+    void merge(State& state, const State& other) const { state = std::min(state, other); }
+    Result finalize(const State& state) const { return std::isinf(state) && state > 0 ? 0.0 : state; }
+};
+
+// Largest value; empty cells finalize to 0
+struct MaxAccumulator {
+    using State = double;
+    using Result = double;
+
+    State init() const { return -std::numeric_limits<double>::infinity(); }
+    void add(State& state, double v) const { state = std::max(state, v); }
+    void merge(State& state, const State& other) const { state = std::max(state, other); }
+    Result finalize(const State& state) const { return std::isinf(state) && state < 0 ? 0.0 : state; }
+};
+
+// Population variance in one pass: Welford's update per value, and Chan et
+// al.'s pairwise formula to merge, which avoids the cancellation of the naive
+// sum-of-squares approach on values with a large mean
+struct VarianceAccumulator {
+    struct State {
+        uint64_t count = 0;
+        double mean = 0.0;
+        double m2 = 0.0;    // Sum of squared deviations from the mean
+    };
+    using Result = double;
+
+    State init() const { return {}; }
+
+    void add(State& state, double v) const {
+        state.count++;
+        double delta = v - state.mean;
+        state.mean += delta / state.count;
+        state.m2 += delta * (v - state.mean);
+    }
+
+    void merge(State& state, const State& other) const {
+        if (other.count == 0) return;
+        if (state.count == 0) {
+            state = other;
+            return;
+        }
+        double n_a = static_cast<double>(state.count);
+        double n_b = static_cast<double>(other.count);
+        double n = n_a + n_b;
+        double delta = other.mean - state.mean;
+        state.mean += delta * n_b / n;
+        state.m2 += other.m2 + delta * delta * n_a * n_b / n;
+        state.count += other.count;
+    }
+
+    Result finalize(const State& state) const {
+        return state.count > 0 ? state.m2 / state.count : 0.0;
+    }
+};
+
+struct StddevAccumulator : VarianceAccumulator {
+    Result finalize(const State& state) const {
+        return std::sqrt(VarianceAccumulator::finalize(state));
+    }
+};
+
+// Approximate quantile q per cell from a bounded-size sketch, accurate to
+// QuantileSketch::RELATIVE_ACCURACY of the true value
+struct QuantileAccumulator {
+    using State = QuantileSketch;
+    using Result = double;
+
+    double q = 0.5;
+
+    State init() const { return {}; }
+    void add(State& state, double v) const { state.add(v); }
+    void merge(State& state, const State& other) const { state.merge(other); }
+    Result finalize(const State& state) const { return state.empty() ? 0.0 : state.quantile(q); }
+};
+
+// Approximate distinct count of keys per cell (HyperLogLog, ~1.6% error).
+// Keys are identities rather than numbers: the reader derives them from the
+// field text, or from the value for numeric fields, so 1 and 1.0 are the same.
+struct DistinctAccumulator {
+    using State = HyperLogLog;
+    using Input = uint64_t;
+    using Result = int64_t;
+
+    State init() const { return {}; }
+    void add(State& state, uint64_t key) const { state.add_hash(mix64(key)); }
+    void merge(State& state, const State& other) const { state.merge(other); }
+    Result finalize(const State& state) const { return std::llround(state.estimate()); }
+};
+
+// Accumulators whose result grows in proportion to the rows in a cell, so a
+// sample's result times the rows each sampled row stands for estimates the
+// whole input's. Means, extremes, spreads and quantiles need no scaling;
+// distinct counts don't scale linearly and are left as sampled.
+template<typename A>
+inline constexpr bool scales_with_rows = std::same_as<A, CountAccumulator> || std::same_as<A, SumAccumulator>;
+
+// Call f with the accumulator implementing func (quantile is only used by
+// Quantile). Every binner is templated on its accumulator, so this is the one
+// place the runtime choice is made; f must return the same type for every
+// accumulator.
+template<typename F>
+decltype(auto) with_accumulator(AggregateFunc func, F&& f, double quantile = 0.5) {
+    switch (func) {
+        case AggregateFunc::Quantile: return f(QuantileAccumulator{quantile});
+        case AggregateFunc::Distinct: return f(DistinctAccumulator{});
+        case AggregateFunc::Sum: return f(SumAccumulator{});
+        case AggregateFunc::Avg: return f(AvgAccumulator{});
+        case AggregateFunc::Min: return f(MinAccumulator{});
+        case AggregateFunc::Max: return f(MaxAccumulator{});
+        case AggregateFunc::Variance: return f(VarianceAccumulator{});
+        case AggregateFunc::Stddev: return f(StddevAccumulator{});
+        default: return f(CountAccumulator{});
+    }
+}
@@ -6,15 +6,22 @@
 #include <optional>
 #include <stdexcept>
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <regex>
+#include <string_view>
+#include "number_parser.hpp"
 
 namespace tplt {
 
 // Supported command types
 enum class CommandType {
     Heatmap,    // Generate a heatmap
+    Convert,    // Write the input as a columnar table
+    Merge,      // Combine grid files written by --emit-grid
+    View,       // Render a pyramid written by --pyramid
     Unknown     // Unknown command
 };
 
@@ -45,12 +52,19 @@ struct FieldSpec {
 struct AggregationSpec {
     enum class Function {
         Count,  // Count occurrences (default)
-        Sum,    // Sum values
-        Avg     // Average values
+        Sum,        // Sum values
+        Avg,        // Average values
+        Min,        // Smallest value
+        Max,        // Largest value
+        Variance,   // Population variance
+        Stddev,     // Population standard deviation
+        Quantile,   // Approximate quantile, written pNN (p50, p99, p99.9)
+        Distinct    // Approximate count of distinct values (text or numbers)
     };
     
     Function function = Function::Count;
-    std::optional<FieldSpec> field;  // Empty for count, populated for sum/avg
+    double quantile = 0.5;           // For Quantile: the fraction NN/100
+    std::optional<FieldSpec> field;  // Empty for count, populated for the other functions
     
     // Constructors
     AggregationSpec() = default;
@@ -59,7 +73,7 @@ struct AggregationSpec {
         AggregationSpec result;
         
         // Check if we have a function specification
-        std::regex func_regex("(count|sum|avg)\\((.+)\\)", std::regex::icase);
+        std::regex func_regex("(count|sum|avg|min|max|var|stddev|distinct|p\\d+(?:\\.\\d+)?)\\((.+)\\)", std::regex::icase);
         std::smatch match;
         
         if (std::regex_match(spec, match, func_regex)) {
@@ -73,6 +87,24 @@ struct AggregationSpec {
                 result.function = Function::Sum;
             } else if (func == "avg") {
                 result.function = Function::Avg;
+            } else if (func == "min") {
+                result.function = Function::Min;
+            } else if (func == "max") {
+                result.function = Function::Max;
+            } else if (func == "var") {
+                result.function = Function::Variance;
+            } else if (func == "stddev") {
+                result.function = Function::Stddev;
+            } else if (func == "distinct") {
+                result.function = Function::Distinct;
+            } else if (func[0] == 'p') {
+                double percent = 0;
+                parse_double(std::string_view(func).substr(1), percent);
+                if (percent > 100) {
+                    throw std::runtime_error("Quantile out of range: " + func);
+                }
+                result.function = Function::Quantile;
+                result.quantile = percent / 100;
             } else {
                 result.function = Function::Count;
             }
@@ -87,13 +119,71 @@ struct AggregationSpec {
     }
 };
 
+// Closed value range [min, max] for an axis
+struct AxisRange {
+    double min = 0.0;
+    double max = 0.0;
+    
+    // Parse "min:max"
+    static AxisRange parse(const std::string& spec) {
+        size_t colon = spec.find(':', 1);  // Skip a leading minus sign
+        if (colon == std::string::npos) {
+            throw std::runtime_error("Invalid range '" + spec + "', expected min:max");
+        }
+        
+        AxisRange range;
+        std::string_view text(spec);
+        if (parse_double(text.substr(0, colon), range.min) != std::errc{} ||
+            parse_double(text.substr(colon + 1), range.max) != std::errc{}) {
+            throw std::runtime_error("Invalid range '" + spec + "', expected min:max");
+        }
+        
+        if (!(range.min < range.max)) {
+            throw std::runtime_error("Invalid range '" + spec + "', min must be below max");
+        }
+        return range;
+    }
+    
+    bool contains(double v) const {
+        return v >= min && v <= max;
+    }
+};
+
 // Program options
 struct Options {
+    static constexpr int MAX_CELLS = 1 << 16;  // Per axis, as in grid files
+    
     CommandType command = CommandType::Unknown;
     char delimiter = ' ';
+    std::string input_path;  // Empty (or "-") reads stdin
     FieldSpec x_field;
     FieldSpec y_field;
     AggregationSpec aggregation;
+    std::optional<AxisRange> x_range;  // Fixed x bounds; points outside are dropped
+    std::optional<AxisRange> y_range;  // Fixed y bounds; points outside are dropped
+    int threads = 0;                   // Parser threads for file input (0 = one per core)
+    bool stats = false;                // Print timings and row accounting to stderr
+    bool follow = false;               // Redraw the map while the input streams in
+    double refresh = 1.0;              // Seconds between redraws in follow mode
+    std::optional<FieldSpec> time_field;  // Time column for the sliding window
+    double window = 0;                 // Window length in time units (0 = no window)
+    int slices = 12;                   // Sub-grids the window is split into
+    double sample = 1.0;               // Share of rows kept by Bernoulli sampling
+    uint64_t max_rows = 0;             // Read only the first rows (0 = all)
+    uint64_t reservoir = 0;            // Keep a uniform sample of this many rows (0 = off)
+    uint64_t seed = 1;                 // Seed for --sample and --reservoir
+    bool sample_error = false;         // Show each cell's relative error under sampling
+    bool cache = false;                // Keep parsed columns in a sidecar for later runs
+    std::string cache_dir;             // Where sidecars go (empty = next to the input)
+    std::string output_path;           // convert: destination ("-" for stdout)
+    std::vector<FieldSpec> columns;    // convert: fields to keep (empty = all)
+    std::string emit_grid;             // Write the aggregated grid here instead of rendering
+    std::vector<std::string> grid_paths;  // merge: grid files to combine
+    int width = 20;                    // Rendered heatmap size in characters (0 = fit the terminal)
+    int height = 10;
+    std::string pyramid;               // heatmap: write a pyramid here; view: read it
+    int base_width = 512;              // Pyramid base or --pool grid size in cells
+    int base_height = 256;
     
     enum class HeaderMode {
         Auto,       // Automatically detect header (default)
@@ -103,6 +193,42 @@ struct Options {
     
     HeaderMode header_mode = HeaderMode::Auto;
     
+    enum class Glyphs {
+        Block,      // One cell per character in shades (default)
+        Half,       // Two cells per character in half blocks
+        Braille     // Eight cells per character in braille dots
+    };
+    
+    Glyphs glyphs = Glyphs::Block;
+    
+    enum class Colors {
+        None,       // Shades and dots only (default)
+        Gray,
+        Viridis,
+        Magma
+    };
+    
+    Colors colors = Colors::None;
+    
+    enum class Pool {
+        None,       // Aggregate at the display size (default)
+        Sum,
+        Max,
+        Mean
+    };
+    
+    Pool pool = Pool::None;            // Aggregate at --base size and pool down to the display
+    
+    enum class Scale {
+        Linear,     // Intensity proportional to the value (default)
+        Log,
+        Sqrt,
+        Quantile    // Equal numbers of cells per shade
+    };
+    
+    Scale scale = Scale::Linear;
+    bool truecolor = false;            // 24-bit colors instead of the 256-color palette
+    
     // Parse command line arguments
     static Options parse(int argc, char* argv[]) {
         Options opts;
@@ -129,6 +255,200 @@ struct Options {
                 } else {
                     throw std::runtime_error("Missing delimiter after -d");
                 }
+            } else if (arg == "-i" || arg == "--input") {
+                if (arg_index + 1 < argc) {
+                    opts.input_path = argv[++arg_index];
+                    if (opts.input_path == "-") {
+                        opts.input_path.clear();
+                    }
+                } else {
+                    throw std::runtime_error("Missing file path after " + arg);
+                }
+            } else if (arg == "--xrange" || arg == "--yrange") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing min:max after " + arg);
+                }
+                AxisRange range = AxisRange::parse(argv[++arg_index]);
+                (arg == "--xrange" ? opts.x_range : opts.y_range) = range;
+            } else if (arg == "-j" || arg == "--threads") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing thread count after " + arg);
+                }
+                try {
+                    opts.threads = std::stoi(argv[++arg_index]);
+                } catch (const std::exception&) {
+                    throw std::runtime_error("Invalid thread count: " + std::string(argv[arg_index]));
+                }
+                if (opts.threads < 0) {
+                    throw std::runtime_error("Invalid thread count: " + std::string(argv[arg_index]));
+                }
+            } else if (arg == "--follow") {
+                opts.follow = true;
+            } else if (arg == "--refresh") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing seconds after " + arg);
+                }
+                std::string_view text = argv[++arg_index];
+                if (parse_double(text, opts.refresh) != std::errc{} || !(opts.refresh > 0)) {
+                    throw std::runtime_error("Invalid refresh interval: " + std::string(text));
+                }
+            } else if (arg == "--time") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing field after " + arg);
+                }
+                opts.time_field = FieldSpec(std::string(argv[++arg_index]));
+            } else if (arg == "--window") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing length after " + arg);
+                }
+                std::string_view text = argv[++arg_index];
+                if (parse_double(text, opts.window) != std::errc{} || !(opts.window > 0)) {
+                    throw std::runtime_error("Invalid window length: " + std::string(text));
+                }
+            } else if (arg == "--slices") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing slice count after " + arg);
+                }
+                try {
+                    opts.slices = std::stoi(argv[++arg_index]);
+                } catch (const std::exception&) {
+                    opts.slices = 0;
+                }
+                if (opts.slices < 1) {
+                    throw std::runtime_error("Invalid slice count: " + std::string(argv[arg_index]));
+                }
+            } else if (arg == "--sample") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing rate after " + arg);
+                }
+                std::string_view text = argv[++arg_index];
+                if (parse_double(text, opts.sample) != std::errc{} || !(opts.sample > 0 && opts.sample <= 1)) {
+                    throw std::runtime_error("Invalid sample rate: " + std::string(text) + " (expected 0 < rate <= 1)");
+                }
+            } else if (arg == "--max-rows" || arg == "--reservoir" || arg == "--seed") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing number after " + arg);
+                }
+                std::string_view text = argv[++arg_index];
+                uint64_t number = 0;
+                auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), number);
+                if (ec != std::errc{} || end != text.data() + text.size() || (number == 0 && arg != "--seed")) {
+                    throw std::runtime_error("Invalid " + arg.substr(2) + ": " + std::string(text));
+                }
+                (arg == "--max-rows" ? opts.max_rows : arg == "--reservoir" ? opts.reservoir : opts.seed) = number;
+            } else if (arg == "--error") {
+                opts.sample_error = true;
+            } else if (arg == "--cache") {
+                opts.cache = true;
+            } else if (arg == "--cache-dir") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing directory after " + arg);
+                }
+                opts.cache = true;
+                opts.cache_dir = argv[++arg_index];
+            } else if (arg == "--emit-grid") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing file path after " + arg);
+                }
+                opts.emit_grid = argv[++arg_index];
+            } else if (arg == "--width" || arg == "--height") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing cell count after " + arg);
+                }
+                std::string value = argv[++arg_index];
+                int cells = 0;  // "auto": fit the terminal
+                if (value != "auto") {
+                    try {
+                        cells = std::stoi(value);
+                    } catch (const std::exception&) {
+                    }
+                    if (cells < 1 || cells > MAX_CELLS) {
+                        throw std::runtime_error("Invalid " + arg.substr(2) + ": " + value);
+                    }
+                }
+                (arg == "--width" ? opts.width : opts.height) = cells;
+            } else if (arg == "--glyphs") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing glyph style after " + arg);
+                }
+                std::string style = argv[++arg_index];
+                if (style == "block") {
+                    opts.glyphs = Glyphs::Block;
+                } else if (style == "half") {
+                    opts.glyphs = Glyphs::Half;
+                } else if (style == "braille") {
+                    opts.glyphs = Glyphs::Braille;
+                } else {
+                    throw std::runtime_error("Unknown glyph style: " + style + " (expected block, half or braille)");
+                }
+            } else if (arg == "--color") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing palette after " + arg);
+                }
+                std::string palette = argv[++arg_index];
+                if (palette == "viridis") {
+                    opts.colors = Colors::Viridis;
+                } else if (palette == "magma") {
+                    opts.colors = Colors::Magma;
+                } else if (palette == "gray") {
+                    opts.colors = Colors::Gray;
+                } else {
+                    throw std::runtime_error("Unknown palette: " + palette + " (expected viridis, magma or gray)");
+                }
+            } else if (arg == "--pool") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing pool mode after " + arg);
+                }
+                std::string mode = argv[++arg_index];
+                if (mode == "sum") {
+                    opts.pool = Pool::Sum;
+                } else if (mode == "max") {
+                    opts.pool = Pool::Max;
+                } else if (mode == "mean") {
+                    opts.pool = Pool::Mean;
+                } else {
+                    throw std::runtime_error("Unknown pool mode: " + mode + " (expected sum, max or mean)");
+                }
+            } else if (arg == "--scale") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing scale after " + arg);
+                }
+                std::string scale = argv[++arg_index];
+                if (scale == "linear") {
+                    opts.scale = Scale::Linear;
+                } else if (scale == "log") {
+                    opts.scale = Scale::Log;
+                } else if (scale == "sqrt") {
+                    opts.scale = Scale::Sqrt;
+                } else if (scale == "quantile") {
+                    opts.scale = Scale::Quantile;
+                } else {
+                    throw std::runtime_error("Unknown scale: " + scale + " (expected linear, log, sqrt or quantile)");
+                }
+            } else if (arg == "--truecolor") {
+                opts.truecolor = true;
+            } else if (arg == "--pyramid") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing file path after " + arg);
+                }
+                opts.pyramid = argv[++arg_index];
+            } else if (arg == "--base") {
+                if (arg_index + 1 >= argc) {
+                    throw std::runtime_error("Missing <width>x<height> after " + arg);
+                }
+                std::string_view spec = argv[++arg_index];
+                auto cells = [](std::string_view text, int& out) {
+                    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+                    return ec == std::errc{} && end == text.data() + text.size() && out >= 2 && out <= MAX_CELLS;
+                };
+                size_t x = spec.find('x');
+                if (x == std::string_view::npos || !cells(spec.substr(0, x), opts.base_width) ||
+                    !cells(spec.substr(x + 1), opts.base_height)) {
+                    throw std::runtime_error("Invalid pyramid base '" + std::string(spec) +
+                                             "', expected <width>x<height> of at least 2x2");
+                }
+            } else if (arg == "--stats") {
+                opts.stats = true;
             } else if (arg == "--header") {
                 opts.header_mode = HeaderMode::ForceOn;
             } else if (arg == "--no-header") {
@@ -145,6 +465,12 @@ struct Options {
             std::string cmd = argv[arg_index++];
             if (cmd == "heatmap") {
                 opts.command = CommandType::Heatmap;
+            } else if (cmd == "convert") {
+                opts.command = CommandType::Convert;
+            } else if (cmd == "merge") {
+                opts.command = CommandType::Merge;
+            } else if (cmd == "view") {
+                opts.command = CommandType::View;
             } else {
                 throw std::runtime_error("Unknown command: " + cmd);
             }
@@ -152,6 +478,61 @@ struct Options {
             throw std::runtime_error("No command specified");
         }
         
+        // A window needs a time column and fixed bounds shared by all its slices
+        if (opts.window > 0 || opts.time_field) {
+            if (!opts.time_field || !(opts.window > 0)) {
+                throw std::runtime_error("--window and --time must be given together");
+            }
+            if (!opts.x_range || !opts.y_range) {
+                throw std::runtime_error("--window requires --xrange and --yrange");
+            }
+        }
+        
+        // The cache is keyed by a file's identity and rereads it on a miss
+        if (opts.cache && opts.input_path.empty()) {
+            throw std::runtime_error("--cache requires -i <file>");
+        }
+        if (opts.cache && opts.follow) {
+            throw std::runtime_error("--cache can't be combined with --follow");
+        }
+        if (!opts.emit_grid.empty() && opts.follow) {
+            throw std::runtime_error("--emit-grid can't be combined with --follow");
+        }
+        int sub_x = opts.glyphs == Glyphs::Braille ? 2 : 1;
+        int sub_y = opts.glyphs == Glyphs::Braille ? 4 : opts.glyphs == Glyphs::Half ? 2 : 1;
+        if (opts.width > MAX_CELLS / sub_x || opts.height > MAX_CELLS / sub_y) {
+            throw std::runtime_error("--width/--height too large for the glyph style");
+        }
+        if (opts.pool != Pool::None && opts.command == CommandType::Heatmap &&
+            (!opts.pyramid.empty() || !opts.emit_grid.empty())) {
+            throw std::runtime_error("--pool only applies when rendering; drop --pyramid/--emit-grid");
+        }
+        int sampling = (opts.sample < 1) + (opts.max_rows > 0) + (opts.reservoir > 0);
+        if (sampling > 1) {
+            throw std::runtime_error("Pick one of --sample, --max-rows and --reservoir");
+        }
+        if (opts.reservoir > 0 && (opts.follow || opts.window > 0)) {
+            throw std::runtime_error("--reservoir can't be combined with --follow or --window");
+        }
+        // Grid files and pyramids hold unscaled states
+        if ((opts.sample < 1 || opts.reservoir > 0) && (!opts.emit_grid.empty() || !opts.pyramid.empty())) {
+            throw std::runtime_error("--sample/--reservoir can't be combined with --emit-grid or --pyramid");
+        }
+        if (opts.sample_error && opts.sample == 1 && opts.reservoir == 0) {
+            throw std::runtime_error("--error requires --sample or --reservoir");
+        }
+        if (opts.truecolor && opts.colors == Colors::None) {
+            throw std::runtime_error("--truecolor requires --color <palette>");
+        }
+        if (!opts.pyramid.empty() && opts.command == CommandType::Heatmap) {
+            if (opts.follow) {
+                throw std::runtime_error("--pyramid can't be combined with --follow");
+            }
+            if (!opts.emit_grid.empty()) {
+                throw std::runtime_error("--pyramid can't be combined with --emit-grid");
+            }
+        }
+        
         // Parse fields based on command
         if (opts.command == CommandType::Heatmap) {
             // Heatmap needs x and y fields, with optional aggregation
@@ -183,14 +564,81 @@ struct Options {
                 // Default to field 2 if not specified
                 opts.y_field = FieldSpec(2);
             }
+        } else if (opts.command == CommandType::Convert) {
+            // Destination, then optionally the fields to keep
+            if (arg_index >= argc) {
+                throw std::runtime_error("Missing output path after convert");
+            }
+            opts.output_path = argv[arg_index++];
+            while (arg_index < argc) {
+                opts.columns.emplace_back(std::string(argv[arg_index++]));
+            }
+        } else if (opts.command == CommandType::Merge) {
+            while (arg_index < argc) {
+                opts.grid_paths.emplace_back(argv[arg_index++]);
+            }
+            if (opts.grid_paths.empty()) {
+                throw std::runtime_error("merge needs at least one grid file");
+            }
+        } else if (opts.command == CommandType::View) {
+            // The pyramid; --xrange/--yrange pick the region to show
+            if (arg_index >= argc) {
+                throw std::runtime_error("Missing pyramid path after view");
+            }
+            opts.pyramid = argv[arg_index++];
+            if (!opts.emit_grid.empty()) {
+                throw std::runtime_error("view renders; --emit-grid isn't supported");
+            }
+        }
+        if (opts.sample_error && opts.aggregation.function != AggregationSpec::Function::Count) {
+            throw std::runtime_error("--error estimates errors of counts; drop the aggregation");
         }
         
         return opts;
     }
     
     void print() const {
-        std::cout << "Command: " << (command == CommandType::Heatmap ? "heatmap" : "unknown") << std::endl;
+        std::cout << "Command: " << (command == CommandType::Heatmap ? "heatmap" :
+                                     command == CommandType::Convert ? "convert" :
+                                     command == CommandType::Merge ? "merge" :
+                                     command == CommandType::View ? "view" : "unknown") << std::endl;
         std::cout << "Delimiter: '" << delimiter << "'" << std::endl;
+        std::cout << "Input: " << (input_path.empty() ? "stdin" : input_path) << std::endl;
+        if (cache) {
+            std::cout << "Column cache: " << (cache_dir.empty() ? "next to input" : cache_dir) << std::endl;
+        }
+        if (!emit_grid.empty()) {
+            std::cout << "Grid output: " << (emit_grid == "-" ? "stdout" : emit_grid) << std::endl;
+        }
+        if (!pyramid.empty()) {
+            std::cout << "Pyramid: " << pyramid;
+            if (command == CommandType::Heatmap) std::cout << " (base " << base_width << "x" << base_height << ")";
+            std::cout << std::endl;
+        }
+        std::cout << "Size: " << (width > 0 ? std::to_string(width) : "auto") << "x"
+                  << (height > 0 ? std::to_string(height) : "auto") << " characters of "
+                  << (glyphs == Glyphs::Braille ? "braille" : glyphs == Glyphs::Half ? "half blocks" : "blocks") << std::endl;
+        if (sample < 1) {
+            std::cout << "Sample: " << sample * 100 << "% of rows" << std::endl;
+        } else if (max_rows > 0) {
+            std::cout << "Rows: first " << max_rows << std::endl;
+        } else if (reservoir > 0) {
+            std::cout << "Sample: " << reservoir << " rows (reservoir)" << std::endl;
+        }
+        if (scale != Scale::Linear) {
+            std::cout << "Scale: " << (scale == Scale::Log ? "log" : scale == Scale::Sqrt ? "sqrt" : "quantile") << std::endl;
+        }
+        if (pool != Pool::None) {
+            std::cout << "Pooling: " << (pool == Pool::Sum ? "sum" : pool == Pool::Max ? "max" : "mean") << " of a "
+                      << base_width << "x" << base_height << " grid" << std::endl;
+        }
+        if (colors != Colors::None) {
+            std::cout << "Colors: " << (colors == Colors::Viridis ? "viridis" : colors == Colors::Magma ? "magma" : "gray")
+                      << (truecolor ? " (24-bit)" : " (256 colors)") << std::endl;
+        }
+        if (command == CommandType::Convert) {
+            std::cout << "Output: " << (output_path == "-" ? "stdout" : output_path) << std::endl;
+        }
         
         std::cout << "Header mode: ";
         switch (header_mode) {
@@ -219,6 +667,18 @@ struct Options {
             std::cout << "name " << y_field.name << std::endl;
         }
         
+        if (x_range) {
+            std::cout << "X range: [" << x_range->min << "; " << x_range->max << "]" << std::endl;
+        }
+        if (y_range) {
+            std::cout << "Y range: [" << y_range->min << "; " << y_range->max << "]" << std::endl;
+        }
+        if (time_field) {
+            std::cout << "Window: " << window << " over "
+                      << (time_field->is_index ? "index " + std::to_string(time_field->index) : "name " + time_field->name)
+                      << " in " << slices << " slices" << std::endl;
+        }
+        
         std::cout << "Aggregation: ";
         switch (aggregation.function) {
             case AggregationSpec::Function::Count:
@@ -230,6 +690,24 @@ struct Options {
             case AggregationSpec::Function::Avg:
                 std::cout << "avg";
                 break;
+            case AggregationSpec::Function::Min:
+                std::cout << "min";
+                break;
+            case AggregationSpec::Function::Max:
+                std::cout << "max";
+                break;
+            case AggregationSpec::Function::Variance:
+                std::cout << "var";
+                break;
+            case AggregationSpec::Function::Stddev:
+                std::cout << "stddev";
+                break;
+            case AggregationSpec::Function::Quantile:
+                std::cout << "p" << aggregation.quantile * 100;
+                break;
+            case AggregationSpec::Function::Distinct:
+                std::cout << "distinct";
+                break;
         }
         
         if (aggregation.field.has_value()) {
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+
+// Native-endian binary encoding of plain values, used to serialize
+// accumulator states. Readers consume from the front of a string_view.
+
+template<typename T>
+void put_bytes(std::string& out, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+T take_bytes(std::string_view& in) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    if (in.size() < sizeof(T)) {
+        throw std::runtime_error("Truncated binary data");
+    }
+    T value;
+    std::memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return value;
+}
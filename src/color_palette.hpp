@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <stdexcept>
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+
+// Color maps for the renderer and their ANSI escape parameters. A palette is
+// sampled at LEVELS evenly spaced points once, and each level's foreground
+// and background SGR parameters are formatted then, so rendering a cell is a
+// table lookup and copying a few bytes.
+
+enum class Palette {
+    None,       // No color: shades and dots only
+    Gray,
+    Viridis,
+    Magma
+};
+
+enum class ColorDepth {
+    Ansi256,    // xterm 256-color: 6x6x6 cube plus 24 grays
+    TrueColor   // 24-bit RGB
+};
+
+struct Rgb {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+};
+
+namespace color_palette_detail {
+    // Matplotlib's maps at nine evenly spaced stops, interpolated linearly
+    inline constexpr std::array<Rgb, 9> VIRIDIS = {{
+        {68, 1, 84}, {71, 44, 122}, {59, 81, 139}, {44, 113, 142}, {33, 144, 141},
+        {39, 173, 129}, {92, 200, 99}, {170, 220, 50}, {253, 231, 37}}};
+    inline constexpr std::array<Rgb, 9> MAGMA = {{
+        {0, 0, 4}, {28, 16, 68}, {79, 18, 123}, {129, 37, 129}, {181, 54, 122},
+        {229, 80, 100}, {251, 135, 97}, {254, 194, 135}, {252, 253, 191}}};
+    inline constexpr std::array<Rgb, 2> GRAY = {{{24, 24, 24}, {255, 255, 255}}};
+
+    template<size_t N>
+    Rgb interpolate(const std::array<Rgb, N>& stops, double t) {
+        double at = std::clamp(t, 0.0, 1.0) * (N - 1);
+        size_t i = std::min(static_cast<size_t>(at), N - 2);
+        double f = at - i;
+        auto mix = [f](uint8_t a, uint8_t b) {
+            return static_cast<uint8_t>(a + (b - a) * f + 0.5);
+        };
+        return {mix(stops[i].r, stops[i + 1].r), mix(stops[i].g, stops[i + 1].g), mix(stops[i].b, stops[i + 1].b)};
+    }
+
+    inline int distance(Rgb a, Rgb b) {
+        int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+        return dr * dr + dg * dg + db * db;
+    }
+
+    // Nearest xterm 256-color index: the closer of the nearest cube color
+    // and the nearest of the 24 grays
+    inline int xterm_index(Rgb c) {
+        static constexpr int CUBE[6] = {0, 95, 135, 175, 215, 255};
+        auto nearest_step = [](int v) {
+            int best = 0;
+            for (int i = 1; i < 6; ++i) {
+                if (std::abs(CUBE[i] - v) < std::abs(CUBE[best] - v)) best = i;
+            }
+            return best;
+        };
+        int r = nearest_step(c.r), g = nearest_step(c.g), b = nearest_step(c.b);
+        Rgb cube{static_cast<uint8_t>(CUBE[r]), static_cast<uint8_t>(CUBE[g]), static_cast<uint8_t>(CUBE[b])};
+
+        int gray_step = std::clamp(((c.r + c.g + c.b) / 3 - 8 + 5) / 10, 0, 23);
+        uint8_t level = static_cast<uint8_t>(8 + 10 * gray_step);
+        Rgb gray{level, level, level};
+
+        if (distance(c, gray) < distance(c, cube)) return 232 + gray_step;
+        return 16 + 36 * r + 6 * g + b;
+    }
+}
+
+// A palette sampled at LEVELS points with preformatted escape parameters.
+// Levels whose escapes are identical (common at 256 colors) share an id, so
+// the renderer can merge runs by comparing ids.
+class ColorTable {
+public:
+    static constexpr int LEVELS = 256;
+
+    // SGR parameters such as "38;5;97" or "48;2;68;1;84", without "\033[" and "m"
+    struct Sgr {
+        char text[20] = {};
+        uint8_t size = 0;
+        std::string_view view() const { return {text, size}; }
+    };
+
+private:
+    std::array<Rgb, LEVELS> rgb_;
+    std::array<uint32_t, LEVELS> id_;
+    std::array<Sgr, LEVELS> fg_;
+    std::array<Sgr, LEVELS> bg_;
+
+    static void append(Sgr& sgr, std::string_view text) {
+        std::copy(text.begin(), text.end(), sgr.text + sgr.size);
+        sgr.size += static_cast<uint8_t>(text.size());
+    }
+
+    static void append(Sgr& sgr, int value) {
+        auto result = std::to_chars(sgr.text + sgr.size, sgr.text + sizeof(sgr.text), value);
+        sgr.size = static_cast<uint8_t>(result.ptr - sgr.text);
+    }
+
+public:
+    ColorTable(Palette palette, ColorDepth depth) {
+        using namespace color_palette_detail;
+        if (palette == Palette::None) {
+            throw std::invalid_argument("A color table needs a palette");
+        }
+        for (int i = 0; i < LEVELS; ++i) {
+            double t = static_cast<double>(i) / (LEVELS - 1);
+            Rgb c = palette == Palette::Viridis ? interpolate(VIRIDIS, t)
+                  : palette == Palette::Magma   ? interpolate(MAGMA, t)
+                                                : interpolate(GRAY, t);
+            rgb_[i] = c;
+            for (auto [sgr, prefix] : {std::pair{&fg_[i], "38;"}, std::pair{&bg_[i], "48;"}}) {
+                append(*sgr, prefix);
+                if (depth == ColorDepth::TrueColor) {
+                    append(*sgr, "2;");
+                    append(*sgr, c.r);
+                    append(*sgr, ";");
+                    append(*sgr, c.g);
+                    append(*sgr, ";");
+                    append(*sgr, c.b);
+                } else {
+                    append(*sgr, "5;");
+                    append(*sgr, xterm_index(c));
+                }
+            }
+            id_[i] = depth == ColorDepth::TrueColor ? (uint32_t{c.r} << 16 | uint32_t{c.g} << 8 | c.b)
+                                                    : static_cast<uint32_t>(xterm_index(c));
+        }
+    }
+
+    // Level of a value normalized to [0, 1]
+    static int level(double normalized) {
+        return std::clamp(static_cast<int>(normalized * LEVELS), 0, LEVELS - 1);
+    }
+
+    Rgb rgb(int level) const { return rgb_[level]; }
+    uint32_t id(int level) const { return id_[level]; }
+    std::string_view fg(int level) const { return fg_[level].view(); }
+    std::string_view bg(int level) const { return bg_[level].view(); }
+};
+
+// Shared table for a palette and depth, built on first use
+inline const ColorTable& color_table(Palette palette, ColorDepth depth) {
+    static const ColorTable tables[3][2] = {
+        {{Palette::Gray, ColorDepth::Ansi256}, {Palette::Gray, ColorDepth::TrueColor}},
+        {{Palette::Viridis, ColorDepth::Ansi256}, {Palette::Viridis, ColorDepth::TrueColor}},
+        {{Palette::Magma, ColorDepth::Ansi256}, {Palette::Magma, ColorDepth::TrueColor}}};
+    if (palette == Palette::None) {
+        throw std::invalid_argument("A color table needs a palette");
+    }
+    return tables[static_cast<int>(palette) - 1][depth == ColorDepth::TrueColor ? 1 : 0];
+}
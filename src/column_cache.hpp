@@ -0,0 +1,202 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include "arg_parser.hpp"
+#include "columnar.hpp"
+#include "compressed_input.hpp"
+#include "data_reader.hpp"
+#include "input_source.hpp"
+#include "run_stats.hpp"
+
+namespace tplt {
+
+// Opt-in cache of parsed text columns (--cache, --cache-dir). The first plot
+// of a file parses the columns it selects and stores them in a sidecar
+// columnar table. The sidecar keeps the file's column positions and header
+// names, with columns nobody has asked for yet marked Absent. Later plots map
+// the sidecar instead of tokenizing the text, and parse only columns it
+// doesn't hold yet. The sidecar's name carries a key of the file's path, size
+// and mtime plus the delimiter and header mode, so a changed file or a
+// different reading of it never hits a stale cache.
+
+// FNV-1a over the key fields
+inline uint64_t cache_key_hash(std::string_view text, uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+inline std::string cache_key_hex(uint64_t hash) {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+// Sidecar path for options.input_path: hidden next to the file, or in
+// options.cache_dir. Stale sidecars of the same file share the returned prefix.
+inline std::filesystem::path column_cache_path(const Options& options, std::string* stale_prefix = nullptr) {
+    namespace fs = std::filesystem;
+    fs::path input = fs::absolute(options.input_path);
+
+    std::string key = input.string();
+    key += '\0' + std::to_string(fs::file_size(input));
+    key += '\0' + std::to_string(fs::last_write_time(input).time_since_epoch().count());
+    key += '\0' + std::string(1, options.delimiter);
+    key += '\0' + std::to_string(static_cast<int>(options.header_mode));
+
+    std::string prefix;
+    fs::path dir;
+    if (options.cache_dir.empty()) {
+        prefix = "." + input.filename().string() + ".";
+        dir = input.parent_path();
+    } else {
+        // Files of the same name in different directories share the cache dir
+        prefix = cache_key_hex(cache_key_hash(input.string())).substr(0, 8) + "-" + input.filename().string() + ".";
+        dir = options.cache_dir;
+    }
+    if (stale_prefix) *stale_prefix = prefix;
+    return dir / (prefix + cache_key_hex(cache_key_hash(key)) + ".tcol");
+}
+
+// Return the path of a sidecar holding every column options selects, parsing
+// the missing ones out of the text on up to threads threads first. Returns
+// nothing, after a warning, when the input can't be cached or the sidecar
+// can't be written; the caller then reads the text as usual.
+inline std::optional<std::string> cached_columns(DataReader& reader, const Options& options, size_t threads,
+                                                 RunStats* stats = nullptr) {
+    namespace fs = std::filesystem;
+    if (options.input_path.empty() || !is_regular_file(options.input_path)) {
+        std::cerr << "Warning: --cache needs a regular file; reading without cache" << std::endl;
+        return std::nullopt;
+    }
+    if (options.aggregation.function == AggregationSpec::Function::Distinct) {
+        std::cerr << "Warning: the column cache stores numbers; distinct() reads the text" << std::endl;
+        return std::nullopt;
+    }
+
+    MappedFile text(options.input_path);
+    if (is_columnar(text.view())) return std::nullopt;  // Already as fast as the cache
+    if (detect_compression(text.view()) != Compression::None) {
+        std::cerr << "Warning: --cache parses text in place; reading the compressed input without cache" << std::endl;
+        return std::nullopt;
+    }
+
+    std::string stale_prefix;
+    fs::path sidecar = column_cache_path(options, &stale_prefix);
+    std::string_view data = reader.read_header(text.view(), options);
+    std::vector<size_t> wanted = reader.selected_columns();
+    std::vector<std::string> headers = reader.get_headers();
+
+    // Start from what the sidecar already holds
+    std::vector<ColumnInfo> schema;
+    std::vector<std::vector<double>> values;
+    size_t rows = 0;
+    bool have_rows = false;
+    std::error_code ignored;
+    if (fs::is_regular_file(sidecar, ignored)) {
+        try {
+            MappedFile cached(sidecar.string());
+            ColumnarView table(cached.view());
+            bool hit = std::all_of(wanted.begin(), wanted.end(), [&](size_t column) {
+                return column < table.columns().size() && table.stored(column);
+            });
+            if (hit) return sidecar.string();
+
+            schema = table.columns();
+            values.resize(schema.size());
+            rows = table.rows();
+            for (size_t c = 0; c < schema.size(); ++c) {
+                if (!table.stored(c)) continue;
+                values[c].resize(rows);
+                table.read(c, 0, rows, values[c].data());
+                have_rows = true;
+            }
+        } catch (const std::exception&) {
+            // Unreadable sidecar: rebuild it from scratch
+            schema.clear();
+            values.clear();
+            have_rows = false;
+        }
+    }
+
+    RunStats::Scope timer(stats, Stage::Cache);
+    if (stats) stats->bytes_read += text.size();
+
+    std::vector<size_t> missing;
+    for (size_t column : wanted) {
+        if (column >= schema.size() || schema[column].type == ColumnType::Absent) {
+            missing.push_back(column);
+        }
+    }
+    std::vector<std::vector<double>> parsed = reader.parse_columns(data, missing, threads);
+
+    size_t width = std::max({schema.size(), headers.size(), wanted.empty() ? 0 : wanted.back() + 1});
+    schema.resize(width, ColumnInfo{"", ColumnType::Absent});
+    values.resize(width);
+    if (have_rows && !parsed.empty() && parsed[0].size() != rows) {
+        // The text no longer lines up with the sidecar; keep only the new columns
+        for (auto& column : schema) column.type = ColumnType::Absent;
+    }
+    for (size_t i = 0; i < missing.size(); ++i) {
+        values[missing[i]] = std::move(parsed[i]);
+        schema[missing[i]].type = infer_column_type(values[missing[i]]);
+    }
+    for (size_t c = 0; c < width; ++c) {
+        schema[c].name = c < headers.size() ? headers[c] : std::string();
+        if (schema[c].type == ColumnType::Absent) values[c].clear();
+    }
+
+    // Write beside the sidecar and rename, so readers never see a partial table
+    fs::path temp = sidecar;
+    temp += ".tmp" + std::to_string(getpid());
+    try {
+        if (!options.cache_dir.empty()) fs::create_directories(options.cache_dir);
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("cannot create " + temp.string());
+            }
+            write_columnar(out, schema, values);
+        }
+        fs::rename(temp, sidecar);
+    } catch (const std::exception& e) {
+        fs::remove(temp, ignored);
+        std::cerr << "Warning: cannot write column cache: " << e.what() << std::endl;
+        return std::nullopt;
+    }
+
+    // Sidecars of earlier versions of the file are dead weight. Only names of
+    // exactly the form prefix + key + ".tcol" are this file's: the sidecars of
+    // a file whose name extends this one's (data.csv.1) share the prefix.
+    auto stale = [&](const std::string& name) {
+        size_t key = stale_prefix.size();
+        if (name.size() != key + 16 + 5 || name.rfind(stale_prefix, 0) != 0 ||
+            name.compare(key + 16, 5, ".tcol") != 0) {
+            return false;
+        }
+        return std::all_of(name.begin() + key, name.begin() + key + 16, [](char c) {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+        });
+    };
+    for (const auto& entry : fs::directory_iterator(sidecar.parent_path(), ignored)) {
+        std::string name = entry.path().filename().string();
+        if (name != sidecar.filename().string() && stale(name)) {
+            fs::remove(entry.path(), ignored);
+        }
+    }
+
+    return sidecar.string();
+}
+
+} // namespace tplt
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include "number_parser.hpp"
+
+namespace tplt {
+
+// Binary columnar table, written once by `tplt convert` and then mapped and
+// binned straight from its typed arrays, with no tokenizing or number parsing.
+// Layout (native little-endian):
+//
+//   char[8]  magic "TPLTCOL\0"
+//   uint32   version (1)
+//   uint32   column count
+//   uint64   row count
+//   per column: uint8 type, uint8 reserved, uint16 name length, name bytes
+//   zero padding to a multiple of 8
+//   per column: row count values of its type, padded to a multiple of 8
+//
+// Every block starts 8-byte aligned, so a mapped file can be read in place.
+// Missing values are NaN, which only the floating-point types can hold. An
+// Absent column has no block; it only keeps the positions of the columns
+// after it, as in a partial cache of a text file.
+static_assert(std::endian::native == std::endian::little,
+              "The columnar format is read in place and assumes a little-endian host");
+
+enum class ColumnType : uint8_t {
+    Absent = 0,
+    F32 = 1,
+    F64 = 2,
+    I32 = 3,
+    I64 = 4
+};
+
+inline size_t column_type_size(ColumnType type) {
+    if (type == ColumnType::Absent) return 0;
+    return type == ColumnType::F32 || type == ColumnType::I32 ? 4 : 8;
+}
+
+inline const char* column_type_name(ColumnType type) {
+    switch (type) {
+        case ColumnType::F32: return "f32";
+        case ColumnType::F64: return "f64";
+        case ColumnType::I32: return "i32";
+        case ColumnType::I64: return "i64";
+        default: return "absent";
+    }
+}
+
+struct ColumnInfo {
+    std::string name;   // Empty when the source had no header
+    ColumnType type = ColumnType::F64;
+};
+
+namespace columnar_detail {
+    constexpr char MAGIC[8] = {'T', 'P', 'L', 'T', 'C', 'O', 'L', '\0'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t FIXED_HEADER = 24;
+
+    inline size_t align8(size_t n) { return (n + 7) & ~size_t{7}; }
+
+    template<typename T>
+    T load(const char* p) {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+}
+
+// True if buffer starts like a columnar table
+inline bool is_columnar(std::string_view buffer) {
+    return buffer.size() >= sizeof(columnar_detail::MAGIC) &&
+           std::memcmp(buffer.data(), columnar_detail::MAGIC, sizeof(columnar_detail::MAGIC)) == 0;
+}
+
+// Read-only view of a columnar table in memory (usually a MappedFile). The
+// buffer must outlive the view and be 8-byte aligned, which mappings are.
+class ColumnarView {
+private:
+    std::vector<ColumnInfo> columns_;
+    std::vector<const char*> blocks_;
+    uint64_t rows_ = 0;
+
+    [[noreturn]] static void corrupt(const std::string& what) {
+        throw std::runtime_error("Corrupt columnar input: " + what);
+    }
+
+    template<typename T>
+    const T* block(size_t column) const {
+        return reinterpret_cast<const T*>(blocks_[column]);
+    }
+
+public:
+    explicit ColumnarView(std::string_view buffer) {
+        using namespace columnar_detail;
+        if (!is_columnar(buffer) || buffer.size() < FIXED_HEADER) corrupt("bad header");
+        if (reinterpret_cast<uintptr_t>(buffer.data()) % 8 != 0) {
+            throw std::runtime_error("Columnar input must be 8-byte aligned");
+        }
+
+        const char* base = buffer.data();
+        uint32_t version = load<uint32_t>(base + 8);
+        if (version != VERSION) {
+            throw std::runtime_error("Unsupported columnar version " + std::to_string(version));
+        }
+        uint32_t count = load<uint32_t>(base + 12);
+        rows_ = load<uint64_t>(base + 16);
+
+        size_t pos = FIXED_HEADER;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (pos + 4 > buffer.size()) corrupt("truncated schema");
+            auto type = static_cast<ColumnType>(static_cast<uint8_t>(base[pos]));
+            if (type > ColumnType::I64) {
+                corrupt("unknown type of column " + std::to_string(i + 1));
+            }
+            uint16_t name_length = load<uint16_t>(base + pos + 2);
+            pos += 4;
+            if (pos + name_length > buffer.size()) corrupt("truncated schema");
+            columns_.push_back({std::string(base + pos, name_length), type});
+            pos += name_length;
+        }
+
+        pos = align8(pos);
+        if (rows_ > buffer.size()) corrupt("truncated column data");
+        for (const auto& column : columns_) {
+            size_t bytes = align8(rows_ * column_type_size(column.type));
+            if (pos + bytes > buffer.size()) corrupt("truncated column data");
+            blocks_.push_back(column.type == ColumnType::Absent ? nullptr : base + pos);
+            pos += bytes;
+        }
+    }
+
+    const std::vector<ColumnInfo>& columns() const { return columns_; }
+    size_t rows() const { return static_cast<size_t>(rows_); }
+    bool stored(size_t column) const { return blocks_[column] != nullptr; }
+
+    // Convert rows [begin, end) of column to doubles in out. One type switch
+    // per call, so the copy loop itself is a plain (vectorizable) conversion.
+    void read(size_t column, size_t begin, size_t end, double* out) const {
+        auto copy = [&](const auto* values) {
+            for (size_t i = begin; i < end; ++i) {
+                *out++ = static_cast<double>(values[i]);
+            }
+        };
+        switch (columns_[column].type) {
+            case ColumnType::F32: copy(block<float>(column)); break;
+            case ColumnType::F64: copy(block<double>(column)); break;
+            case ColumnType::I32: copy(block<int32_t>(column)); break;
+            case ColumnType::I64: copy(block<int64_t>(column)); break;
+            case ColumnType::Absent:
+                throw std::runtime_error("Column " + std::to_string(column + 1) + " is not stored");
+        }
+    }
+};
+
+// Narrowest type that holds every value of a column exactly: integers when
+// all values are whole (and, for i64, exactly representable as doubles),
+// f64 otherwise or when values are missing
+inline ColumnType infer_column_type(const std::vector<double>& values) {
+    bool fits_i32 = true;
+    for (double v : values) {
+        if (!std::isfinite(v) || v != std::trunc(v) || std::abs(v) > 9007199254740992.0) {
+            return ColumnType::F64;
+        }
+        if (v < std::numeric_limits<int32_t>::min() || v > std::numeric_limits<int32_t>::max()) {
+            fits_i32 = false;
+        }
+    }
+    return fits_i32 ? ColumnType::I32 : ColumnType::I64;
+}
+
+// Write a columnar table. columns[i] holds the values of schema[i], all of
+// the same length (Absent columns are ignored); values are converted to the
+// column's type.
+inline void write_columnar(std::ostream& out, const std::vector<ColumnInfo>& schema,
+                           const std::vector<std::vector<double>>& columns) {
+    using namespace columnar_detail;
+    if (columns.size() != schema.size()) {
+        throw std::runtime_error("Columnar schema and data differ in column count");
+    }
+    uint64_t rows = 0;
+    for (size_t i = 0; i < schema.size(); ++i) {
+        if (schema[i].type != ColumnType::Absent) {
+            rows = columns[i].size();
+            break;
+        }
+    }
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    auto append = [&header](auto value) {
+        header.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    append(VERSION);
+    append(static_cast<uint32_t>(schema.size()));
+    append(rows);
+    for (size_t i = 0; i < schema.size(); ++i) {
+        if (schema[i].type != ColumnType::Absent && columns[i].size() != rows) {
+            throw std::runtime_error("Columnar columns differ in length");
+        }
+        if (schema[i].name.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::runtime_error("Column name too long: " + schema[i].name.substr(0, 32) + "...");
+        }
+        append(static_cast<uint8_t>(schema[i].type));
+        append(uint8_t{0});
+        append(static_cast<uint16_t>(schema[i].name.size()));
+        header += schema[i].name;
+    }
+    header.resize(align8(header.size()), '\0');
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    // Converted a chunk at a time to bound the staging buffer
+    std::vector<char> chunk;
+    for (size_t i = 0; i < schema.size(); ++i) {
+        auto emit = [&](auto tag) {
+            using T = decltype(tag);
+            constexpr size_t CHUNK_ROWS = 1 << 16;
+            for (size_t start = 0; start < rows; start += CHUNK_ROWS) {
+                size_t n = std::min<size_t>(CHUNK_ROWS, rows - start);
+                chunk.resize(n * sizeof(T));
+                for (size_t r = 0; r < n; ++r) {
+                    T value = static_cast<T>(columns[i][start + r]);
+                    std::memcpy(chunk.data() + r * sizeof(T), &value, sizeof(T));
+                }
+                out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            }
+            size_t bytes = rows * sizeof(T);
+            static const char padding[8] = {};
+            out.write(padding, static_cast<std::streamsize>(align8(bytes) - bytes));
+        };
+        switch (schema[i].type) {
+            case ColumnType::F32: emit(float{}); break;
+            case ColumnType::F64: emit(double{}); break;
+            case ColumnType::I32: emit(int32_t{}); break;
+            case ColumnType::I64: emit(int64_t{}); break;
+            case ColumnType::Absent: break;
+        }
+    }
+
+    if (!out) {
+        throw std::runtime_error("Failed writing columnar output");
+    }
+}
+
+// Collects text rows column by column for write_columnar. Fields that are
+// missing or not numbers are stored as NaN, so the table keeps the row and
+// the reader rejects it only for the columns it selects.
+class ColumnarBuilder {
+private:
+    std::vector<std::string> names_;
+    std::vector<size_t> positions_;     // 0-based source field of each column
+    std::vector<std::vector<double>> values_;
+    uint64_t non_numeric_ = 0;
+
+public:
+    ColumnarBuilder(std::vector<std::string> names, std::vector<size_t> positions)
+        : names_(std::move(names)), positions_(std::move(positions)), values_(positions_.size()) {}
+
+    void add_row(const std::vector<std::string_view>& fields) {
+        for (size_t i = 0; i < positions_.size(); ++i) {
+            double value;
+            if (positions_[i] >= fields.size() ||
+                parse_double(fields[positions_[i]], value) != std::errc{}) {
+                value = std::numeric_limits<double>::quiet_NaN();
+                non_numeric_++;
+            }
+            values_[i].push_back(value);
+        }
+    }
+
+    size_t rows() const { return values_.empty() ? 0 : values_[0].size(); }
+
+    // Fields stored as NaN because they were missing or not numbers
+    uint64_t non_numeric() const { return non_numeric_; }
+
+    std::vector<ColumnInfo> schema() const {
+        std::vector<ColumnInfo> schema;
+        for (size_t i = 0; i < values_.size(); ++i) {
+            schema.push_back({names_[i], infer_column_type(values_[i])});
+        }
+        return schema;
+    }
+
+    void write(std::ostream& out) const {
+        write_columnar(out, schema(), values_);
+    }
+};
+
+} // namespace tplt
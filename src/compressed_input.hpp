@@ -0,0 +1,397 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <istream>
+#include <streambuf>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include "input_source.hpp"
+
+#ifdef TPLT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TPLT_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace tplt {
+
+enum class Compression {
+    None,
+    Gzip,
+    Zstd
+};
+
+// Compression of data starting with head, from its magic bytes
+inline Compression detect_compression(std::string_view head) {
+    if (head.size() >= 2 && head[0] == '\x1f' && head[1] == '\x8b') return Compression::Gzip;
+    if (head.size() >= 4 && head.substr(0, 4) == std::string_view("\x28\xb5\x2f\xfd", 4)) return Compression::Zstd;
+    return Compression::None;
+}
+
+// Compression of the file at path; anything but a regular file counts as
+// uncompressed, since it can't be checked without consuming it
+inline Compression file_compression(const std::string& path) {
+    if (path.empty() || !is_regular_file(path)) return Compression::None;
+    return detect_compression(MappedFile(path).view());
+}
+
+// Text of a gzip or zstd file, decompressed ahead of the reader on background
+// threads. The text is handed over in large blocks through a bounded ring:
+// decompression fills blocks while the reader parses the ones before them, so
+// the two overlap. The ring is bounded in bytes: blocks being filled or
+// waiting to be read hold at most budget bytes, except that the block the
+// reader needs next is always let in. Emptied blocks are reused, up to budget
+// bytes of them. As a streambuf it serves the blocks in place to any stream
+// reader (rows, records, --follow), so none of them changes for compressed
+// input.
+//
+// Concatenated gzip members are read one after another, as are zstd files
+// streamed through one decoder; both use BLOCK_SIZE blocks and a budget of
+// RING blocks. A zstd file of several frames that all record a size of at
+// most MAX_FRAME (as written by pzstd or zstd --split) is decompressed a
+// frame per task on up to threads threads, with the frames still handed over
+// in order. Its budget is two blocks per decoder, at least RING. Frames
+// larger than the budget wait until they are next. So at most budget plus
+// two frames are held: one waiting or being filled, one being read. Spare
+// blocks add at most another budget.
+class DecompressedInput : public std::streambuf {
+public:
+    static constexpr size_t BLOCK_SIZE = 4 << 20;
+    static constexpr size_t RING = 4;
+    static constexpr uint64_t MAX_FRAME = 64 << 20;  // Larger frames are streamed
+
+private:
+    // A block handed to the reader, with the bytes of the ring it took up
+    struct Block {
+        std::vector<char> text;
+        size_t reserved = 0;
+    };
+
+    MappedFile file_;
+    std::string name_;
+    size_t budget_ = RING * BLOCK_SIZE;    // Bytes that blocks in flight may take up
+
+    std::mutex lock_;
+    std::condition_variable filled_;   // Wakes the reader
+    std::condition_variable drained_;  // Wakes decompressors waiting for room
+    std::map<uint64_t, Block> ready_;               // Decompressed blocks by sequence number
+    std::vector<std::vector<char>> spare_;          // Read blocks kept for reuse
+    size_t in_flight_ = 0;                          // Bytes taken up by blocks being filled or ready
+    size_t spare_bytes_ = 0;                        // Capacity of the spare blocks
+    std::vector<char> current_;                     // Block being read
+    uint64_t next_ = 0;                             // Sequence number of the next block to read
+    uint64_t blocks_ = std::numeric_limits<uint64_t>::max();  // Number of blocks, once known
+    uint64_t claimed_ = 0;                          // Frames taken by frame decoders
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    std::vector<std::thread> workers_;
+
+    // Wait until size more bytes fit in the ring, or block seq is the next
+    // one to read, and take them up; false if reading was abandoned
+    bool wait_for_room(uint64_t seq, size_t size) {
+        std::unique_lock<std::mutex> guard(lock_);
+        drained_.wait(guard, [&] {
+            return stopping_ || error_ || seq == next_ || in_flight_ + size <= budget_;
+        });
+        if (stopping_ || error_) return false;
+        in_flight_ += size;
+        return true;
+    }
+
+    std::vector<char> take_spare(size_t size) {
+        std::vector<char> block;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (!spare_.empty()) {
+                block = std::move(spare_.back());
+                spare_.pop_back();
+                spare_bytes_ -= block.capacity();
+            }
+        }
+        block.resize(size);
+        return block;
+    }
+
+    // Hand block seq, which took up reserved bytes of the ring, to the reader
+    void deliver(uint64_t seq, std::vector<char> block, size_t reserved) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            ready_[seq] = {std::move(block), reserved};
+        }
+        filled_.notify_one();
+    }
+
+    void finish(uint64_t blocks) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            blocks_ = blocks;
+        }
+        filled_.notify_one();
+    }
+
+    // Run a decompressor, handing its first error to the reader
+    template<typename Work>
+    void guarded(Work&& work) {
+        try {
+            work();
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                if (!error_) error_ = std::current_exception();
+            }
+            filled_.notify_one();
+            drained_.notify_all();
+        }
+    }
+
+    [[noreturn]] void corrupt(const std::string& what) const {
+        throw std::runtime_error(name_ + ": " + what);
+    }
+
+#ifdef TPLT_HAVE_ZLIB
+    void inflate_gzip() {
+        z_stream stream{};
+        // 15 + 16: the largest window, gzip wrapper
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) corrupt("cannot start gzip decoder");
+        std::unique_ptr<z_stream, int (*)(z_stream*)> end(&stream, inflateEnd);
+
+        std::string_view data = file_.view();
+        size_t fed = 0;
+        auto feed = [&] {
+            size_t size = std::min<size_t>(data.size() - fed, std::numeric_limits<uInt>::max());
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data() + fed));
+            stream.avail_in = static_cast<uInt>(size);
+            fed += size;
+        };
+        feed();
+
+        bool done = false;
+        for (uint64_t seq = 0; !done; ++seq) {
+            if (!wait_for_room(seq, BLOCK_SIZE)) return;
+            std::vector<char> block = take_spare(BLOCK_SIZE);
+            stream.next_out = reinterpret_cast<Bytef*>(block.data());
+            stream.avail_out = static_cast<uInt>(block.size());
+            while (stream.avail_out > 0) {
+                if (stream.avail_in == 0 && fed < data.size()) feed();
+                int result = inflate(&stream, Z_NO_FLUSH);
+                if (result == Z_STREAM_END) {
+                    if (stream.avail_in == 0 && fed == data.size()) {
+                        done = true;
+                        break;
+                    }
+                    inflateReset(&stream);  // Another member follows
+                } else if (result == Z_BUF_ERROR && stream.avail_in == 0) {
+                    corrupt("truncated gzip data");
+                } else if (result != Z_OK) {
+                    corrupt(std::string("corrupt gzip data: ") + (stream.msg ? stream.msg : "inflate failed"));
+                }
+            }
+            block.resize(block.size() - stream.avail_out);
+            deliver(seq, std::move(block), BLOCK_SIZE);
+            if (done) finish(seq + 1);
+        }
+    }
+#endif
+
+#ifdef TPLT_HAVE_ZSTD
+    using ZstdContext = std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)>;
+
+    // Offsets and sizes of the frames of a multi-frame file whose frames all
+    // record a decompressed size no larger than MAX_FRAME, else nothing
+    struct Frame {
+        size_t offset;
+        size_t size;
+        size_t content;
+    };
+    std::vector<Frame> independent_frames() const {
+        std::string_view data = file_.view();
+        std::vector<Frame> frames;
+        for (size_t offset = 0; offset < data.size();) {
+            size_t size = ZSTD_findFrameCompressedSize(data.data() + offset, data.size() - offset);
+            if (ZSTD_isError(size)) return {};
+            unsigned long long content = ZSTD_getFrameContentSize(data.data() + offset, size);
+            if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR || content > MAX_FRAME) {
+                return {};
+            }
+            frames.push_back({offset, size, static_cast<size_t>(content)});
+            offset += size;
+        }
+        return frames.size() > 1 ? frames : std::vector<Frame>{};
+    }
+
+    void stream_zstd() {
+        ZstdContext context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+        if (!context) corrupt("cannot start zstd decoder");
+        std::string_view data = file_.view();
+        ZSTD_inBuffer in{data.data(), data.size(), 0};
+
+        size_t pending = 0;  // Nonzero while the last frame read is unfinished
+        bool done = false;
+        for (uint64_t seq = 0; !done; ++seq) {
+            if (!wait_for_room(seq, BLOCK_SIZE)) return;
+            std::vector<char> block = take_spare(BLOCK_SIZE);
+            ZSTD_outBuffer out{block.data(), block.size(), 0};
+            while (out.pos < out.size) {
+                size_t before = out.pos;
+                size_t result = ZSTD_decompressStream(context.get(), &out, &in);
+                if (ZSTD_isError(result)) corrupt(std::string("corrupt zstd data: ") + ZSTD_getErrorName(result));
+                // Out of input and output: the input ended where the last call left off
+                if (in.pos == in.size && out.pos == before) {
+                    if (pending != 0) corrupt("truncated zstd data");
+                    done = true;
+                    break;
+                }
+                pending = result;
+            }
+            block.resize(out.pos);
+            deliver(seq, std::move(block), BLOCK_SIZE);
+            if (done) finish(seq + 1);
+        }
+    }
+
+    // One decoder of a multi-frame file: takes the next frame until none are left
+    void decode_frames(const std::vector<Frame>& frames) {
+        ZstdContext context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+        if (!context) corrupt("cannot start zstd decoder");
+        std::string_view data = file_.view();
+        for (;;) {
+            uint64_t seq;
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                seq = claimed_++;
+            }
+            if (seq >= frames.size() || !wait_for_room(seq, frames[seq].content)) return;
+            const Frame& frame = frames[seq];
+            std::vector<char> block = take_spare(frame.content);
+            size_t size = ZSTD_decompressDCtx(context.get(), block.data(), block.size(),
+                                              data.data() + frame.offset, frame.size);
+            if (ZSTD_isError(size)) corrupt(std::string("corrupt zstd data: ") + ZSTD_getErrorName(size));
+            if (size != frame.content) corrupt("corrupt zstd data: frame size mismatch");
+            deliver(seq, std::move(block), frame.content);
+        }
+    }
+#endif
+
+    void start(size_t threads) {
+        Compression compression = detect_compression(file_.view());
+        if (compression == Compression::Gzip) {
+#ifdef TPLT_HAVE_ZLIB
+            workers_.emplace_back([this] { guarded([this] { inflate_gzip(); }); });
+#else
+            corrupt("gzip input needs tplt built with zlib");
+#endif
+        } else if (compression == Compression::Zstd) {
+#ifdef TPLT_HAVE_ZSTD
+            if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<Frame> frames = threads > 1 ? independent_frames() : std::vector<Frame>{};
+            if (frames.empty()) {
+                workers_.emplace_back([this] { guarded([this] { stream_zstd(); }); });
+                return;
+            }
+            // Room for a block per decoder and as many decoded ones waiting
+            size_t decoders = std::min(threads, frames.size());
+            budget_ = std::max(RING, 2 * decoders) * BLOCK_SIZE;
+            blocks_ = frames.size();
+            auto shared = std::make_shared<std::vector<Frame>>(std::move(frames));
+            for (size_t i = 0; i < decoders; ++i) {
+                workers_.emplace_back([this, shared] { guarded([&] { decode_frames(*shared); }); });
+            }
+#else
+            (void)threads;
+            corrupt("zstd input needs tplt built with libzstd");
+#endif
+        } else {
+            corrupt("not gzip or zstd data");
+        }
+    }
+
+    // Abandon decompression and wait for the decompressors to return
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stopping_ = true;
+        }
+        drained_.notify_all();
+        for (auto& worker : workers_) worker.join();
+        workers_.clear();
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+        std::unique_lock<std::mutex> guard(lock_);
+        if (current_.capacity() > 0 && spare_bytes_ + current_.capacity() <= budget_) {
+            spare_bytes_ += current_.capacity();
+            spare_.push_back(std::move(current_));
+        }
+        current_ = {};
+        setg(nullptr, nullptr, nullptr);
+        for (;;) {
+            filled_.wait(guard, [&] { return error_ || next_ >= blocks_ || ready_.count(next_) > 0; });
+            // The stream rethrows this to its reader (see DecompressedStream)
+            if (error_) std::rethrow_exception(error_);
+            if (next_ >= blocks_) return traits_type::eof();
+
+            auto block = ready_.find(next_);
+            current_ = std::move(block->second.text);
+            in_flight_ -= block->second.reserved;
+            ready_.erase(block);
+            next_++;
+            drained_.notify_all();
+            if (current_.empty()) continue;
+            setg(current_.data(), current_.data(), current_.data() + current_.size());
+            return traits_type::to_int_type(*gptr());
+        }
+    }
+
+public:
+    // Start decompressing file, a gzip or zstd file named name in errors.
+    // threads bounds the zstd frame decoders; 0 means one per core.
+    DecompressedInput(MappedFile file, std::string name, size_t threads = 0)
+        : file_(std::move(file)), name_(std::move(name)) {
+        try {
+            start(threads);
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~DecompressedInput() override {
+        stop();
+    }
+
+    DecompressedInput(const DecompressedInput&) = delete;
+    DecompressedInput& operator=(const DecompressedInput&) = delete;
+};
+
+// Stream over the text of a compressed file. Decompression errors are
+// rethrown to the reader rather than ending the stream quietly.
+class DecompressedStream : public std::istream {
+private:
+    DecompressedInput buffer_;
+
+public:
+    DecompressedStream(MappedFile file, std::string name, size_t threads = 0)
+        : std::istream(nullptr), buffer_(std::move(file), std::move(name), threads) {
+        rdbuf(&buffer_);
+        exceptions(std::ios::badbit);
+    }
+
+    explicit DecompressedStream(const std::string& path, size_t threads = 0)
+        : DecompressedStream(MappedFile(path), path, threads) {}
+};
+
+} // namespace tplt
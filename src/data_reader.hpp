@@ -1,44 +1,111 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
-#include <sstream>
+#include <fstream>
 #include <optional>
 #include <tuple>
+#include <array>
+#include <utility>
 #include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include "arg_parser.hpp"
+#include "input_source.hpp"
+#include "compressed_input.hpp"
+#include "columnar.hpp"
+#include "number_parser.hpp"
+#include "row_sampler.hpp"
+#include "run_stats.hpp"
 
 namespace tplt {
 
 // Container for a row of data
 using DataRow = std::vector<std::string>;
 
-// Data point with x, y and optional value
+// Data point with x, y, optional value and optional timestamp
 template<typename T = double>
 struct DataPoint {
     T x;
     T y;
     std::optional<T> value;
+    std::optional<T> time;  // Set when a time field is selected
+    uint64_t key = 0;       // Identity of the value field, for distinct counts
     
     DataPoint(T x_val, T y_val) : x(x_val), y(y_val), value(std::nullopt) {}
     DataPoint(T x_val, T y_val, T val) : x(x_val), y(y_val), value(val) {}
 };
 
+// Outcome of parsing one data row
+enum class RowStatus {
+    Ok,             // Row accepted
+    MissingField,   // A selected field is absent from the row
+    BadNumber,      // A selected field is not a number
+    OutOfRange      // x or y is outside --xrange/--yrange
+};
+
 class DataReader {
 private:
+    // Parsed fields a data row is projected onto
+    enum Slot { SLOT_X, SLOT_Y, SLOT_VALUE, SLOT_TIME, SLOT_COUNT };
+    
+    using ProjectedRow = std::array<std::string_view, SLOT_COUNT>;
+    
+    // Columns selected by the options, resolved to positions once per input
+    struct Projection {
+        std::array<std::optional<FieldSpec>, SLOT_COUNT> specs;
+        std::vector<std::pair<size_t, Slot>> columns;   // (0-based column, slot), by column
+        bool keyed = false;     // The value field is an identity (distinct), not a number
+        std::array<std::optional<AxisRange>, 2> ranges;  // Row filters on SLOT_X and SLOT_Y
+    };
+    
+    // Rows taken by one read of an input or chunk: which ones the sampler
+    // let through and, for a reservoir, the rows kept until the input ends
+    template<typename T>
+    struct SampledRows {
+        RowSampler sampler;
+        std::vector<std::pair<RowStatus, std::optional<DataPoint<T>>>> reservoir;
+        uint64_t counts[4] = {0, 0, 0, 0};  // By RowStatus
+        uint64_t skipped = 0;
+        
+        explicit SampledRows(RowSampler row_sampler) : sampler(row_sampler) {}
+    };
+    
     char delimiter_;
     std::vector<std::string> headers_;
     bool has_headers_ = false;
+    Projection projection_;
+    RunStats* stats_ = nullptr;
+    double sample_rate_ = 1.0;          // --sample
+    uint64_t max_rows_ = 0;             // --max-rows (0 = all)
+    uint64_t reservoir_size_ = 0;       // --reservoir (0 = none)
+    uint64_t seed_ = 1;
+    mutable double sample_scale_ = 1.0;  // Input rows per kept row of the last read
     
 public:
     explicit DataReader(char delimiter = ' ') : delimiter_(delimiter) {}
     
-    // Remove surrounding quotes from a field value
-    std::string strip_quotes(const std::string& field) const {
+    // Trim surrounding whitespace from a field
+    static std::string_view trim(std::string_view field) {
+        size_t first = field.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) return {};
+        size_t last = field.find_last_not_of(" \t\r\n");
+        return field.substr(first, last - first + 1);
+    }
+    
+    // Remove surrounding quotes from a field view
+    static std::string_view unquote(std::string_view field) {
         if (field.length() < 2) return field;
         
-        // Check for single or double quotes
         if ((field.front() == '"' && field.back() == '"') ||
             (field.front() == '\'' && field.back() == '\'')) {
             return field.substr(1, field.length() - 2);
@@ -47,61 +114,50 @@ public:
         return field;
     }
     
+    // Remove surrounding quotes from a field value
+    std::string strip_quotes(const std::string& field) const {
+        return std::string(unquote(field));
+    }
+    
     // Split a line into fields based on delimiter
     DataRow split_line(const std::string& line) const {
-        std::vector<std::string> fields;
-        std::stringstream ss(line);
-        std::string field;
-        
-        while (std::getline(ss, field, delimiter_)) {
-            // Trim whitespace
-            field.erase(0, field.find_first_not_of(" \t\r\n"));
-            field.erase(field.find_last_not_of(" \t\r\n") + 1);
+        std::vector<std::string_view> views;
+        split_fields(line, views);
+        return DataRow(views.begin(), views.end());
+    }
+    
+    // Split a line into trimmed, quote-stripped fields without copying them.
+    // The views point into line and are only valid as long as it is.
+    void split_fields(std::string_view line, std::vector<std::string_view>& fields) const {
+        fields.clear();
+        size_t pos = 0;
+        
+        while (pos < line.size()) {
+            size_t next = line.find(delimiter_, pos);
+            if (next == std::string_view::npos) next = line.size();
             
+            std::string_view field = trim(line.substr(pos, next - pos));
             if (!field.empty()) {
                 // Strip quotes if present
-                field = strip_quotes(field);
-                fields.push_back(field);
+                fields.push_back(unquote(field));
             }
+            
+            pos = next + 1;
         }
-        
-        return fields;
     }
     
     // Get field value based on field spec
     std::string get_field_value(const DataRow& row, const FieldSpec& field_spec) const {
-        if (field_spec.is_index) {
-            int index = field_spec.index - 1;  // Convert to 0-based
-            if (index < 0 || index >= static_cast<int>(row.size())) {
-                throw std::runtime_error("Field index " + std::to_string(field_spec.index) + 
-                                        " out of range (1-" + std::to_string(row.size()) + ")");
-            }
-            return row[index];
-        } else {
-            // Look up by field name
-            if (!has_headers_) {
-                throw std::runtime_error("Cannot use field name " + field_spec.name + 
-                                      " when no header row was detected");
-            }
-            
-            auto it = std::find(headers_.begin(), headers_.end(), field_spec.name);
-            if (it == headers_.end()) {
-                throw std::runtime_error("Field name not found in headers: " + field_spec.name);
-            }
-            
-            int index = std::distance(headers_.begin(), it);
-            if (index >= static_cast<int>(row.size())) {
-                throw std::runtime_error("Field index for " + field_spec.name + 
-                                       " out of range (index " + std::to_string(index) + 
-                                       ", row size " + std::to_string(row.size()) + ")");
-            }
-            
-            return row[index];
-        }
+        return row[field_position(field_spec, row.size())];
     }
     
     // Check if a line is likely a header row
     bool is_likely_header(const DataRow& row) const {
+        std::vector<std::string_view> views(row.begin(), row.end());
+        return is_likely_header(views);
+    }
+    
+    bool is_likely_header(const std::vector<std::string_view>& row) const {
         // Skip comment lines
         if (!row.empty() && row[0].length() > 0 && row[0][0] == '#') {
             return false;
@@ -111,14 +167,9 @@ public:
         if (row.size() < 2) return false;
         
         for (const auto& field : row) {
-            try {
-                // Try to parse as number after stripping quotes
-                std::string clean_field = strip_quotes(field);
-                std::stod(clean_field);
-                // If any field is convertible to a number, it's probably not a header
+            // If any field is a number (after stripping quotes), it's probably not a header
+            if (is_number(unquote(field))) {
                 return false;
-            } catch (const std::exception&) {
-                // Not a number, could be a header
             }
         }
         
@@ -135,71 +186,720 @@ public:
         return has_headers_;
     }
     
-    // Read and parse data from stdin according to options
-    template<typename T = double>
-    std::vector<DataPoint<T>> read_data(const Options& options) {
-        std::vector<DataPoint<T>> data_points;
+    // 64-bit identity of a field for distinct counting. Numeric fields are
+    // keyed by value, so "1", "1.0" and "+1e0" are the same key; anything else
+    // by its text (FNV-1a).
+    static uint64_t field_key(std::string_view field) {
+        double number;
+        if (parse_double(field, number) == std::errc{}) {
+            return numeric_key(number);
+        }
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (unsigned char c : field) {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+    
+    // Key of a numeric value; -0 and 0 are one key
+    static uint64_t numeric_key(double number) {
+        if (number == 0) number = 0;
+        return std::bit_cast<uint64_t>(number);
+    }
+    
+    // Count bytes and rows read from now on into stats (nullptr disables)
+    void set_stats(RunStats* stats) {
+        stats_ = stats;
+    }
+    
+    // Input rows each row of the last read stands for: 1 / rate with
+    // --sample, rows seen / reservoir size with --reservoir, 1 otherwise.
+    // Counts and sums binned from the read are scaled up by it.
+    double sample_scale() const {
+        return sample_scale_;
+    }
+    
+    // Read data according to options and call visit(DataPoint<T>) for every
+    // accepted row. Rows whose x or y is outside options.x_range/y_range are
+    // dropped as soon as that field is parsed. Reads options.input_path when
+    // set, stdin otherwise.
+    // Regular files are memory-mapped; other inputs are streamed line by line.
+    // gzip and zstd files are streamed as they are decompressed.
+    template<typename T = double, typename Visitor>
+    void for_each_point(const Options& options, Visitor&& visit) {
+        if (options.input_path.empty()) {
+            for_each_point<T>(std::cin, options, visit);
+        } else if (is_regular_file(options.input_path)) {
+            MappedFile file(options.input_path);
+            if (detect_compression(file.view()) != Compression::None) {
+                DecompressedStream in(std::move(file), options.input_path, static_cast<size_t>(options.threads));
+                for_each_point<T>(in, options, visit);
+                return;
+            }
+            for_each_point<T>(file.view(), options, visit);
+        } else {
+            std::ifstream in(options.input_path);
+            if (!in) {
+                throw std::runtime_error("Cannot open " + options.input_path);
+            }
+            for_each_point<T>(in, options, visit);
+        }
+    }
+    
+    // Parse rows from an in-memory buffer (e.g. a mapped file). The buffer may
+    // be scanned again by later calls, which is how bounds are found in a
+    // separate pass before binning. A columnar table (see columnar.hpp) is
+    // read from its typed columns instead of parsed as text.
+    template<typename T = double, typename Visitor>
+    void for_each_point(std::string_view buffer, const Options& options, Visitor&& visit) {
+        if (is_columnar(buffer)) {
+            ColumnarView table(buffer);
+            resolve_columnar(table, options);
+            if (stats_) stats_->bytes_read += buffer.size();
+            scan_columns<T>(table, 0, table.rows(), visit);
+            return;
+        }
+        parse_rows<T>(read_header(buffer, options), visit);
+    }
+    
+    // Parse rows from a buffer on one thread per visitor. The data after the
+    // header is split at line boundaries into up to visitors.size() chunks of
+    // at least min_chunk_bytes, and each visitor sees only the rows of its own
+    // chunk, so visitors need no locking.
+    template<typename T = double, typename Visitor>
+    void for_each_point_parallel(std::string_view buffer, const Options& options,
+                                 std::vector<Visitor>& visitors, size_t min_chunk_bytes = 1 << 20) {
+        if (is_columnar(buffer)) {
+            // Columnar rows are split into equal row ranges instead of lines
+            ColumnarView table(buffer);
+            resolve_columnar(table, options);
+            if (stats_) stats_->bytes_read += buffer.size();
+            
+            size_t rows = table.rows();
+            size_t n = std::max<size_t>(1, std::min(visitors.size(), buffer.size() / std::max<size_t>(min_chunk_bytes, 1)));
+            if (ordered_sample()) n = 1;
+            run_chunks(n, [&](size_t i) {
+                scan_columns<T>(table, rows * i / n, rows * (i + 1) / n, visitors[i], i);
+            });
+            return;
+        }
+        
+        // A prefix or reservoir depends on the order of all rows: one chunk
+        std::string_view data = read_header(buffer, options);
+        std::vector<std::string_view> chunks = split_lines_evenly(data, ordered_sample() ? 1 : visitors.size(),
+                                                                  min_chunk_bytes);
+        run_chunks(chunks.size(), [&](size_t i) {
+            parse_rows<T>(chunks[i], visitors[i], i);
+        });
+    }
+    
+    // Call on_row(fields) with every field of every data row, after header
+    // detection, for tools that need whole rows rather than selected columns.
+    // Reads options.input_path when set, stdin otherwise.
+    template<typename F>
+    void for_each_record(const Options& options, F&& on_row) {
+        headers_.clear();
+        has_headers_ = false;
+        bool first_line = true;
+        std::vector<std::string_view> row;
+        
+        auto on_line = [&](std::string_view line) {
+            if (line.empty() || line[0] == '#') return;
+            split_fields(line, row);
+            if (first_line) {
+                if (row.empty()) return;
+                first_line = false;
+                if (detect_header(row, options)) return;
+            }
+            on_row(row);
+        };
+        
+        std::unique_ptr<std::istream> file;
+        if (!options.input_path.empty() && is_regular_file(options.input_path)) {
+            MappedFile mapped(options.input_path);
+            if (detect_compression(mapped.view()) == Compression::None) {
+                for_each_line(mapped.view(), on_line);
+                return;
+            }
+            file = std::make_unique<DecompressedStream>(std::move(mapped), options.input_path,
+                                                        static_cast<size_t>(options.threads));
+        } else if (!options.input_path.empty()) {
+            file = std::make_unique<std::ifstream>(options.input_path);
+            if (!*file) {
+                throw std::runtime_error("Cannot open " + options.input_path);
+            }
+        }
+        std::istream& in = file ? *file : std::cin;
         std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            on_line(line);
+        }
+    }
+    
+    // 0-based columns selected by the last input's header (or schema), in order
+    std::vector<size_t> selected_columns() const {
+        std::vector<size_t> columns;
+        for (const auto& [column, slot] : projection_.columns) {
+            if (columns.empty() || columns.back() != column) columns.push_back(column);
+        }
+        return columns;
+    }
+    
+    // Parse columns (0-based, ascending) of every data row in data, which
+    // starts after the header, into one array per column. Fields that are
+    // missing or not numbers become NaN, so every array has one entry per
+    // row. Rows keep their order; chunks are parsed on up to threads threads.
+    std::vector<std::vector<double>> parse_columns(std::string_view data, const std::vector<size_t>& columns,
+                                                   size_t threads, size_t min_chunk_bytes = 1 << 20) const {
+        std::vector<std::string_view> chunks = split_lines_evenly(data, threads, min_chunk_bytes);
+        std::vector<std::vector<std::vector<double>>> parts(chunks.size(),
+                                                            std::vector<std::vector<double>>(columns.size()));
+        
+        run_chunks(chunks.size(), [&](size_t i) {
+            auto& part = parts[i];
+            for_each_line(chunks[i], [&](std::string_view line) {
+                if (line.empty() || line[0] == '#') return;
+                size_t next_column = 0;
+                size_t column = 0;
+                size_t pos = 0;
+                
+                // Same field numbering as project(): blank fields don't count
+                while (next_column < columns.size() && pos < line.size()) {
+                    size_t end = line.find(delimiter_, pos);
+                    if (end == std::string_view::npos) end = line.size();
+                    std::string_view field = trim(line.substr(pos, end - pos));
+                    if (!field.empty()) {
+                        if (columns[next_column] == column) {
+                            double value;
+                            if (parse_double(unquote(field), value) != std::errc{}) {
+                                value = std::numeric_limits<double>::quiet_NaN();
+                            }
+                            part[next_column++].push_back(value);
+                        }
+                        column++;
+                    }
+                    pos = end + 1;
+                }
+                for (; next_column < columns.size(); ++next_column) {
+                    part[next_column].push_back(std::numeric_limits<double>::quiet_NaN());
+                }
+            });
+        });
+        
+        std::vector<std::vector<double>> result = std::move(parts[0]);
+        for (size_t i = 1; i < parts.size(); ++i) {
+            for (size_t c = 0; c < columns.size(); ++c) {
+                result[c].insert(result[c].end(), parts[i][c].begin(), parts[i][c].end());
+            }
+        }
+        return result;
+    }
+    
+    // Resolve a field spec to a 0-based position in a row of row_size fields,
+    // throwing if the row doesn't have it
+    size_t field_index(const FieldSpec& field_spec, size_t row_size) const {
+        return field_position(field_spec, row_size);
+    }
+    
+    // Parse rows from a stream; the line buffer is reused across rows
+    template<typename T = double, typename Visitor>
+    void for_each_point(std::istream& in, const Options& options, Visitor&& visit) {
         bool first_line = true;
+        std::vector<std::string_view> row;
         headers_.clear();
         has_headers_ = false;
         
-        // Read data from stdin
-        while (std::getline(std::cin, line)) {
-            if (line.empty() || (line.length() > 0 && line[0] == '#')) continue;
+        std::string line;
+        uint64_t bytes = 0;
+        std::optional<SampledRows<T>> rows;
+        while (std::getline(in, line)) {
+            bytes += line.size() + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
             
-            try {
-                DataRow row = split_line(line);
+            // Check for header row on first non-empty line
+            if (first_line) {
+                split_fields(line, row);
                 if (row.empty()) continue;
                 
-                // Check for header row on first non-empty line
-                if (first_line) {
-                    // Handle header based on options
-                    if (options.header_mode == Options::HeaderMode::ForceOn) {
-                        // Force using the first row as header
-                        headers_ = row;
-                        has_headers_ = true;
-                        first_line = false;
-                        continue;
-                    } else if (options.header_mode == Options::HeaderMode::ForceOff) {
-                        // Explicitly ignore header
-                        has_headers_ = false;
-                    } else if (is_likely_header(row)) {
-                        // Auto-detect header (default behavior)
-                        headers_ = row;
-                        has_headers_ = true;
-                        first_line = false;
-                        continue;
+                first_line = false;
+                bool is_header = detect_header(row, options);
+                resolve_projection(options);
+                rows.emplace(make_sampler(0));
+                if (is_header) continue;
+            }
+            
+            bool more = sample_row(*rows, visit, [&](auto& to) { return parse_row<T>(line, to); });
+            if (!more) break;
+        }
+        
+        if (stats_) stats_->bytes_read += bytes;
+        if (rows) finish_sample(*rows, visit);
+    }
+    
+    // Detect the header on the first non-empty row of buffer and return the
+    // rest of the buffer, starting with the first data row
+    std::string_view read_header(std::string_view buffer, const Options& options) {
+        headers_.clear();
+        has_headers_ = false;
+        if (stats_) stats_->bytes_read += buffer.size();
+        
+        std::vector<std::string_view> row;
+        size_t pos = 0;
+        while (pos < buffer.size()) {
+            size_t nl = buffer.find('\n', pos);
+            size_t next = nl == std::string_view::npos ? buffer.size() : nl + 1;
+            std::string_view line = buffer.substr(pos, next - pos);
+            
+            if (!line.empty() && line[0] != '#') {
+                split_fields(line, row);
+                if (!row.empty()) {
+                    bool is_header = detect_header(row, options);
+                    resolve_projection(options);
+                    return is_header ? buffer.substr(next) : buffer.substr(pos);
+                }
+            }
+            pos = next;
+        }
+        
+        return buffer.substr(pos);
+    }
+    
+    // Parse every data row in buffer (no header detection), or the sample
+    // of them the options ask for; chunk seeds the sampler. Safe to call
+    // concurrently once the header has been read.
+    template<typename T = double, typename Visitor>
+    void parse_rows(std::string_view buffer, Visitor&& visit, size_t chunk = 0) const {
+        // Tallied locally and flushed once, so threads don't share counters per row
+        SampledRows<T> rows(make_sampler(chunk));
+        const char* p = buffer.data();
+        const char* end = p + buffer.size();
+        while (p < end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            std::string_view line(p, (nl ? nl : end) - p);
+            p = nl ? nl + 1 : end;
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (line.empty() || line[0] == '#') continue;
+            if (!sample_row(rows, visit, [&](auto& to) { return parse_row<T>(line, to); })) break;
+        }
+        finish_sample(rows, visit);
+    }
+    
+    // Read and parse data according to options
+    template<typename T = double>
+    std::vector<DataPoint<T>> read_data(const Options& options) {
+        std::vector<DataPoint<T>> data_points;
+        for_each_point<T>(options, [&](const DataPoint<T>& point) {
+            data_points.push_back(point);
+        });
+        return data_points;
+    }
+
+private:
+    static constexpr size_t NO_FIELD = static_cast<size_t>(-1);
+    
+    // Run work(i) for i in [0, n), each on its own thread when n > 1, and
+    // rethrow the first failure once all have finished
+    template<typename Work>
+    static void run_chunks(size_t n, Work&& work) {
+        if (n == 1) {
+            work(0);
+            return;
+        }
+        
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(n);
+        for (size_t i = 0; i < n; ++i) {
+            workers.emplace_back([&, i]() {
+                try {
+                    work(i);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (const auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+    
+    // Resolve a field spec to a 0-based position in a row of row_size fields,
+    // or NO_FIELD if the row doesn't have it
+    size_t find_field(const FieldSpec& field_spec, size_t row_size) const {
+        if (field_spec.is_index) {
+            int index = field_spec.index - 1;  // Convert to 0-based
+            if (index < 0 || index >= static_cast<int>(row_size)) return NO_FIELD;
+            return static_cast<size_t>(index);
+        }
+        
+        // Look up by field name
+        if (!has_headers_) return NO_FIELD;
+        
+        auto it = std::find(headers_.begin(), headers_.end(), field_spec.name);
+        size_t index = static_cast<size_t>(std::distance(headers_.begin(), it));
+        if (it == headers_.end() || index >= row_size) return NO_FIELD;
+        
+        return index;
+    }
+    
+    // Explain why find_field returned NO_FIELD
+    std::string missing_field_error(const FieldSpec& field_spec, size_t row_size) const {
+        if (field_spec.is_index) {
+            return "Field index " + std::to_string(field_spec.index) + 
+                   " out of range (1-" + std::to_string(row_size) + ")";
+        }
+        if (!has_headers_) {
+            return "Cannot use field name " + field_spec.name + 
+                   " when no header row was detected";
+        }
+        
+        auto it = std::find(headers_.begin(), headers_.end(), field_spec.name);
+        if (it == headers_.end()) {
+            return "Field name not found in headers: " + field_spec.name;
+        }
+        return "Field index for " + field_spec.name + 
+               " out of range (index " + std::to_string(std::distance(headers_.begin(), it)) + 
+               ", row size " + std::to_string(row_size) + ")";
+    }
+    
+    // Resolve a field spec to a 0-based position, throwing if the row doesn't have it
+    size_t field_position(const FieldSpec& field_spec, size_t row_size) const {
+        size_t index = find_field(field_spec, row_size);
+        if (index == NO_FIELD) {
+            throw std::runtime_error(missing_field_error(field_spec, row_size));
+        }
+        return index;
+    }
+    
+    // Resolve the selected fields to column positions. Called once per input,
+    // after header detection, so named fields are looked up only once.
+    void resolve_projection(const Options& options) {
+        projection_ = Projection();
+        
+        auto select = [&](Slot slot, const FieldSpec& field_spec) {
+            size_t index;
+            if (field_spec.is_index) {
+                if (field_spec.index < 1) {
+                    throw std::runtime_error("Field index " + std::to_string(field_spec.index) + 
+                                             " out of range");
+                }
+                index = static_cast<size_t>(field_spec.index - 1);
+            } else {
+                index = find_field(field_spec, headers_.size());
+                if (index == NO_FIELD) {
+                    throw std::runtime_error(missing_field_error(field_spec, headers_.size()));
+                }
+            }
+            projection_.specs[slot] = field_spec;
+            projection_.columns.emplace_back(index, slot);
+        };
+        
+        select(SLOT_X, options.x_field);
+        select(SLOT_Y, options.y_field);
+        
+        // Check if we need a value for aggregation
+        if (options.aggregation.function != AggregationSpec::Function::Count && 
+            options.aggregation.field.has_value()) {
+            select(SLOT_VALUE, *options.aggregation.field);
+        }
+        
+        if (options.time_field) {
+            select(SLOT_TIME, *options.time_field);
+        }
+        
+        projection_.keyed = options.aggregation.function == AggregationSpec::Function::Distinct;
+        projection_.ranges = {options.x_range, options.y_range};
+        
+        sample_rate_ = options.sample;
+        max_rows_ = options.max_rows;
+        reservoir_size_ = options.reservoir;
+        seed_ = options.seed;
+        sample_scale_ = sample_rate_ < 1 ? 1.0 / sample_rate_ : 1.0;
+        
+        std::sort(projection_.columns.begin(), projection_.columns.end());
+    }
+    
+    // Resolve the selected fields against a columnar table's schema; its
+    // column names play the part of the header row
+    void resolve_columnar(const ColumnarView& table, const Options& options) {
+        headers_.clear();
+        has_headers_ = false;
+        for (const auto& column : table.columns()) {
+            headers_.push_back(column.name);
+            if (!column.name.empty()) has_headers_ = true;
+        }
+        if (!has_headers_) headers_.clear();
+        
+        resolve_projection(options);
+        for (const auto& [column, slot] : projection_.columns) {
+            if (column >= table.columns().size()) {
+                throw std::runtime_error(missing_field_error(*projection_.specs[slot], table.columns().size()));
+            }
+            if (!table.stored(column)) {
+                throw std::runtime_error("Column " + std::to_string(column + 1) + " is not stored in the columnar input");
+            }
+        }
+    }
+    
+    // Visit rows [begin, end) of a columnar table, or the sample of them the
+    // options ask for; chunk seeds the sampler. The selected columns are
+    // converted a block at a time, so there is one type dispatch per block
+    // rather than per value. NaN marks a missing value and rejects the row.
+    // x and y are converted first; the other columns of a block whose rows
+    // all fall outside the range filters are never read, and a block the
+    // sampler skips entirely isn't read at all.
+    template<typename T, typename Visitor>
+    void scan_columns(const ColumnarView& table, size_t begin, size_t end, Visitor& visit, size_t chunk = 0) const {
+        constexpr size_t BLOCK = 1024;
+        double values[SLOT_COUNT][BLOCK];
+        bool outside[BLOCK];
+        bool filtered = projection_.ranges[SLOT_X] || projection_.ranges[SLOT_Y];
+        SampledRows<T> rows(make_sampler(chunk));
+        
+        // One row of the block as a point, or why it was rejected
+        auto emit = [&](size_t i, auto& to) {
+            if (filtered && outside[i]) return RowStatus::OutOfRange;
+            for (const auto& [column, slot] : projection_.columns) {
+                // Reported as a bad number, as text rows with an empty field are
+                if (std::isnan(values[slot][i])) return RowStatus::BadNumber;
+            }
+            
+            T x_val = static_cast<T>(values[SLOT_X][i]);
+            T y_val = static_cast<T>(values[SLOT_Y][i]);
+            DataPoint<T> point = projection_.specs[SLOT_VALUE] && !projection_.keyed
+                ? DataPoint<T>(x_val, y_val, static_cast<T>(values[SLOT_VALUE][i]))
+                : DataPoint<T>(x_val, y_val);
+            if (projection_.specs[SLOT_TIME]) {
+                point.time = static_cast<T>(values[SLOT_TIME][i]);
+            }
+            if (projection_.keyed) {
+                point.key = numeric_key(values[SLOT_VALUE][i]);
+            }
+            to(point);
+            return RowStatus::Ok;
+        };
+        
+        for (size_t start = begin; start < end; start += BLOCK) {
+            size_t n = std::min(BLOCK, end - start);
+            if (rows.sampler.skippable() >= n) {
+                rows.sampler.skip(n);
+                rows.skipped += n;
+                continue;
+            }
+            
+            for (const auto& [column, slot] : projection_.columns) {
+                if (slot <= SLOT_Y) table.read(column, start, start + n, values[slot]);
+            }
+            
+            size_t kept = n;
+            if (filtered) {
+                for (size_t i = 0; i < n; ++i) {
+                    double x = values[SLOT_X][i];
+                    double y = values[SLOT_Y][i];
+                    // Missing coordinates are rejected below instead
+                    outside[i] = !std::isnan(x) && !std::isnan(y) && !(in_range(SLOT_X, x) && in_range(SLOT_Y, y));
+                    kept -= outside[i];
+                }
+            }
+            
+            if (kept > 0) {
+                for (const auto& [column, slot] : projection_.columns) {
+                    if (slot > SLOT_Y) table.read(column, start, start + n, values[slot]);
+                }
+            }
+            
+            bool more = true;
+            for (size_t i = 0; i < n && more; ++i) {
+                more = sample_row(rows, visit, [&](auto& to) { return emit(i, to); });
+            }
+            if (!more) break;
+        }
+        
+        finish_sample(rows, visit);
+    }
+    
+    static bool is_blank(std::string_view field) {
+        return field.find_first_not_of(" \t\r\n") == std::string_view::npos;
+    }
+    
+    // True if the sample depends on the order of all rows (a prefix or a
+    // reservoir), so the input can't be split between threads
+    bool ordered_sample() const {
+        return max_rows_ > 0 || reservoir_size_ > 0;
+    }
+    
+    // Sampler for one read; chunk varies the seed between parallel chunks
+    RowSampler make_sampler(size_t chunk) const {
+        if (reservoir_size_ > 0) return RowSampler::reservoir(reservoir_size_, seed_);
+        if (max_rows_ > 0) return RowSampler::prefix(max_rows_);
+        if (sample_rate_ < 1) return RowSampler::bernoulli(sample_rate_, seed_ + 0x9e3779b97f4a7c15ULL * chunk);
+        return RowSampler();
+    }
+    
+    // Ask rows' sampler about the next data row and, if it is kept, parse it
+    // with parse(visitor): straight to visit, or into its reservoir slot.
+    // Returns false once the sampler wants no more rows.
+    template<typename T, typename Visitor, typename Parse>
+    static bool sample_row(SampledRows<T>& rows, Visitor& visit, Parse&& parse) {
+        uint64_t slot = rows.sampler.next();
+        if (slot == RowSampler::SKIP) {
+            rows.skipped++;
+            return true;
+        }
+        if (slot == RowSampler::STOP) return false;
+        if (rows.sampler.mode() != RowSampler::Mode::Reservoir) {
+            rows.counts[static_cast<size_t>(parse(visit))]++;
+            return true;
+        }
+        
+        if (slot == rows.reservoir.size()) rows.reservoir.emplace_back();
+        auto& [status, point] = rows.reservoir[slot];
+        point.reset();
+        auto keep = [&point](const DataPoint<T>& parsed) { point = parsed; };
+        status = parse(keep);
+        return true;
+    }
+    
+    // End of a read: visit the reservoir's rows and record the row counts
+    template<typename T, typename Visitor>
+    void finish_sample(SampledRows<T>& rows, Visitor& visit) const {
+        if (rows.sampler.mode() == RowSampler::Mode::Reservoir) {
+            for (const auto& [status, point] : rows.reservoir) {
+                rows.counts[static_cast<size_t>(status)]++;
+                if (point) visit(*point);
+            }
+            // Rows replaced in the reservoir were sampled out too
+            rows.skipped = rows.sampler.rows_seen() - rows.reservoir.size();
+            sample_scale_ = rows.sampler.scale();
+        }
+        if (stats_) {
+            stats_->add_rows(rows.counts[0], rows.counts[1], rows.counts[2], rows.counts[3]);
+            stats_->rows_sampled_out += rows.skipped;
+        }
+    }
+    
+    // True if the value of slot passes its range filter, if any
+    bool in_range(size_t slot, double value) const {
+        return slot > SLOT_Y || !projection_.ranges[slot] || projection_.ranges[slot]->contains(value);
+    }
+    
+    // Tokenize line only as far as the last selected column, trimming and
+    // unquoting just the selected fields. Blank fields don't count as
+    // columns, matching split_fields. A range-filtered x or y is converted
+    // into values as soon as it is reached, and marked in converted, so a
+    // row outside the range stops before the rest of it is tokenized.
+    // Returns MissingField if the row is too short.
+    RowStatus project(std::string_view line, ProjectedRow& fields, double* values, unsigned& converted) const {
+        const auto& columns = projection_.columns;
+        size_t next_column = 0;
+        size_t column = 0;
+        size_t pos = 0;
+        
+        while (next_column < columns.size() && pos < line.size()) {
+            size_t end = line.find(delimiter_, pos);
+            if (end == std::string_view::npos) end = line.size();
+            std::string_view raw = line.substr(pos, end - pos);
+            
+            if (columns[next_column].first == column) {
+                std::string_view field = trim(raw);
+                if (!field.empty()) {
+                    field = unquote(field);
+                    while (next_column < columns.size() && columns[next_column].first == column) {
+                        Slot slot = columns[next_column++].second;
+                        fields[slot] = field;
+                        // Unparsable fields are left for parse_row to report
+                        if (slot <= SLOT_Y && projection_.ranges[slot] &&
+                            parse_double(field, values[slot]) == std::errc{}) {
+                            if (!in_range(slot, values[slot])) return RowStatus::OutOfRange;
+                            converted |= 1u << slot;
+                        }
                     }
+                    column++;
                 }
-                
-                first_line = false;
-                
-                // Get x and y values
-                std::string x_str = get_field_value(row, options.x_field);
-                std::string y_str = get_field_value(row, options.y_field);
-                
-                T x_val = static_cast<T>(std::stod(x_str));
-                T y_val = static_cast<T>(std::stod(y_str));
-                
-                // Check if we need a value for aggregation
-                if (options.aggregation.function != AggregationSpec::Function::Count && 
-                    options.aggregation.field.has_value()) {
-                    
-                    std::string val_str = get_field_value(row, *options.aggregation.field);
-                    T val = static_cast<T>(std::stod(val_str));
-                    data_points.emplace_back(x_val, y_val, val);
-                } else {
-                    data_points.emplace_back(x_val, y_val);
+            } else if (!is_blank(raw)) {
+                column++;
+            }
+            
+            pos = end + 1;
+        }
+        
+        return next_column == columns.size() ? RowStatus::Ok : RowStatus::MissingField;
+    }
+    
+    // Report a skipped row on stderr
+    void warn_skipped(std::string_view line, Slot slot, RowStatus status, std::string_view field) const {
+        std::string reason;
+        if (status == RowStatus::MissingField) {
+            std::vector<std::string_view> row;
+            split_fields(line, row);
+            reason = missing_field_error(*projection_.specs[slot], row.size());
+        } else {
+            reason = "Invalid number '" + std::string(field) + "'";
+        }
+        // One write per warning so lines from parallel workers don't interleave
+        std::cerr << ("Warning: Skipping line due to error: " + reason + "\n");
+    }
+    
+    // Take row as the header if the header mode calls for it
+    bool detect_header(const std::vector<std::string_view>& row, const Options& options) {
+        // Handle header based on options
+        if (options.header_mode == Options::HeaderMode::ForceOn ||
+            (options.header_mode == Options::HeaderMode::Auto && is_likely_header(row))) {
+            headers_.assign(row.begin(), row.end());
+            has_headers_ = true;
+            return true;
+        }
+        return false;
+    }
+    
+    // Extract and convert the selected fields of one data row and hand them to visit
+    template<typename T, typename Visitor>
+    RowStatus parse_row(std::string_view line, Visitor& visit) const {
+        ProjectedRow fields;
+        double values[SLOT_COUNT];
+        unsigned converted = 0;
+        RowStatus status = project(line, fields, values, converted);
+        if (status == RowStatus::OutOfRange) return status;
+        if (status == RowStatus::MissingField) {
+            // Report the first selected field the row is missing
+            for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+                if (projection_.specs[slot] && fields[slot].data() == nullptr) {
+                    warn_skipped(line, static_cast<Slot>(slot), RowStatus::MissingField, {});
+                    break;
                 }
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Skipping line due to error: " << e.what() << std::endl;
+            }
+            return RowStatus::MissingField;
+        }
+        
+        uint64_t key = 0;
+        for (size_t slot = 0; slot < SLOT_COUNT; ++slot) {
+            if (!projection_.specs[slot] || (converted & (1u << slot))) continue;
+            if (slot == SLOT_VALUE && projection_.keyed) {
+                key = field_key(fields[slot]);
                 continue;
             }
+            if (parse_double(fields[slot], values[slot]) != std::errc{}) {
+                warn_skipped(line, static_cast<Slot>(slot), RowStatus::BadNumber, fields[slot]);
+                return RowStatus::BadNumber;
+            }
         }
         
-        return data_points;
+        T x_val = static_cast<T>(values[SLOT_X]);
+        T y_val = static_cast<T>(values[SLOT_Y]);
+        DataPoint<T> point = projection_.specs[SLOT_VALUE] && !projection_.keyed
+            ? DataPoint<T>(x_val, y_val, static_cast<T>(values[SLOT_VALUE]))
+            : DataPoint<T>(x_val, y_val);
+        if (projection_.specs[SLOT_TIME]) {
+            point.time = static_cast<T>(values[SLOT_TIME]);
+        }
+        point.key = key;
+        visit(point);
+        return RowStatus::Ok;
     }
 };
 
-} // namespace tplt
\ No newline at end of file
+} // namespace tplt
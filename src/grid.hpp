@@ -0,0 +1,154 @@
+#pragma once
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+
+// Allocator returning Alignment-byte aligned storage, so grid rows start on
+// cache-line boundaries and vectorized loops never straddle one needlessly
+template<typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+};
+
+// Dense width x height grid of cells in one aligned, row-major allocation.
+// Rows are padded to a whole number of cache lines; stride() is the distance
+// between rows in cells. grid[y][x] and grid(x, y) address the same cell.
+template<typename V>
+class Grid {
+private:
+    static constexpr size_t ALIGNMENT = 64;
+
+    int width_ = 0;
+    int height_ = 0;
+    size_t stride_ = 0;
+    std::vector<V, AlignedAllocator<V, ALIGNMENT>> cells_;
+
+    // The dimension itself; negative ones are rejected before anything is allocated
+    static int checked_dimension(int dimension) {
+        if (dimension < 0) {
+            throw std::invalid_argument("Grid dimensions must be non-negative");
+        }
+        return dimension;
+    }
+
+    static size_t padded_stride(int width) {
+        size_t per_line = std::max<size_t>(1, ALIGNMENT / sizeof(V));
+        if (ALIGNMENT % sizeof(V) != 0) return static_cast<size_t>(width);
+        return (static_cast<size_t>(width) + per_line - 1) / per_line * per_line;
+    }
+
+public:
+    Grid() = default;
+
+    Grid(int width, int height, const V& init = V{})
+        : width_(checked_dimension(width)), height_(checked_dimension(height)),
+          stride_(padded_stride(width_)), cells_(stride_ * static_cast<size_t>(height_), init) {}
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    size_t stride() const { return stride_; }
+    size_t cells() const { return static_cast<size_t>(width_) * height_; }
+    bool empty() const { return width_ == 0 || height_ == 0; }
+
+    V& operator()(int x, int y) { return cells_[static_cast<size_t>(y) * stride_ + x]; }
+    const V& operator()(int x, int y) const { return cells_[static_cast<size_t>(y) * stride_ + x]; }
+
+    // Row access, so grid[y][x] reads like the nested vectors it replaces
+    V* operator[](int y) { return row(y); }
+    const V* operator[](int y) const { return row(y); }
+
+    V* row(int y) { return cells_.data() + static_cast<size_t>(y) * stride_; }
+    const V* row(int y) const { return cells_.data() + static_cast<size_t>(y) * stride_; }
+
+    // Raw storage, including row padding (stride() * height() cells)
+    V* data() { return cells_.data(); }
+    const V* data() const { return cells_.data(); }
+
+    void fill(const V& value) {
+        std::fill(cells_.begin(), cells_.end(), value);
+    }
+
+    bool same_shape(const Grid& other) const {
+        return width_ == other.width_ && height_ == other.height_;
+    }
+
+    // Combine other into this grid cell by cell: cell = op(cell, other_cell).
+    // Runs over the whole padded buffer in one flat loop.
+    template<typename Op>
+    void merge(const Grid& other, Op op) {
+        if (!same_shape(other)) {
+            throw std::invalid_argument("Cannot merge grids of different dimensions");
+        }
+        V* dst = cells_.data();
+        const V* src = other.cells_.data();
+        for (size_t i = 0, n = cells_.size(); i < n; ++i) {
+            dst[i] = op(dst[i], src[i]);
+        }
+    }
+
+    Grid& operator+=(const Grid& other) {
+        merge(other, [](const V& a, const V& b) { return a + b; });
+        return *this;
+    }
+
+    // Fold every cell (padding excluded) into acc with op(acc, cell)
+    template<typename T, typename Op>
+    T reduce(T acc, Op op) const {
+        for (int y = 0; y < height_; ++y) {
+            const V* r = row(y);
+            for (int x = 0; x < width_; ++x) {
+                acc = op(acc, r[x]);
+            }
+        }
+        return acc;
+    }
+
+    // Copy of the grid with every cell converted to U
+    template<typename U>
+    Grid<U> convert() const {
+        Grid<U> out(width_, height_);
+        for (int y = 0; y < height_; ++y) {
+            const V* src = row(y);
+            U* dst = out.row(y);
+            for (int x = 0; x < width_; ++x) {
+                dst[x] = static_cast<U>(src[x]);
+            }
+        }
+        return out;
+    }
+
+    // Smallest and largest cell values; the grid must not be empty
+    std::pair<V, V> min_max() const {
+        std::pair<V, V> bounds(row(0)[0], row(0)[0]);
+        return reduce(bounds, [](std::pair<V, V> acc, const V& v) {
+            acc.first = std::min(acc.first, v);
+            acc.second = std::max(acc.second, v);
+            return acc;
+        });
+    }
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include "accumulator.hpp"
+#include "byte_io.hpp"
+#include "grid.hpp"
+#include "heatmap_builder.hpp"
+
+// Aggregated grid saved before finalizing (--emit-grid), so grids built
+// from different shards of the data can be merged exactly (tplt merge) and
+// only the grid, not the rows, has to be shipped. Layout (native-endian):
+//
+//   char[8]  magic "TPLTGRD\0"
+//   uint32   version (1)
+//   uint8    aggregation (AggregateFunc), then 3 reserved bytes
+//   double   quantile (for p-aggregations)
+//   uint32   width, height
+//   double   min_x, max_x, min_y, max_y (binning bounds)
+//   uint64   points binned
+//   uint64   byte length of the cell states
+//   cell states, row by row
+//
+// A cell state is its accumulator's State: raw bytes for plain states (sums,
+// counts, Welford triples), the state's own encode() for sketches.
+
+struct GridFileHeader {
+    AggregateFunc func = AggregateFunc::Count;
+    double quantile = 0.5;
+    int width = 0;
+    int height = 0;
+    PointBounds bounds;
+    uint64_t points = 0;
+};
+
+namespace grid_file_detail {
+    constexpr char MAGIC[8] = {'T', 'P', 'L', 'T', 'G', 'R', 'D', '\0'};
+    constexpr uint32_t VERSION = 1;
+
+    template<typename State>
+    void encode_state(std::string& out, const State& state) {
+        if constexpr (std::is_trivially_copyable_v<State>) {
+            put_bytes(out, state);
+        } else {
+            state.encode(out);
+        }
+    }
+
+    template<typename State>
+    State decode_state(std::string_view& in) {
+        if constexpr (std::is_trivially_copyable_v<State>) {
+            return take_bytes<State>(in);
+        } else {
+            return State::decode(in);
+        }
+    }
+
+    // Fewest bytes a cell state of aggregation func encodes to: an empty
+    // sketch is its smallest encoding
+    inline size_t min_state_size(AggregateFunc func) {
+        return with_accumulator(func, [](auto acc) -> size_t {
+            using State = typename decltype(acc)::State;
+            if constexpr (std::is_trivially_copyable_v<State>) {
+                return sizeof(State);
+            } else {
+                std::string bytes;
+                encode_state(bytes, acc.init());
+                return bytes.size();
+            }
+        });
+    }
+}
+
+// True if buffer starts like a grid file
+inline bool is_grid_file(std::string_view buffer) {
+    return buffer.size() >= sizeof(grid_file_detail::MAGIC) &&
+           std::memcmp(buffer.data(), grid_file_detail::MAGIC, sizeof(grid_file_detail::MAGIC)) == 0;
+}
+
+// Write binner's cell states, tagged with the aggregation that built them
+template<Accumulator Acc>
+void write_grid(std::ostream& out, const HeatmapBinner<Acc>& binner, AggregateFunc func, double quantile) {
+    using namespace grid_file_detail;
+    std::string cells;
+    const auto& states = binner.states();
+    for (int y = 0; y < binner.height(); y++) {
+        for (int x = 0; x < binner.width(); x++) {
+            encode_state(cells, states(x, y));
+        }
+    }
+
+    PointBounds bounds = binner.bounds();
+    std::string header(MAGIC, sizeof(MAGIC));
+    put_bytes(header, VERSION);
+    put_bytes(header, static_cast<uint8_t>(func));
+    header.append(3, '\0');
+    put_bytes(header, quantile);
+    put_bytes(header, static_cast<uint32_t>(binner.width()));
+    put_bytes(header, static_cast<uint32_t>(binner.height()));
+    put_bytes(header, bounds.min_x);
+    put_bytes(header, bounds.max_x);
+    put_bytes(header, bounds.min_y);
+    put_bytes(header, bounds.max_y);
+    put_bytes(header, static_cast<uint64_t>(binner.points()));
+    put_bytes(header, static_cast<uint64_t>(cells.size()));
+
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(cells.data(), static_cast<std::streamsize>(cells.size()));
+    if (!out) {
+        throw std::runtime_error("Failed writing grid output");
+    }
+}
+
+// Read the header of a grid file; in is left at the cell states
+inline GridFileHeader read_grid_header(std::string_view& in) {
+    using namespace grid_file_detail;
+    if (!is_grid_file(in)) {
+        throw std::runtime_error("Not a grid file");
+    }
+    in.remove_prefix(sizeof(MAGIC));
+    uint32_t version = take_bytes<uint32_t>(in);
+    if (version != VERSION) {
+        throw std::runtime_error("Unsupported grid file version " + std::to_string(version));
+    }
+
+    GridFileHeader header;
+    uint8_t func = take_bytes<uint8_t>(in);
+    if (func > static_cast<uint8_t>(AggregateFunc::Distinct)) {
+        throw std::runtime_error("Unknown aggregation in grid file");
+    }
+    header.func = static_cast<AggregateFunc>(func);
+    in.remove_prefix(std::min<size_t>(3, in.size()));
+    header.quantile = take_bytes<double>(in);
+    uint32_t width = take_bytes<uint32_t>(in);
+    uint32_t height = take_bytes<uint32_t>(in);
+    if (width < 1 || height < 1 || width > (1u << 16) || height > (1u << 16)) {
+        throw std::runtime_error("Invalid grid dimensions in grid file");
+    }
+    header.width = static_cast<int>(width);
+    header.height = static_cast<int>(height);
+    header.bounds.min_x = take_bytes<double>(in);
+    header.bounds.max_x = take_bytes<double>(in);
+    header.bounds.min_y = take_bytes<double>(in);
+    header.bounds.max_y = take_bytes<double>(in);
+    header.points = take_bytes<uint64_t>(in);
+    uint64_t cell_bytes = take_bytes<uint64_t>(in);
+    // Checked here, before a reader allocates width x height cells
+    uint64_t min_cell_bytes = static_cast<uint64_t>(width) * height * min_state_size(header.func);
+    if (cell_bytes != in.size() || cell_bytes < min_cell_bytes) {
+        throw std::runtime_error("Grid file size doesn't match its header");
+    }
+    return header;
+}
+
+// Read a whole grid file into a binner for accumulator acc, which must be
+// the one named in the header
+template<Accumulator Acc>
+HeatmapBinner<Acc> read_grid(std::string_view buffer, Acc acc = Acc{}) {
+    using State = typename Acc::State;
+    GridFileHeader header = read_grid_header(buffer);
+
+    Grid<State> states(header.width, header.height, acc.init());
+    for (int y = 0; y < header.height; y++) {
+        for (int x = 0; x < header.width; x++) {
+            states(x, y) = grid_file_detail::decode_state<State>(buffer);
+        }
+    }
+    if (!buffer.empty()) {
+        throw std::runtime_error("Trailing data in grid file");
+    }
+
+    HeatmapBinner<Acc> binner(header.width, header.height, header.bounds.min_x, header.bounds.max_x,
+                              header.bounds.min_y, header.bounds.max_y, acc);
+    binner.merge_states(states, header.points);
+    return binner;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "accumulator.hpp"
+#include "byte_io.hpp"
+#include "grid_file.hpp"
+#include "heatmap_builder.hpp"
+
+// Multi-resolution pyramid of one aggregation (--pyramid, tplt view). Level 0
+// is a fine base grid; each level above merges 2x2 blocks of cell states of
+// the one below, so every level holds exact states (Avg keeps sum and count).
+// A view of any size or sub-rectangle is drawn from the coarsest level whose
+// cells are still well below the view's, without rescanning the input.
+//
+// Level k cell (i, j) covers base cells [i*2^k, (i+1)*2^k) x [j*2^k, (j+1)*2^k).
+// Each level is a HeatmapBinner whose bounds give it exactly that geometry, and
+// is saved as a grid file. Layout (native-endian):
+//
+//   char[8]  magic "TPLTPYR\0"
+//   uint32   version (1)
+//   uint32   number of levels
+//   per level, base first: uint64 byte length, then the level's grid file
+
+namespace grid_pyramid_detail {
+    constexpr char MAGIC[8] = {'T', 'P', 'L', 'T', 'P', 'Y', 'R', '\0'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t MAX_LEVELS = 64;
+
+    // View cells span at least this many level cells per axis, so a level
+    // cell straddling a view cell edge misplaces at most 1/8 of a cell
+    constexpr double OVERSAMPLE = 8;
+}
+
+// True if buffer starts like a pyramid file
+inline bool is_pyramid_file(std::string_view buffer) {
+    return buffer.size() >= sizeof(grid_pyramid_detail::MAGIC) &&
+           std::memcmp(buffer.data(), grid_pyramid_detail::MAGIC, sizeof(grid_pyramid_detail::MAGIC)) == 0;
+}
+
+// Split a pyramid file into its levels' grid files, base first
+inline std::vector<std::string_view> pyramid_levels(std::string_view in) {
+    using namespace grid_pyramid_detail;
+    if (!is_pyramid_file(in)) {
+        throw std::runtime_error("Not a pyramid file");
+    }
+    in.remove_prefix(sizeof(MAGIC));
+    uint32_t version = take_bytes<uint32_t>(in);
+    if (version != VERSION) {
+        throw std::runtime_error("Unsupported pyramid file version " + std::to_string(version));
+    }
+    uint32_t count = take_bytes<uint32_t>(in);
+    if (count < 1 || count > MAX_LEVELS) {
+        throw std::runtime_error("Invalid level count in pyramid file");
+    }
+
+    std::vector<std::string_view> levels;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t length = take_bytes<uint64_t>(in);
+        if (length > in.size()) {
+            throw std::runtime_error("Truncated pyramid file");
+        }
+        levels.push_back(in.substr(0, length));
+        in.remove_prefix(length);
+    }
+    if (!in.empty()) {
+        throw std::runtime_error("Trailing data in pyramid file");
+    }
+    return levels;
+}
+
+// Header of a pyramid file's base level (aggregation, base size and bounds)
+inline GridFileHeader read_pyramid_header(std::string_view buffer) {
+    std::string_view base = pyramid_levels(buffer).front();
+    return read_grid_header(base);
+}
+
+template<Accumulator Acc>
+class GridPyramid {
+public:
+    using State = typename Acc::State;
+
+private:
+    std::vector<HeatmapBinner<Acc>> levels_;
+    double step_x_;     // Base cell size
+    double step_y_;
+    PointBounds bounds_;  // Base binning bounds
+
+    explicit GridPyramid(std::vector<HeatmapBinner<Acc>> levels) : levels_(std::move(levels)) {
+        const HeatmapBinner<Acc>& base = levels_.front();
+        if (base.width() < 2 || base.height() < 2) {
+            throw std::invalid_argument("A pyramid base needs at least 2x2 cells");
+        }
+        bounds_ = base.bounds();
+        step_x_ = (bounds_.max_x - bounds_.min_x) / (base.width() - 1);
+        step_y_ = (bounds_.max_y - bounds_.min_y) / (base.height() - 1);
+    }
+
+    // Level k + 1 from level k: 2x2 blocks of cells merged into one
+    HeatmapBinner<Acc> coarsen(const HeatmapBinner<Acc>& fine, int k) const {
+        int width = (fine.width() + 1) / 2;
+        int height = (fine.height() + 1) / 2;
+        double step_x = std::ldexp(step_x_, k + 1);
+        double step_y = std::ldexp(step_y_, k + 1);
+        HeatmapBinner<Acc> coarse(width, height, bounds_.min_x, bounds_.min_x + (width - 1) * step_x,
+                                  bounds_.min_y, bounds_.min_y + (height - 1) * step_y, fine.accumulator());
+
+        const Acc& acc = fine.accumulator();
+        Grid<State> states(width, height, acc.init());
+        for (int y = 0; y < fine.height(); y++) {
+            for (int x = 0; x < fine.width(); x++) {
+                acc.merge(states(x / 2, y / 2), fine.states()(x, y));
+            }
+        }
+        coarse.merge_states(states, fine.points());
+        return coarse;
+    }
+
+    // Coordinate standing in for every point of a level cell: its center,
+    // except that the cell holding the bound max maps to the max itself,
+    // mirroring exact binning where only the max reaches the last cell
+    static double representative(int i, double origin, double step, double max) {
+        double low = origin + i * step;
+        if (max >= low && max < low + step) return max;
+        return std::clamp(low + 0.5 * step, origin, max);
+    }
+
+public:
+    // Pyramid over a base grid of at least 2x2 cells, coarsened until a
+    // single cell remains
+    explicit GridPyramid(HeatmapBinner<Acc> base) : GridPyramid(std::vector<HeatmapBinner<Acc>>{std::move(base)}) {
+        while (levels_.back().width() > 1 || levels_.back().height() > 1) {
+            levels_.push_back(coarsen(levels_.back(), static_cast<int>(levels_.size()) - 1));
+        }
+    }
+
+    size_t levels() const { return levels_.size(); }
+    const HeatmapBinner<Acc>& level(size_t k) const { return levels_[k]; }
+    const HeatmapBinner<Acc>& base() const { return levels_.front(); }
+
+    // Points binned into the base
+    size_t points() const { return levels_.front().points(); }
+
+    // Coarsest level fine enough for a width x height view over region
+    size_t level_for(int width, int height, const PointBounds& region) const {
+        using grid_pyramid_detail::OVERSAMPLE;
+        double cell_x = (region.max_x - region.min_x) / std::max(width - 1, 1) / OVERSAMPLE;
+        double cell_y = (region.max_y - region.min_y) / std::max(height - 1, 1) / OVERSAMPLE;
+        size_t k = 0;
+        while (k + 1 < levels_.size() &&
+               std::ldexp(step_x_, static_cast<int>(k) + 1) <= cell_x * (1 + 1e-9) &&
+               std::ldexp(step_y_, static_cast<int>(k) + 1) <= cell_y * (1 + 1e-9)) {
+            k++;
+        }
+        return k;
+    }
+
+    // Width x height grid over region (e.g. a zoomed-in part of the bounds),
+    // merged from the cell states of level level_for(). Each level cell goes
+    // to the view cell containing its representative point; cells outside
+    // the region are left out. The view's points() is zero, since a level
+    // doesn't record how many points of a cell fall inside the region.
+    HeatmapBinner<Acc> view(int width, int height, const PointBounds& region) const {
+        const Acc& acc = levels_.front().accumulator();
+        HeatmapBinner<Acc> out(width, height, region.min_x, region.max_x, region.min_y, region.max_y, acc);
+        PointBounds area = out.bounds();
+
+        size_t k = level_for(width, height, area);
+        const HeatmapBinner<Acc>& level = levels_[k];
+        double step_x = std::ldexp(step_x_, static_cast<int>(k));
+        double step_y = std::ldexp(step_y_, static_cast<int>(k));
+
+        // Only the level cells overlapping the region
+        auto cell = [](double v, double origin, double step, int cells) {
+            return static_cast<int>(std::clamp(std::floor((v - origin) / step), 0.0, cells - 1.0));
+        };
+        int x0 = cell(area.min_x, bounds_.min_x, step_x, level.width());
+        int x1 = cell(area.max_x, bounds_.min_x, step_x, level.width());
+        int y0 = cell(area.min_y, bounds_.min_y, step_y, level.height());
+        int y1 = cell(area.max_y, bounds_.min_y, step_y, level.height());
+
+        for (int y = y0; y <= y1; y++) {
+            double cy = representative(y, bounds_.min_y, step_y, bounds_.max_y);
+            for (int x = x0; x <= x1; x++) {
+                double cx = representative(x, bounds_.min_x, step_x, bounds_.max_x);
+                if (out.contains(cx, cy)) {
+                    out.merge_cell(cx, cy, level.states()(x, y));
+                }
+            }
+        }
+        return out;
+    }
+
+    // Write every level, tagged with the aggregation that built them
+    void write(std::ostream& out, AggregateFunc func, double quantile) const {
+        using namespace grid_pyramid_detail;
+        std::string header(MAGIC, sizeof(MAGIC));
+        put_bytes(header, VERSION);
+        put_bytes(header, static_cast<uint32_t>(levels_.size()));
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        for (const auto& level : levels_) {
+            std::ostringstream grid;
+            write_grid(grid, level, func, quantile);
+            std::string bytes = grid.str();
+            std::string length;
+            put_bytes(length, static_cast<uint64_t>(bytes.size()));
+            out.write(length.data(), static_cast<std::streamsize>(length.size()));
+            out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        if (!out) {
+            throw std::runtime_error("Failed writing pyramid output");
+        }
+    }
+
+    // Read a pyramid file for accumulator acc, which must be the one named
+    // in its header
+    static GridPyramid read(std::string_view buffer, Acc acc = Acc{}) {
+        std::vector<std::string_view> files = pyramid_levels(buffer);
+        GridFileHeader base = read_pyramid_header(buffer);
+        std::vector<HeatmapBinner<Acc>> levels;
+        for (std::string_view file : files) {
+            std::string_view view = file;
+            GridFileHeader header = read_grid_header(view);
+            if (header.func != base.func || header.quantile != base.quantile) {
+                throw std::runtime_error("Pyramid levels were built with different aggregations");
+            }
+            levels.push_back(read_grid<Acc>(file, acc));
+        }
+
+        for (size_t k = 1; k < levels.size(); ++k) {
+            if (levels[k].width() != (levels[k - 1].width() + 1) / 2 ||
+                levels[k].height() != (levels[k - 1].height() + 1) / 2) {
+                throw std::runtime_error("Pyramid levels don't halve in size");
+            }
+        }
+        return GridPyramid(std::move(levels));
+    }
+};
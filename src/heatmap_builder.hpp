@@ -6,6 +6,12 @@
 #include <algorithm>
 #include <cmath>
 #include <type_traits>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <stdexcept>
+#include "grid.hpp"
+#include "accumulator.hpp"
 
 // Template concept for numeric types
 template<typename T>
@@ -17,23 +23,653 @@ U map_range(T value, T in_min, T in_max, U out_min, U out_max) {
     return static_cast<U>((value - in_min) * (out_max - out_min) / (in_max - in_min) + out_min);
 }
 
-// Enum for aggregation functions
-enum class AggregateFunc {
-    Sum,    // Sum of all values
-    Avg,    // Average of all values
-    Count   // Number of values (default)
+// Running min/max of point coordinates, used to derive binning bounds
+struct PointBounds {
+    double min_x = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    double min_y = std::numeric_limits<double>::max();
+    double max_y = std::numeric_limits<double>::lowest();
+
+    void add(double x, double y) {
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+
+    void merge(const PointBounds& other) {
+        min_x = std::min(min_x, other.min_x);
+        max_x = std::max(max_x, other.max_x);
+        min_y = std::min(min_y, other.min_y);
+        max_y = std::max(max_y, other.max_y);
+    }
+
+    bool empty() const {
+        return min_x > max_x;
+    }
+};
+
+// Streaming heatmap accumulator over fixed bounds. Points are binned as they
+// arrive, so memory is proportional to the grid rather than to the input.
+// Each cell holds the state of the accumulator Acc.
+template<Accumulator Acc>
+class HeatmapBinner {
+public:
+    using State = typename Acc::State;
+    using Input = accumulator_input_t<Acc>;
+    using Result = typename Acc::Result;
+
+private:
+    Acc acc_;
+    int width_;
+    int height_;
+    double min_x_, max_x_;
+    double min_y_, max_y_;
+    Grid<State> cells_;
+    size_t points_ = 0;
+
+    // Grid cell (column, row) for the point (x, y)
+    std::pair<int, int> cell_of(double x, double y) const {
+        // Map the point to the heatmap grid
+        int cell_x = static_cast<int>(map_range(x, min_x_, max_x_, 0.0, static_cast<double>(width_ - 1)));
+        int cell_y = static_cast<int>(map_range(y, min_y_, max_y_, 0.0, static_cast<double>(height_ - 1)));
+
+        // Ensure we're within bounds
+        cell_x = std::clamp(cell_x, 0, width_ - 1);
+        cell_y = std::clamp(cell_y, 0, height_ - 1);
+
+        return {cell_x, cell_y};
+    }
+
+public:
+    HeatmapBinner(int width, int height, double min_x, double max_x, double min_y, double max_y,
+                  Acc acc = Acc{})
+        : acc_(acc), width_(width), height_(height),
+          min_x_(min_x), max_x_(max_x), min_y_(min_y), max_y_(max_y),
+          cells_(width, height, acc.init()) {
+        // Special case: all x or y values are the same
+        if (min_x_ == max_x_) max_x_ = min_x_ + 1;
+        if (min_y_ == max_y_) max_y_ = min_y_ + 1;
+    }
+
+    // True if the point lies within the binning bounds (inclusive)
+    bool contains(double x, double y) const {
+        return x >= min_x_ && x <= max_x_ && y >= min_y_ && y <= max_y_;
+    }
+
+    // Add a point without a value (counts it)
+    void add(double x, double y) {
+        add(x, y, Input{1});
+    }
+
+    // Add a point with a value, aggregated by the accumulator
+    void add(double x, double y, Input v) {
+        auto [cell_x, cell_y] = cell_of(x, y);
+        acc_.add(cells_(cell_x, cell_y), v);
+        points_++;
+    }
+
+    // Merge another binner's cells into this one. Both must share dimensions
+    // and bounds, e.g. partial grids built by parallel workers.
+    void merge(const HeatmapBinner& other) {
+        if (!cells_.same_shape(other.cells_)) {
+            throw std::invalid_argument("Cannot merge heatmaps of different dimensions");
+        }
+        State* dst = cells_.data();
+        const State* src = other.cells_.data();
+        for (size_t i = 0, n = cells_.stride() * height_; i < n; ++i) {
+            acc_.merge(dst[i], src[i]);
+        }
+        points_ += other.points_;
+    }
+
+    // Merge a pre-aggregated cell state into the cell containing (x, y).
+    // Doesn't change points(); the caller accounts for the points it holds.
+    void merge_cell(double x, double y, const State& state) {
+        auto [cell_x, cell_y] = cell_of(x, y);
+        acc_.merge(cells_(cell_x, cell_y), state);
+    }
+
+    // Merge a grid of cell states of the same dimensions, holding points
+    // points, cell by cell (e.g. one read back from a grid file)
+    void merge_states(const Grid<State>& states, size_t points) {
+        if (!cells_.same_shape(states)) {
+            throw std::invalid_argument("Cannot merge heatmaps of different dimensions");
+        }
+        for (int y = 0; y < height_; y++) {
+            State* dst = cells_.row(y);
+            const State* src = states.row(y);
+            for (int x = 0; x < width_; x++) {
+                acc_.merge(dst[x], src[x]);
+            }
+        }
+        points_ += points;
+    }
+
+    // Count points that were merged in through merge_cell
+    void count_points(size_t points) { points_ += points; }
+
+    // Number of points binned so far
+    size_t points() const { return points_; }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const Acc& accumulator() const { return acc_; }
+    const Grid<State>& states() const { return cells_; }
+
+    // Binning bounds (after widening an empty range)
+    PointBounds bounds() const {
+        PointBounds bounds;
+        bounds.add(min_x_, min_y_);
+        bounds.add(max_x_, max_y_);
+        return bounds;
+    }
+
+    // Drop every binned point, keeping dimensions and bounds
+    void clear() {
+        cells_.fill(acc_.init());
+        points_ = 0;
+    }
+
+    // Finalized heatmap
+    Grid<Result> result() const {
+        Grid<Result> heatmap(width_, height_);
+        for (int y = 0; y < height_; y++) {
+            const State* states = cells_.row(y);
+            Result* out = heatmap.row(y);
+            for (int x = 0; x < width_; x++) {
+                out[x] = acc_.finalize(states[x]);
+            }
+        }
+        return heatmap;
+    }
+};
+
+// Scale a sampled heatmap of counts or sums (see scales_with_rows) up to an
+// estimate of the whole input's: factor is the input rows each sampled row
+// stands for. Counts stay whole numbers.
+template<Numeric T>
+void scale_to_input(Grid<T>& heatmap, double factor) {
+    if (factor == 1.0) return;
+    for (int y = 0; y < heatmap.height(); y++) {
+        T* out = heatmap.row(y);
+        for (int x = 0; x < heatmap.width(); x++) {
+            if constexpr (std::is_integral_v<T>) {
+                out[x] = static_cast<T>(std::llround(out[x] * factor));
+            } else {
+                out[x] = static_cast<T>(out[x] * factor);
+            }
+        }
+    }
+}
+
+// Relative standard error, in percent, of each cell's scaled-up count when
+// each input row was sampled with probability 1 / factor: sqrt((1 - p) / n)
+// for n sampled rows. A fixed-size uniform sample has nearly the same error.
+// Cells without sampled rows have no estimate and show 0.
+template<Numeric T>
+Grid<double> sampling_error(const Grid<T>& counts, double factor) {
+    double p = 1.0 / factor;
+    Grid<double> error(counts.width(), counts.height());
+    for (int y = 0; y < counts.height(); y++) {
+        const T* in = counts.row(y);
+        double* out = error.row(y);
+        for (int x = 0; x < counts.width(); x++) {
+            double n = static_cast<double>(in[x]);
+            out[x] = n > 0 ? 100.0 * std::sqrt(std::max(1.0 - p, 0.0) / n) : 0.0;
+        }
+    }
+    return error;
+}
+
+// Streaming heatmap accumulator for inputs whose bounds are unknown and which
+// can't be rescanned (pipes). The first points are buffered to find an initial
+// range; after that points are binned into a fine grid (resolution x the
+// output size per axis) whose range doubles whenever a point falls outside,
+// merging adjacent bins pairwise. Memory stays constant however long the input
+// runs. result() reduces the fine grid onto the requested width x height over
+// the exact data bounds. Fine cells rarely line up with output cells, so
+// splittable accumulators (counts, sums, means) spread each fine cell over the
+// output cells it overlaps in proportion to the overlap; others go whole to
+// the output cell holding the fine cell's center. Points on the maximum of an
+// axis, which exact binning alone puts in the last output column or row, are
+// kept apart from the fine grid until a larger value arrives. Inputs that fit
+// in the warm-up buffer are binned exactly.
+template<Accumulator Acc>
+class AdaptiveHeatmapBinner {
+public:
+    using State = typename Acc::State;
+    using Input = accumulator_input_t<Acc>;
+    using Result = typename Acc::Result;
+
+private:
+    // One axis of the fine grid: bin i covers [origin + i*step, origin + (i+1)*step)
+    struct Axis {
+        double origin = 0.0;
+        double step = 1.0;
+        int bins = 1;
+        bool fixed = false;     // Bounds given by the caller; never grows
+
+        void init(double min, double max, int n) {
+            bins = n;
+            origin = min;
+            double span = max > min ? max - min : 1.0;
+            // Pad slightly so that max itself falls inside the last bin
+            step = span / bins * (1.0 + 1e-9);
+        }
+
+        int cell(double v) const {
+            return static_cast<int>(std::floor((v - origin) / step));
+        }
+    };
+
+    // Share [from, to) of a fine bin's points that falls in output cell `cell`
+    struct Piece {
+        int cell;
+        double from;
+        double to;
+    };
+
+    // Pieces of every fine bin of one axis: bin i owns pieces[first[i], first[i + 1])
+    struct AxisPieces {
+        std::vector<Piece> pieces;
+        std::vector<size_t> first;
+    };
+
+    struct Pending {
+        double x;
+        double y;
+        Input v;
+    };
+
+    Acc acc_;
+    int width_;
+    int height_;
+    int fine_width_;
+    int fine_height_;
+    size_t warmup_;
+
+    std::vector<Pending> pending_;  // Warm-up buffer, released once gridded
+    bool gridded_ = false;
+    Axis axis_x_;
+    Axis axis_y_;
+    std::optional<std::pair<double, double>> fixed_x_;
+    std::optional<std::pair<double, double>> fixed_y_;
+    Grid<State> cells_;
+    std::vector<State> max_x_states_;   // Points with x on the maximum, per fine row
+    std::vector<State> max_y_states_;   // Points with y on the maximum, per fine column
+    State max_xy_state_;                // Points on both maxima
+    PointBounds bounds_;
+    size_t points_ = 0;
+
+    // Largest coordinate of each axis on the output grid
+    double edge_x() const { return fixed_x_ ? fixed_x_->second : bounds_.max_x; }
+    double edge_y() const { return fixed_y_ ? fixed_y_->second : bounds_.max_y; }
+
+    // Double the range of one axis towards v, merging bins pairwise
+    void grow(bool along_x, bool towards_low) {
+        Axis& axis = along_x ? axis_x_ : axis_y_;
+        int shift = towards_low ? axis.bins : 0;
+
+        Grid<State> cells(fine_width_, fine_height_, acc_.init());
+        for (int y = 0; y < fine_height_; y++) {
+            for (int x = 0; x < fine_width_; x++) {
+                int nx = along_x ? (x + shift) / 2 : x;
+                int ny = along_x ? y : (y + shift) / 2;
+                acc_.merge(cells(nx, ny), cells_(x, y));
+            }
+        }
+        cells_ = std::move(cells);
+
+        // The maximum strip running along the grown axis merges the same way
+        std::vector<State>& strip = along_x ? max_y_states_ : max_x_states_;
+        std::vector<State> merged(strip.size(), acc_.init());
+        for (size_t i = 0; i < strip.size(); i++) {
+            acc_.merge(merged[(i + shift) / 2], strip[i]);
+        }
+        strip = std::move(merged);
+
+        if (towards_low) {
+            axis.origin -= axis.bins * axis.step;
+        }
+        axis.step *= 2;
+    }
+
+    // Fine cell (column, row) for (x, y), growing the grid until it fits
+    std::pair<int, int> fine_cell(double x, double y) {
+        int cx;
+        while (true) {
+            cx = axis_x_.cell(x);
+            if (axis_x_.fixed || (cx >= 0 && cx < axis_x_.bins)) break;
+            grow(true, cx < 0);
+        }
+        int cy;
+        while (true) {
+            cy = axis_y_.cell(y);
+            if (axis_y_.fixed || (cy >= 0 && cy < axis_y_.bins)) break;
+            grow(false, cy < 0);
+        }
+        cx = std::clamp(cx, 0, fine_width_ - 1);
+        cy = std::clamp(cy, 0, fine_height_ - 1);
+        return {cx, cy};
+    }
+
+    void bin(double x, double y, Input v) {
+        auto [cx, cy] = fine_cell(x, y);
+        bool on_max_x = x == edge_x();
+        bool on_max_y = y == edge_y();
+        if (on_max_x && on_max_y) {
+            acc_.add(max_xy_state_, v);
+        } else if (on_max_x) {
+            acc_.add(max_x_states_[cy], v);
+        } else if (on_max_y) {
+            acc_.add(max_y_states_[cx], v);
+        } else {
+            acc_.add(cells_(cx, cy), v);
+        }
+    }
+
+    // The x maximum is about to grow: points on the old one become ordinary
+    // fine grid points
+    void release_max_x() {
+        int cx = std::clamp(axis_x_.cell(bounds_.max_x), 0, fine_width_ - 1);
+        for (int y = 0; y < fine_height_; y++) {
+            acc_.merge(cells_(cx, y), max_x_states_[y]);
+            max_x_states_[y] = acc_.init();
+        }
+        acc_.merge(max_y_states_[cx], max_xy_state_);
+        max_xy_state_ = acc_.init();
+    }
+
+    void release_max_y() {
+        int cy = std::clamp(axis_y_.cell(bounds_.max_y), 0, fine_height_ - 1);
+        for (int x = 0; x < fine_width_; x++) {
+            acc_.merge(cells_(x, cy), max_y_states_[x]);
+            max_y_states_[x] = acc_.init();
+        }
+        acc_.merge(max_x_states_[cy], max_xy_state_);
+        max_xy_state_ = acc_.init();
+    }
+
+    // Switch from the warm-up buffer to the fine grid
+    void start_grid() {
+        if (fixed_x_) {
+            axis_x_.init(fixed_x_->first, fixed_x_->second, fine_width_);
+            axis_x_.fixed = true;
+        } else {
+            axis_x_.init(bounds_.min_x, bounds_.max_x, fine_width_);
+        }
+        if (fixed_y_) {
+            axis_y_.init(fixed_y_->first, fixed_y_->second, fine_height_);
+            axis_y_.fixed = true;
+        } else {
+            axis_y_.init(bounds_.min_y, bounds_.max_y, fine_height_);
+        }
+
+        cells_ = Grid<State>(fine_width_, fine_height_, acc_.init());
+        max_x_states_.assign(fine_height_, acc_.init());
+        max_y_states_.assign(fine_width_, acc_.init());
+        max_xy_state_ = acc_.init();
+        gridded_ = true;
+
+        for (const auto& p : pending_) {
+            bin(p.x, p.y, p.v);
+        }
+        std::vector<Pending>().swap(pending_);
+    }
+
+    // Output cell of coordinate v on an axis of n cells over [out_min, out_max],
+    // as HeatmapBinner computes it
+    static int output_cell(double v, double out_min, double out_max, int n) {
+        int cell = static_cast<int>(map_range(v, out_min, out_max, 0.0, static_cast<double>(n - 1)));
+        return std::clamp(cell, 0, n - 1);
+    }
+
+    // Split every fine bin of axis, holding points within [min, max], over the
+    // n output cells spanning [out_min, out_max]. Points on max are kept apart,
+    // so fine bins only reach the first n - 1 output cells.
+    static AxisPieces axis_pieces(const Axis& axis, double min, double max,
+                                  double out_min, double out_max, int n) {
+        AxisPieces out;
+        out.first.reserve(axis.bins + 1);
+        double scale = (n - 1) / (out_max - out_min);
+        double last = std::max(n - 2, 0);
+        for (int i = 0; i < axis.bins; i++) {
+            out.first.push_back(out.pieces.size());
+            double low = std::max(axis.origin + i * axis.step, min);
+            double high = std::min(axis.origin + (i + 1) * axis.step, max);
+            double u0 = std::clamp((low - out_min) * scale, 0.0, last);
+            double u1 = std::clamp((high - out_min) * scale, 0.0, last + 1);
+            if (!SplittableAccumulator<Acc> || !(u1 > u0)) {
+                double center = std::min(u1 > u0 ? 0.5 * (u0 + u1) : u0, last);
+                out.pieces.push_back({static_cast<int>(center), 0.0, 1.0});
+                continue;
+            }
+            for (double k = std::floor(u0); k < u1; k++) {
+                double from = (std::max(k, u0) - u0) / (u1 - u0);
+                double to = (std::min(k + 1, u1) - u0) / (u1 - u0);
+                if (to > from) {
+                    out.pieces.push_back({static_cast<int>(std::min(k, last)), from, to});
+                }
+            }
+        }
+        out.first.push_back(out.pieces.size());
+        return out;
+    }
+
+    // Merge the share piece of src into dst
+    void merge_piece(State& dst, const State& src, const Piece& piece) const {
+        if constexpr (SplittableAccumulator<Acc>) {
+            acc_.merge(dst, acc_.split(src, piece.from, piece.to));
+        } else {
+            acc_.merge(dst, src);
+        }
+    }
+
+public:
+    AdaptiveHeatmapBinner(int width, int height, int resolution = 16, size_t warmup = 4096,
+                          Acc acc = Acc{})
+        : acc_(acc), width_(width), height_(height),
+          fine_width_(width * resolution), fine_height_(height * resolution),
+          warmup_(std::max<size_t>(warmup, 1)), max_xy_state_(acc.init()) {
+        pending_.reserve(warmup_);
+    }
+
+    // Pin an axis to caller-supplied bounds; points outside must be filtered by the caller
+    void fix_x_bounds(double min, double max) { fixed_x_.emplace(min, max); }
+    void fix_y_bounds(double min, double max) { fixed_y_.emplace(min, max); }
+
+    // Add a point without a value (counts it)
+    void add(double x, double y) {
+        add(x, y, Input{1});
+    }
+
+    // Add a point with a value, aggregated by the accumulator
+    void add(double x, double y, Input v) {
+        if (!std::isfinite(x) || !std::isfinite(y)) return;
+
+        if (gridded_) {
+            if (!fixed_x_ && x > bounds_.max_x) release_max_x();
+            if (!fixed_y_ && y > bounds_.max_y) release_max_y();
+        }
+        bounds_.add(x, y);
+        points_++;
+
+        if (gridded_) {
+            bin(x, y, v);
+            return;
+        }
+
+        pending_.push_back({x, y, v});
+        if (pending_.size() >= warmup_) {
+            start_grid();
+        }
+    }
+
+    // Number of points added so far
+    size_t points() const { return points_; }
+
+    // Cell states reduced onto the output grid over the bounds of the data
+    // seen so far
+    HeatmapBinner<Acc> output() const {
+        double min_x = fixed_x_ ? fixed_x_->first : bounds_.min_x;
+        double max_x = edge_x();
+        double min_y = fixed_y_ ? fixed_y_->first : bounds_.min_y;
+        double max_y = edge_y();
+        HeatmapBinner<Acc> binner(width_, height_, min_x, max_x, min_y, max_y, acc_);
+
+        if (!gridded_) {
+            for (const auto& p : pending_) {
+                binner.add(p.x, p.y, p.v);
+            }
+            return binner;
+        }
+
+        // The binner widens an empty range; map onto the bounds it uses
+        PointBounds out = binner.bounds();
+        AxisPieces pieces_x = axis_pieces(axis_x_, min_x, max_x, out.min_x, out.max_x, width_);
+        AxisPieces pieces_y = axis_pieces(axis_y_, min_y, max_y, out.min_y, out.max_y, height_);
+        int edge_cx = output_cell(max_x, out.min_x, out.max_x, width_);
+        int edge_cy = output_cell(max_y, out.min_y, out.max_y, height_);
+
+        // Reduce columns first: fine row y (or the y maximum strip, as the
+        // extra last row) onto width_ output columns
+        Grid<State> rows(width_, fine_height_ + 1, acc_.init());
+        for (int y = 0; y <= fine_height_; y++) {
+            const State* src = y < fine_height_ ? cells_.row(y) : max_y_states_.data();
+            State* dst = rows.row(y);
+            for (int x = 0; x < fine_width_; x++) {
+                for (size_t i = pieces_x.first[x]; i < pieces_x.first[x + 1]; i++) {
+                    const Piece& piece = pieces_x.pieces[i];
+                    merge_piece(dst[piece.cell], src[x], piece);
+                }
+            }
+            acc_.merge(dst[edge_cx], y < fine_height_ ? max_x_states_[y] : max_xy_state_);
+        }
+
+        // Then rows onto height_ output rows
+        Grid<State> states(width_, height_, acc_.init());
+        for (int y = 0; y < fine_height_; y++) {
+            const State* src = rows.row(y);
+            for (size_t i = pieces_y.first[y]; i < pieces_y.first[y + 1]; i++) {
+                const Piece& piece = pieces_y.pieces[i];
+                State* dst = states.row(piece.cell);
+                for (int x = 0; x < width_; x++) {
+                    merge_piece(dst[x], src[x], piece);
+                }
+            }
+        }
+        const State* edge = rows.row(fine_height_);
+        State* dst = states.row(edge_cy);
+        for (int x = 0; x < width_; x++) {
+            acc_.merge(dst[x], edge[x]);
+        }
+
+        binner.merge_states(states, points_);
+        return binner;
+    }
+
+    // Finalized heatmap over the bounds of the data seen so far
+    Grid<Result> result() const {
+        return output().result();
+    }
+};
+
+// Heatmap over a sliding time window. The window is split into `slices` equal
+// time slices, each binned into its own sub-grid over the same bounds, held in
+// a ring indexed by slice number. A point's time selects its slice; when time
+// moves past the newest slice, the slices that fall out of the window are
+// cleared (O(grid) each) and reused, so raw rows are never kept. Points older
+// than the window are dropped. result() merges the live slices' accumulator
+// states before finalizing, so aggregates like Avg are exact over the window.
+template<Accumulator Acc>
+class WindowedHeatmapBinner {
+public:
+    using Input = accumulator_input_t<Acc>;
+    using Result = typename Acc::Result;
+
+private:
+    double slice_span_;
+    std::vector<HeatmapBinner<Acc>> ring_;
+    int64_t newest_ = std::numeric_limits<int64_t>::min();   // Newest slice number seen
+
+    HeatmapBinner<Acc>& slot(int64_t slice) {
+        int64_t k = static_cast<int64_t>(ring_.size());
+        return ring_[static_cast<size_t>(((slice % k) + k) % k)];
+    }
+
+    // Sub-grid for time t, advancing the window if t is newer than anything
+    // seen; nullptr if t is older than the window
+    HeatmapBinner<Acc>* slot_for(double t) {
+        if (!std::isfinite(t)) return nullptr;
+        double slice_at = std::floor(t / slice_span_);
+        if (std::abs(slice_at) > 9e18) return nullptr;
+
+        int64_t slice = static_cast<int64_t>(slice_at);
+        int64_t k = static_cast<int64_t>(ring_.size());
+        if (newest_ == std::numeric_limits<int64_t>::min()) {
+            newest_ = slice;
+        } else if (slice > newest_) {
+            int64_t stale = std::min(slice - newest_, k);
+            for (int64_t s = slice - stale + 1; s <= slice; ++s) {
+                slot(s).clear();
+            }
+            newest_ = slice;
+        } else if (slice <= newest_ - k) {
+            return nullptr;
+        }
+        return &slot(slice);
+    }
+
+public:
+    WindowedHeatmapBinner(int width, int height, double min_x, double max_x, double min_y, double max_y,
+                          double window, int slices, Acc acc = Acc{})
+        : slice_span_(window / slices),
+          ring_(slices > 0 ? slices : 0, HeatmapBinner<Acc>(width, height, min_x, max_x, min_y, max_y, acc)) {
+        if (!(window > 0) || slices < 1) {
+            throw std::invalid_argument("Time window and slice count must be positive");
+        }
+    }
+
+    // Add a point without a value at time t
+    void add_at(double t, double x, double y) {
+        if (auto* binner = slot_for(t)) binner->add(x, y);
+    }
+
+    // Add a point with a value at time t
+    void add_at(double t, double x, double y, Input v) {
+        if (auto* binner = slot_for(t)) binner->add(x, y, v);
+    }
+
+    // Number of points inside the current window
+    size_t points() const {
+        size_t total = 0;
+        for (const auto& binner : ring_) total += binner.points();
+        return total;
+    }
+
+    // Cell states of the live slices merged into one grid
+    HeatmapBinner<Acc> output() const {
+        HeatmapBinner<Acc> window = ring_[0];
+        for (size_t i = 1; i < ring_.size(); ++i) {
+            window.merge(ring_[i]);
+        }
+        return window;
+    }
+
+    // Finalized heatmap over the live slices
+    Grid<Result> result() const {
+        return output().result();
+    }
 };
 
 // Build heatmap data from 2D points (x,y) or 3D points (x,y,v)
 template<Numeric X, Numeric Y, Numeric V = int>
-std::vector<std::vector<V>> build_heatmap_data(
+Grid<V> build_heatmap_data(
     const std::vector<std::tuple<X, Y>>& points, 
     int width = 10, 
     int height = 10) {
     
-    // Initialize empty heatmap with zeros
-    std::vector<std::vector<V>> heatmap(height, std::vector<V>(width, 0));
-    
     // Find min and max values for x and y to scale properly
     X min_x = std::numeric_limits<X>::max();
     X max_x = std::numeric_limits<X>::lowest();
@@ -50,44 +686,23 @@ std::vector<std::vector<V>> build_heatmap_data(
         max_y = std::max(max_y, y);
     }
     
-    // Special case: all x or y values are the same
-    if (min_x == max_x) max_x = min_x + 1;
-    if (min_y == max_y) max_y = min_y + 1;
-    
     // Count points in each cell
+    HeatmapBinner<CountAccumulator> binner(width, height, min_x, max_x, min_y, max_y);
     for (const auto& point : points) {
-        X x = std::get<0>(point);
-        Y y = std::get<1>(point);
-        
-        // Map the point to the heatmap grid
-        int cell_x = static_cast<int>(map_range(x, min_x, max_x, 0.0, static_cast<double>(width - 1)));
-        int cell_y = static_cast<int>(map_range(y, min_y, max_y, 0.0, static_cast<double>(height - 1)));
-        
-        // Ensure we're within bounds
-        cell_x = std::clamp(cell_x, 0, width - 1);
-        cell_y = std::clamp(cell_y, 0, height - 1);
-        
-        // Increment the count for this cell
-        heatmap[cell_y][cell_x]++;
+        binner.add(std::get<0>(point), std::get<1>(point));
     }
     
-    return heatmap;
+    return binner.result().template convert<V>();
 }
 
 // Build heatmap data from 3D points (x,y,v) with optional aggregation function
 template<Numeric X, Numeric Y, Numeric V>
-std::vector<std::vector<V>> build_heatmap_data(
+Grid<V> build_heatmap_data(
     const std::vector<std::tuple<X, Y, V>>& points, 
     AggregateFunc func = AggregateFunc::Count,
     int width = 10, 
     int height = 10) {
     
-    // Initialize empty heatmap with zeros
-    std::vector<std::vector<V>> heatmap(height, std::vector<V>(width, 0));
-    
-    // For average calculation, we need to track count separately
-    std::vector<std::vector<int>> count_map(height, std::vector<int>(width, 0));
-    
     // Find min and max values for x and y to scale properly
     X min_x = std::numeric_limits<X>::max();
     X max_x = std::numeric_limits<X>::lowest();
@@ -104,43 +719,13 @@ std::vector<std::vector<V>> build_heatmap_data(
         max_y = std::max(max_y, y);
     }
     
-    // Special case: all x or y values are the same
-    if (min_x == max_x) max_x = min_x + 1;
-    if (min_y == max_y) max_y = min_y + 1;
-    
     // Process points for each cell based on the aggregation function
-    for (const auto& point : points) {
-        X x = std::get<0>(point);
-        Y y = std::get<1>(point);
-        V v = std::get<2>(point);
-        
-        // Map the point to the heatmap grid
-        int cell_x = static_cast<int>(map_range(x, min_x, max_x, 0.0, static_cast<double>(width - 1)));
-        int cell_y = static_cast<int>(map_range(y, min_y, max_y, 0.0, static_cast<double>(height - 1)));
-        
-        // Ensure we're within bounds
-        cell_x = std::clamp(cell_x, 0, width - 1);
-        cell_y = std::clamp(cell_y, 0, height - 1);
-        
-        // Update the cell based on aggregation function
-        if (func == AggregateFunc::Sum || func == AggregateFunc::Avg) {
-            heatmap[cell_y][cell_x] += v;
-            count_map[cell_y][cell_x]++;
-        } else { // Count
-            heatmap[cell_y][cell_x]++;
-        }
-    }
-    
-    // Post-process for average if needed
-    if (func == AggregateFunc::Avg) {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                if (count_map[y][x] > 0) {
-                    heatmap[y][x] = static_cast<V>(static_cast<double>(heatmap[y][x]) / count_map[y][x]);
-                }
-            }
+    return with_accumulator(func, [&](auto acc) {
+        using Binner = HeatmapBinner<decltype(acc)>;
+        Binner binner(width, height, min_x, max_x, min_y, max_y, acc);
+        for (const auto& point : points) {
+            binner.add(std::get<0>(point), std::get<1>(point), static_cast<typename Binner::Input>(std::get<2>(point)));
         }
-    }
-    
-    return heatmap;
-}
\ No newline at end of file
+        return binner.result().template convert<V>();
+    });
+}
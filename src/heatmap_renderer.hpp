@@ -1,68 +1,354 @@
 #pragma once
 
-#include <vector>
+#include <array>
 #include <string>
+#include <string_view>
 #include <iostream>
-#include <iomanip>
+#include <charconv>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "color_palette.hpp"
 #include "heatmap_builder.hpp"
+#include "value_scale.hpp"
+
+// How grid cells map onto terminal characters
+enum class GlyphMode {
+    Block,      // One cell per character, shaded by intensity
+    HalfBlock,  // 1x2 cells per character: upper and lower half blocks
+    Braille     // 2x4 cells per character: braille dots
+};
+
+// Cells covered by one character, per axis
+inline int glyph_cells_x(GlyphMode mode) { return mode == GlyphMode::Braille ? 2 : 1; }
+inline int glyph_cells_y(GlyphMode mode) { return mode == GlyphMode::Braille ? 4 : mode == GlyphMode::HalfBlock ? 2 : 1; }
+
+// How pool_grid combines the cells of a fine grid into one display cell
+enum class PoolMode {
+    Sum,    // Totals, e.g. for counts
+    Max,    // Peaks stay visible however far the grid is reduced
+    Mean
+};
 
 // Unicode characters for intensity levels
-const std::vector<std::string> INTENSITY_CHARS = {" ", "░", "▒", "▓", "█"};
+inline constexpr std::array<std::string_view, 5> INTENSITY_CHARS = {" ", "░", "▒", "▓", "█"};
+
+// Half blocks indexed by (lower lit) << 1 | (upper lit)
+inline constexpr std::array<std::string_view, 4> HALF_BLOCK_CHARS = {" ", "▀", "▄", "█"};
 
 // Returns the intensity character based on normalized value (0-1)
-std::string get_intensity_char(double normalized_value) {
+inline std::string_view get_intensity_char(double normalized_value) {
     int index = static_cast<int>(normalized_value * (INTENSITY_CHARS.size() - 1));
-    return INTENSITY_CHARS[index];
+    return INTENSITY_CHARS[std::clamp(index, 0, static_cast<int>(INTENSITY_CHARS.size()) - 1)];
 }
 
-// Renders heatmap to the terminal
-template<Numeric T>
-void render_heatmap(const std::vector<std::vector<T>>& data, bool show_legend = false) {
-    if (data.empty() || data[0].empty()) {
-        std::cerr << "Error: Empty data provided\n";
-        return;
+namespace renderer_detail {
+    // 4x4 Bayer matrix: ordered-dither thresholds for sub-cell glyphs, so the
+    // share of lit dots in an area follows the cells' intensity
+    inline constexpr unsigned char BAYER[4][4] = {
+        {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+    // Braille dot bit of sub-cell (x, y) within a 2x4 character
+    inline constexpr unsigned char BRAILLE_DOT[4][2] = {
+        {0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+    inline bool lit(double normalized, int x, int y) {
+        return normalized * 16 > BAYER[y & 3][x & 3] + 0.5;
     }
 
-    // Find min and max values
-    T min_val = data[0][0];
-    T max_val = data[0][0];
-    
-    for (const auto& row : data) {
-        for (const auto& val : row) {
-            min_val = std::min(min_val, val);
-            max_val = std::max(max_val, val);
+    // UTF-8 for braille pattern U+2800 + dots; no dots renders as a space
+    inline void append_braille(std::string& out, unsigned dots) {
+        if (dots == 0) {
+            out += ' ';
+            return;
         }
+        out += static_cast<char>(0xE2);
+        out += static_cast<char>(0xA0 | (dots >> 6));
+        out += static_cast<char>(0x80 | (dots & 0x3F));
     }
 
-    // Special case: all values are the same
-    if (min_val == max_val) {
-        min_val = min_val - 1;  // Arbitrary adjustment to avoid division by zero
+    // Appends SGR escapes for color changes only, so a run of cells with the
+    // same color costs one escape. DEFAULT is the terminal's own color and
+    // KEEP leaves a color as it is (e.g. the foreground under a space).
+    class ColorWriter {
+    public:
+        static constexpr int DEFAULT = -1;
+        static constexpr int KEEP = -2;
+
+    private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+        const ColorTable& table_;
+        std::string& out_;
+        uint32_t fg_ = NONE;  // Ids of the colors in effect (NONE = default)
+        uint32_t bg_ = NONE;
+
+        uint32_t id(int level) const { return level == DEFAULT ? NONE : table_.id(level); }
+
+    public:
+        ColorWriter(const ColorTable& table, std::string& out) : table_(table), out_(out) {}
+
+        void set(int fg, int bg) {
+            bool fg_changes = fg != KEEP && id(fg) != fg_;
+            bool bg_changes = bg != KEEP && id(bg) != bg_;
+            if (!fg_changes && !bg_changes) return;
+            out_ += "\033[";
+            if (fg_changes) {
+                out_ += fg == DEFAULT ? std::string_view("39") : table_.fg(fg);
+                fg_ = id(fg);
+                if (bg_changes) out_ += ';';
+            }
+            if (bg_changes) {
+                out_ += bg == DEFAULT ? std::string_view("49") : table_.bg(bg);
+                bg_ = id(bg);
+            }
+            out_ += 'm';
+        }
+
+        // Reset before the newline, so backgrounds don't bleed into the margin
+        void end_line() {
+            if (fg_ != NONE || bg_ != NONE) out_ += "\033[0m";
+            fg_ = bg_ = NONE;
+            out_ += '\n';
+        }
+    };
+
+    // Integers as they are, other values with two decimals
+    template<typename T>
+    void append_number(std::string& out, T value) {
+        char buffer[64];
+        std::to_chars_result result;
+        if constexpr (std::is_integral_v<T>) {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        } else {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<double>(value),
+                                   std::chars_format::fixed, 2);
+        }
+        out.append(buffer, result.ec == std::errc{} ? result.ptr : buffer);
+    }
+}
+
+// Reduce data to width x height cells, each pooling the block of data cells
+// it covers. Blocks split the grid as evenly as possible; a display larger
+// than data repeats cells. Mean pools are best read as Out = double.
+template<Numeric Out, Numeric T>
+Grid<Out> pool_grid(const Grid<T>& data, int width, int height, PoolMode mode) {
+    Grid<Out> out(width, height);
+    auto block = [](int i, int cells, int size) {
+        int begin = static_cast<int>(static_cast<int64_t>(i) * size / cells);
+        int end = static_cast<int>(static_cast<int64_t>(i + 1) * size / cells);
+        return std::pair{begin, std::max(end, begin + 1)};
+    };
+    for (int y = 0; y < height; ++y) {
+        auto [y0, y1] = block(y, height, data.height());
+        for (int x = 0; x < width; ++x) {
+            auto [x0, x1] = block(x, width, data.width());
+            double total = 0;
+            T peak = data(x0, y0);
+            for (int sy = y0; sy < y1; ++sy) {
+                for (int sx = x0; sx < x1; ++sx) {
+                    total += static_cast<double>(data(sx, sy));
+                    peak = std::max(peak, data(sx, sy));
+                }
+            }
+            if (mode == PoolMode::Max) {
+                out(x, y) = static_cast<Out>(peak);
+            } else if (mode == PoolMode::Mean) {
+                out(x, y) = static_cast<Out>(total / ((x1 - x0) * (y1 - y0)));
+            } else if constexpr (std::is_integral_v<Out>) {
+                out(x, y) = static_cast<Out>(std::llround(total));
+            } else {
+                out(x, y) = static_cast<Out>(total);
+            }
+        }
+    }
+    return out;
+}
+
+// Build the whole heatmap frame (and legend) in one string. In the sub-cell
+// modes every cell is a dot lit by ordered dithering of its intensity.
+// With colors, blocks are colored spaces, half blocks take the upper cell's
+// color as foreground and the lower one's as background, and braille dots
+// are drawn in the mean color of their character's cells. Values map to
+// intensity under scale_mode, and the legend gives the values at which
+// shades change.
+template<Numeric T>
+std::string render_frame(const Grid<T>& data, bool show_legend = false, GlyphMode glyphs = GlyphMode::Block,
+                         const ColorTable* colors = nullptr, ScaleMode scale_mode = ScaleMode::Linear) {
+    using namespace renderer_detail;
+    std::string out;
+    if (data.empty()) return out;
+
+    ValueScale scale(data, scale_mode);
+    auto normalized = [&](int x, int y) { return scale.normalize(static_cast<double>(data(x, y))); };
+    // Value at intensity t, in the grid's own type. For integers that is the
+    // smallest one reaching t, so "[a; b)" holds exactly the cells shaded so.
+    auto breakpoint = [&](double t) {
+        double v = scale.value_at(t);
+        if constexpr (std::is_integral_v<T>) {
+            return static_cast<T>(std::ceil(v - 1e-9 * std::max(1.0, std::abs(v))));
+        } else {
+            return static_cast<T>(v);
+        }
+    };
+    T min_val = breakpoint(0);
+    T max_val = breakpoint(1);
+
+    // Where a quarter, half and three quarters of the intensity are reached;
+    // only worth showing when the scale isn't linear
+    auto append_quarters = [&](std::string_view quarter, std::string_view half, std::string_view three_quarters) {
+        if (scale_mode == ScaleMode::Linear) return;
+        out += quarter;
+        append_number(out, breakpoint(0.25));
+        out += half;
+        append_number(out, breakpoint(0.5));
+        out += three_quarters;
+        append_number(out, breakpoint(0.75));
+    };
+
+    int step_x = glyph_cells_x(glyphs);
+    int step_y = glyph_cells_y(glyphs);
+    int columns = (data.width() + step_x - 1) / step_x;
+    int rows = (data.height() + step_y - 1) / step_y;
+    // Every glyph is at most 3 bytes of UTF-8; colors mostly change at runs
+    out.reserve(static_cast<size_t>(rows) * (columns * (colors ? 6 : 3) + 1) + (show_legend ? 256 : 0));
+
+    if (colors) {
+        ColorWriter color(*colors, out);
+        for (int row = 0; row < rows; ++row) {
+            int y0 = row * step_y;
+            for (int column = 0; column < columns; ++column) {
+                int x0 = column * step_x;
+                if (glyphs == GlyphMode::Block) {
+                    color.set(ColorWriter::KEEP, ColorTable::level(normalized(x0, y0)));
+                    out += ' ';
+                } else if (glyphs == GlyphMode::HalfBlock) {
+                    int upper = ColorTable::level(normalized(x0, y0));
+                    if (y0 + 1 >= data.height()) {
+                        color.set(upper, ColorWriter::DEFAULT);
+                        out += HALF_BLOCK_CHARS[1];
+                        continue;
+                    }
+                    int lower = ColorTable::level(normalized(x0, y0 + 1));
+                    if (colors->id(upper) == colors->id(lower)) {
+                        color.set(ColorWriter::KEEP, lower);
+                        out += ' ';
+                    } else {
+                        color.set(upper, lower);
+                        out += HALF_BLOCK_CHARS[1];
+                    }
+                } else {
+                    unsigned dots = 0;
+                    double sum = 0;
+                    int cells = 0;
+                    for (int dy = 0; dy < step_y && y0 + dy < data.height(); ++dy) {
+                        for (int dx = 0; dx < step_x && x0 + dx < data.width(); ++dx) {
+                            double n = normalized(x0 + dx, y0 + dy);
+                            sum += n;
+                            cells++;
+                            if (lit(n, x0 + dx, y0 + dy)) dots |= BRAILLE_DOT[dy][dx];
+                        }
+                    }
+                    if (dots != 0) color.set(ColorTable::level(sum / cells), ColorWriter::KEEP);
+                    append_braille(out, dots);
+                }
+            }
+            color.end_line();
+        }
+
+        // Legend: the palette from min to max
+        if (show_legend) {
+            constexpr int BAR = 32;
+            out += "\nLegend:\n";
+            append_number(out, min_val);
+            out += ' ';
+            for (int i = 0; i < BAR; ++i) {
+                color.set(ColorWriter::KEEP, ColorTable::level((i + 0.5) / BAR));
+                out += ' ';
+            }
+            color.set(ColorWriter::DEFAULT, ColorWriter::DEFAULT);
+            out += ' ';
+            append_number(out, max_val);
+            color.end_line();
+            append_quarters("Quarter marks at ", ", ", " and ");
+            if (scale_mode != ScaleMode::Linear) out += '\n';
+        }
+        return out;
     }
 
     // Render the heatmap
-    for (const auto& row : data) {
-        for (const auto& val : row) {
-            double normalized = map_range(val, min_val, max_val, 0.0, 1.0);
-            std::string intensity = get_intensity_char(normalized);
-            
-            std::cout << intensity;
+    for (int row = 0; row < rows; ++row) {
+        int y0 = row * step_y;
+        for (int column = 0; column < columns; ++column) {
+            int x0 = column * step_x;
+            if (glyphs == GlyphMode::Block) {
+                out += get_intensity_char(normalized(x0, y0));
+                continue;
+            }
+
+            // Cells past the grid's edge stay dark
+            unsigned dots = 0;
+            for (int dy = 0; dy < step_y && y0 + dy < data.height(); ++dy) {
+                for (int dx = 0; dx < step_x && x0 + dx < data.width(); ++dx) {
+                    if (!lit(normalized(x0 + dx, y0 + dy), x0 + dx, y0 + dy)) continue;
+                    dots |= glyphs == GlyphMode::Braille ? BRAILLE_DOT[dy][dx] : 1u << dy;
+                }
+            }
+            if (glyphs == GlyphMode::Braille) {
+                append_braille(out, dots);
+            } else {
+                out += HALF_BLOCK_CHARS[dots];
+            }
         }
-        std::cout << "\n";
+        out += '\n';
     }
 
     // Render legend if requested
     if (show_legend) {
-        std::cout << "\nLegend:\n";
-        
-        std::cout << std::fixed << std::setprecision(2);
-
-        for (int i = 0; i < INTENSITY_CHARS.size(); ++i) {
-            double mn = static_cast<double>(i)     / INTENSITY_CHARS.size();
-            double mx = static_cast<double>(i + 1) / INTENSITY_CHARS.size();
-            T mnd = map_range(mn, 0.0, 1.0, min_val, max_val);
-            T mxd = map_range(mx, 0.0, 1.0, min_val, max_val);
-            
-            std::cout << INTENSITY_CHARS[i] << " [" << mnd << "; " << mxd << ")" << std::endl;
+        out += "\nLegend:\n";
+        if (glyphs != GlyphMode::Block) {
+            out += glyphs == GlyphMode::Braille ? "Each dot" : "Each half block";
+            out += " is a cell; the share of lit cells rises from none at ";
+            append_number(out, min_val);
+            out += " to all at ";
+            append_number(out, max_val);
+            append_quarters("; a quarter at ", ", half at ", ", three quarters at ");
+            out += "\n";
+            return out;
+        }
+
+        // Shades change at every (N - 1)th of the intensity, as
+        // get_intensity_char picks them; only the maximum gets the last one
+        const size_t steps = INTENSITY_CHARS.size() - 1;
+        for (size_t i = 0; i < steps; ++i) {
+            T mnd = breakpoint(static_cast<double>(i)     / steps);
+            T mxd = breakpoint(static_cast<double>(i + 1) / steps);
+
+            out += INTENSITY_CHARS[i];
+            out += " [";
+            append_number(out, mnd);
+            out += "; ";
+            append_number(out, mxd);
+            out += ")\n";
         }
+        out += INTENSITY_CHARS[steps];
+        out += ' ';
+        append_number(out, max_val);
+        out += "\n";
     }
+    return out;
+}
+
+// Renders heatmap to the terminal (or any other stream) with a single write
+template<Numeric T>
+void render_heatmap(const Grid<T>& data, bool show_legend = false, std::ostream& out = std::cout,
+                    GlyphMode glyphs = GlyphMode::Block, const ColorTable* colors = nullptr,
+                    ScaleMode scale_mode = ScaleMode::Linear) {
+    if (data.empty()) {
+        std::cerr << "Error: Empty data provided\n";
+        return;
+    }
+
+    std::string frame = render_frame(data, show_legend, glyphs, colors, scale_mode);
+    out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
 }
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "byte_io.hpp"
+
+// Spread the bits of a 64-bit key (MurmurHash3's finalizer), so keys that
+// differ in a few bits, like small integers, give independent-looking hashes
+inline uint64_t mix64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Approximate distinct counter (HyperLogLog) over 64-bit hashes, with
+// 2^PRECISION registers for a standard error of about 1.6%. A register holds
+// the longest run of leading zeros seen among the hashes routed to it.
+// Small sets are kept sparse: a sorted list of the non-zero registers, 4 bytes
+// each, which holds exactly the same information as the dense array but
+// costs far less for the many cells of a grid that only see a few keys. The
+// list turns into the dense 4 KiB array once it would be a quarter that size.
+// Merging takes the per-register maximum, so it is exact in either form.
+class HyperLogLog {
+public:
+    static constexpr int PRECISION = 12;
+    static constexpr uint32_t REGISTERS = 1u << PRECISION;
+    static constexpr size_t SPARSE_LIMIT = REGISTERS / 16;
+
+private:
+    std::vector<uint32_t> sparse_;  // (register << 8) | rank, sorted, one entry per register
+    std::vector<uint8_t> dense_;    // Empty while sparse
+
+    static uint32_t entry(uint32_t index, uint8_t rank) { return (index << 8) | rank; }
+    static uint32_t entry_index(uint32_t e) { return e >> 8; }
+    static uint8_t entry_rank(uint32_t e) { return static_cast<uint8_t>(e & 0xff); }
+
+    void to_dense() {
+        dense_.assign(REGISTERS, 0);
+        for (uint32_t e : sparse_) {
+            dense_[entry_index(e)] = entry_rank(e);
+        }
+        std::vector<uint32_t>().swap(sparse_);
+    }
+
+    void set_register(uint32_t index, uint8_t rank) {
+        if (!dense_.empty()) {
+            dense_[index] = std::max(dense_[index], rank);
+            return;
+        }
+        auto it = std::lower_bound(sparse_.begin(), sparse_.end(), entry(index, 0));
+        if (it != sparse_.end() && entry_index(*it) == index) {
+            if (entry_rank(*it) < rank) *it = entry(index, rank);
+            return;
+        }
+        sparse_.insert(it, entry(index, rank));
+        if (sparse_.size() > SPARSE_LIMIT) to_dense();
+    }
+
+public:
+    // Add an already hashed key
+    void add_hash(uint64_t hash) {
+        uint32_t index = static_cast<uint32_t>(hash >> (64 - PRECISION));
+        uint64_t rest = hash << PRECISION;
+        uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - PRECISION + 1)
+                                 : static_cast<uint8_t>(std::countl_zero(rest) + 1);
+        set_register(index, rank);
+    }
+
+    void merge(const HyperLogLog& other) {
+        if (other.dense_.empty()) {
+            for (uint32_t e : other.sparse_) {
+                set_register(entry_index(e), entry_rank(e));
+            }
+            return;
+        }
+        if (dense_.empty()) to_dense();
+        for (uint32_t i = 0; i < REGISTERS; ++i) {
+            dense_[i] = std::max(dense_[i], other.dense_[i]);
+        }
+    }
+
+    bool is_sparse() const { return dense_.empty(); }
+    bool empty() const { return dense_.empty() && sparse_.empty(); }
+
+    // Append a binary encoding to out, in whichever form is current
+    void encode(std::string& out) const {
+        put_bytes(out, static_cast<uint8_t>(is_sparse() ? 0 : 1));
+        if (is_sparse()) {
+            put_bytes(out, static_cast<uint32_t>(sparse_.size()));
+            for (uint32_t e : sparse_) put_bytes(out, e);
+        } else {
+            out.append(reinterpret_cast<const char*>(dense_.data()), dense_.size());
+        }
+    }
+
+    // Read a counter written by encode from the front of in
+    static HyperLogLog decode(std::string_view& in) {
+        HyperLogLog hll;
+        if (take_bytes<uint8_t>(in) == 0) {
+            uint32_t size = take_bytes<uint32_t>(in);
+            if (size > SPARSE_LIMIT) throw std::runtime_error("Corrupt distinct counter");
+            hll.sparse_.resize(size);
+            // Entries index the dense array and keep the list searchable, so
+            // they must name real registers, with real ranks, in order
+            uint32_t previous = 0;
+            for (auto& e : hll.sparse_) {
+                e = take_bytes<uint32_t>(in);
+                bool ordered = &e == hll.sparse_.data() || entry_index(e) > entry_index(previous);
+                bool ranked = entry_rank(e) >= 1 && entry_rank(e) <= 64 - PRECISION + 1;
+                if (entry_index(e) >= REGISTERS || !ranked || !ordered) {
+                    throw std::runtime_error("Corrupt distinct counter");
+                }
+                previous = e;
+            }
+        } else {
+            if (in.size() < REGISTERS) throw std::runtime_error("Truncated binary data");
+            hll.dense_.assign(in.begin(), in.begin() + REGISTERS);
+            in.remove_prefix(REGISTERS);
+        }
+        return hll;
+    }
+
+    // Estimated number of distinct hashes added
+    double estimate() const {
+        const double m = REGISTERS;
+        double sum = 0;
+        uint32_t zeros = 0;
+        if (dense_.empty()) {
+            zeros = REGISTERS - static_cast<uint32_t>(sparse_.size());
+            sum = zeros;
+            for (uint32_t e : sparse_) sum += std::ldexp(1.0, -entry_rank(e));
+        } else {
+            for (uint8_t rank : dense_) {
+                sum += std::ldexp(1.0, -rank);
+                if (rank == 0) zeros++;
+            }
+        }
+
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double raw = alpha * m * m / sum;
+
+        // Linear counting is more accurate while many registers are still empty
+        if (raw <= 2.5 * m && zeros > 0) {
+            return m * std::log(m / zeros);
+        }
+        return raw;
+    }
+};
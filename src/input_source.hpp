@@ -0,0 +1,174 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace tplt {
+
+// True if path names a regular file, i.e. one that can be mapped and rescanned
+inline bool is_regular_file(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// Read-only memory mapping of a whole regular file, so the parser can slice
+// fields straight out of the page cache
+class MappedFile {
+private:
+    int fd_ = -1;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+
+    void release() {
+        if (mapped_ && data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        fd_ = -1;
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+    }
+
+public:
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path) {
+        open(path);
+    }
+
+    ~MappedFile() {
+        release();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+        : fd_(other.fd_), data_(other.data_), size_(other.size_),
+          mapped_(other.mapped_) {
+        other.fd_ = -1;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            release();
+            fd_ = other.fd_;
+            data_ = other.data_;
+            size_ = other.size_;
+            mapped_ = other.mapped_;
+            other.fd_ = -1;
+            other.data_ = nullptr;
+            other.size_ = 0;
+            other.mapped_ = false;
+        }
+        return *this;
+    }
+
+    // Open and map the file at path
+    void open(const std::string& path) {
+        release();
+
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            int err = errno;
+            release();
+            throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(err));
+        }
+
+        if (S_ISREG(st.st_mode)) {
+            size_ = static_cast<size_t>(st.st_size);
+            if (size_ == 0) {
+                return;  // mmap rejects zero-length mappings; an empty view is fine
+            }
+
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (addr == MAP_FAILED) {
+                int err = errno;
+                release();
+                throw std::runtime_error("Cannot mmap " + path + ": " + std::strerror(err));
+            }
+
+            // We scan front to back exactly once; let the kernel read ahead aggressively
+            madvise(addr, size_, MADV_SEQUENTIAL);
+
+            data_ = static_cast<const char*>(addr);
+            mapped_ = true;
+            return;
+        }
+
+        release();
+        throw std::runtime_error("Cannot mmap " + path + ": not a regular file");
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool is_mapped() const { return mapped_; }
+
+    std::string_view view() const {
+        return std::string_view(data_, size_);
+    }
+};
+
+// Call on_line for every line in buffer, without the trailing "\n" or "\r\n"
+template<typename F>
+void for_each_line(std::string_view buffer, F&& on_line) {
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = nl ? nl : end;
+
+        std::string_view line(p, line_end - p);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        on_line(line);
+
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Split buffer into at most n pieces of roughly equal size, each ending just
+// after a newline (except possibly the last), so no line straddles two pieces.
+// Pieces are never smaller than min_bytes unless the buffer itself is.
+inline std::vector<std::string_view> split_lines_evenly(std::string_view buffer, size_t n,
+                                                        size_t min_bytes = 1 << 20) {
+    std::vector<std::string_view> pieces;
+    n = std::max<size_t>(1, std::min(n, buffer.size() / std::max<size_t>(min_bytes, 1)));
+
+    size_t start = 0;
+    for (size_t i = 1; i < n && start < buffer.size(); ++i) {
+        size_t target = std::max(start, buffer.size() * i / n);
+        size_t nl = buffer.find('\n', target);
+        if (nl == std::string_view::npos) break;
+        pieces.push_back(buffer.substr(start, nl + 1 - start));
+        start = nl + 1;
+    }
+    pieces.push_back(buffer.substr(start));
+
+    return pieces;
+}
+
+} // namespace tplt
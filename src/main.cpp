@@ -1,116 +1,857 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <tuple>
+#include <optional>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <type_traits>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/ioctl.h>
 #include "heatmap_builder.hpp"
 #include "heatmap_renderer.hpp"
 #include "arg_parser.hpp"
 #include "data_reader.hpp"
+#include "columnar.hpp"
+#include "column_cache.hpp"
+#include "compressed_input.hpp"
+#include "grid_file.hpp"
+#include "grid_pyramid.hpp"
+#include "run_stats.hpp"
 
 using namespace tplt;
 
-// Convert DataPoint vector to the format needed by build_heatmap_data
-template<typename T>
-std::vector<std::tuple<T, T>> convert_to_2d_points(const std::vector<DataPoint<T>>& data_points) {
-    std::vector<std::tuple<T, T>> points;
+// Map the parsed aggregation spec onto the builder's aggregation function
+AggregateFunc to_aggregate_func(const AggregationSpec& spec) {
+    switch (spec.function) {
+        case AggregationSpec::Function::Sum:
+            return AggregateFunc::Sum;
+        case AggregationSpec::Function::Avg:
+            return AggregateFunc::Avg;
+        case AggregationSpec::Function::Min:
+            return AggregateFunc::Min;
+        case AggregationSpec::Function::Max:
+            return AggregateFunc::Max;
+        case AggregationSpec::Function::Variance:
+            return AggregateFunc::Variance;
+        case AggregationSpec::Function::Stddev:
+            return AggregateFunc::Stddev;
+        case AggregationSpec::Function::Quantile:
+            return AggregateFunc::Quantile;
+        case AggregationSpec::Function::Distinct:
+            return AggregateFunc::Distinct;
+        default:
+            return AggregateFunc::Count;
+    }
+}
+
+// Map the parsed glyph style onto the renderer's glyph mode
+GlyphMode to_glyph_mode(Options::Glyphs glyphs) {
+    switch (glyphs) {
+        case Options::Glyphs::Half:
+            return GlyphMode::HalfBlock;
+        case Options::Glyphs::Braille:
+            return GlyphMode::Braille;
+        default:
+            return GlyphMode::Block;
+    }
+}
+
+// Shared color table for the parsed palette, or null for plain shades
+const ColorTable* to_color_table(const Options& options) {
+    ColorDepth depth = options.truecolor ? ColorDepth::TrueColor : ColorDepth::Ansi256;
+    switch (options.colors) {
+        case Options::Colors::Gray:
+            return &color_table(Palette::Gray, depth);
+        case Options::Colors::Viridis:
+            return &color_table(Palette::Viridis, depth);
+        case Options::Colors::Magma:
+            return &color_table(Palette::Magma, depth);
+        default:
+            return nullptr;
+    }
+}
+
+// Map the parsed pool mode onto the renderer's
+PoolMode to_pool_mode(Options::Pool pool) {
+    switch (pool) {
+        case Options::Pool::Max:
+            return PoolMode::Max;
+        case Options::Pool::Mean:
+            return PoolMode::Mean;
+        default:
+            return PoolMode::Sum;
+    }
+}
+
+// Map the parsed scale onto the renderer's
+ScaleMode to_scale_mode(Options::Scale scale) {
+    switch (scale) {
+        case Options::Scale::Log:
+            return ScaleMode::Log;
+        case Options::Scale::Sqrt:
+            return ScaleMode::Sqrt;
+        case Options::Scale::Quantile:
+            return ScaleMode::Quantile;
+        default:
+            return ScaleMode::Linear;
+    }
+}
+
+// Map size in characters: --width/--height, or for "auto" what fits the
+// terminal (queried on every call, so follow mode tracks resizes) with room
+// left for the legend and the lines around it
+std::pair<int, int> display_size(const Options& options) {
+    int columns = options.width;
+    int rows = options.height;
+    if (columns > 0 && rows > 0) return {columns, rows};
     
-    for (const auto& point : data_points) {
-        points.emplace_back(point.x, point.y);
+    int terminal_columns = 80;
+    int terminal_rows = 24;
+    winsize size{};
+    if ((ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 || ioctl(STDERR_FILENO, TIOCGWINSZ, &size) == 0 ||
+         ioctl(STDIN_FILENO, TIOCGWINSZ, &size) == 0) && size.ws_col > 0 && size.ws_row > 0) {
+        terminal_columns = size.ws_col;
+        terminal_rows = size.ws_row;
+    } else {
+        // Not a terminal: the shell's idea of its size, if exported
+        if (const char* env = std::getenv("COLUMNS")) terminal_columns = std::max(std::atoi(env), 1);
+        if (const char* env = std::getenv("LINES")) terminal_rows = std::max(std::atoi(env), 1);
     }
     
-    return points;
+    GlyphMode glyphs = to_glyph_mode(options.glyphs);
+    bool short_legend = options.colors != Options::Colors::None || glyphs != GlyphMode::Block;
+    int reserved = (short_legend ? 3 : 7) + 2;
+    if (columns == 0) columns = std::min(terminal_columns, Options::MAX_CELLS / glyph_cells_x(glyphs));
+    if (rows == 0) rows = std::clamp(terminal_rows - reserved, 1, Options::MAX_CELLS / glyph_cells_y(glyphs));
+    return {columns, rows};
 }
 
-// Convert DataPoint vector to the format needed by build_heatmap_data for 3D points
+// Cells the display shows across and down with the chosen glyphs
+std::pair<int, int> display_cells(const Options& options) {
+    GlyphMode glyphs = to_glyph_mode(options.glyphs);
+    auto [columns, rows] = display_size(options);
+    return {columns * glyph_cells_x(glyphs), rows * glyph_cells_y(glyphs)};
+}
+
+// Render grid with its legend at the display size. With --pool the grid is
+// finer than the display and is pooled down first, so the same grid can be
+// shown at any size without aggregating again.
 template<typename T>
-std::vector<std::tuple<T, T, T>> convert_to_3d_points(const std::vector<DataPoint<T>>& data_points) {
-    std::vector<std::tuple<T, T, T>> points;
+std::string frame_for(const Grid<T>& grid, const Options& options) {
+    GlyphMode glyphs = to_glyph_mode(options.glyphs);
+    const ColorTable* colors = to_color_table(options);
+    ScaleMode scale = to_scale_mode(options.scale);
+    if (options.pool == Options::Pool::None) {
+        return render_frame(grid, true, glyphs, colors, scale);
+    }
     
-    for (const auto& point : data_points) {
-        if (point.value.has_value()) {
-            points.emplace_back(point.x, point.y, point.value.value());
+    auto [width, height] = display_cells(options);
+    if (options.pool == Options::Pool::Mean) {
+        return render_frame(pool_grid<double>(grid, width, height, PoolMode::Mean), true, glyphs, colors, scale);
+    }
+    return render_frame(pool_grid<T>(grid, width, height, to_pool_mode(options.pool)), true, glyphs, colors, scale);
+}
+
+// Heading and map of the relative error of sampled counts (--error), factor
+// being the input rows per sampled row. With --pool the counts are summed to
+// the display first, so each character shows the error of what it shows.
+template<typename T>
+std::string error_frame(const Grid<T>& counts, double factor, Options options) {
+    std::string heading = "\nRelative error (%):\n";
+    if (options.pool == Options::Pool::None) {
+        return heading + frame_for(sampling_error(counts, factor), options);
+    }
+    auto [width, height] = display_cells(options);
+    options.pool = Options::Pool::None;
+    return heading + frame_for(sampling_error(pool_grid<T>(counts, width, height, PoolMode::Sum), factor), options);
+}
+
+// Line saying which rows a sampled map was drawn from and how it was scaled
+// back up, or nothing without sampling
+template<typename Acc>
+std::string sample_note(const Options& options, const DataReader& reader) {
+    std::ostringstream note;
+    if (options.max_rows > 0) {
+        note << "First " << options.max_rows << " rows only\n";
+    } else if (options.sample < 1 || options.reservoir > 0) {
+        if (options.reservoir > 0) {
+            note << "Sampled " << options.reservoir << " rows uniformly";
         } else {
-            // If value is not provided, use 1.0 as default (for count)
-            points.emplace_back(point.x, point.y, static_cast<T>(1.0));
+            note << "Sampled " << options.sample * 100 << "% of rows";
         }
+        if (scales_with_rows<Acc>) note << "; scaled up by " << reader.sample_scale();
+        note << "\n";
     }
+    return note.str();
+}
+
+// Number of parser threads to use for file input
+size_t thread_count(const Options& options) {
+    if (options.threads > 0) return static_cast<size_t>(options.threads);
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Fine-grid resolution of the adaptive binner for a width x height output.
+// Sketch states (quantiles) are far larger than a number, so their fine grid
+// is kept coarser, and large outputs (pyramid bases) are refined less.
+template<typename Acc>
+int adaptive_resolution(int width, int height) {
+    constexpr bool plain = std::is_trivially_copyable_v<typename Acc::State>;
+    int resolution = plain ? 16 : 4;
+    double max_cells = plain ? 1 << 22 : 1 << 20;
+    while (resolution > 1 && static_cast<double>(width) * height * resolution * resolution > max_cells) {
+        resolution /= 2;
+    }
+    return resolution;
+}
+
+// Visitor that bins every point into binner. The reader has already dropped
+// points outside the axis ranges.
+template<typename Binner>
+auto binning_visitor(Binner& binner) {
+    return [&binner](const DataPoint<double>& point) {
+        if constexpr (std::is_same_v<typename Binner::Input, uint64_t>) {
+            binner.add(point.x, point.y, point.key);
+        } else if (point.value.has_value()) {
+            binner.add(point.x, point.y, *point.value);
+        } else {
+            binner.add(point.x, point.y);
+        }
+    };
+}
+
+// Visitor that bins every point into the time slice of a WindowedHeatmapBinner
+// its timestamp selects. The reader sets a time on every point once a time
+// field is selected; points without one are skipped.
+template<typename Binner>
+auto windowed_visitor(Binner& binner) {
+    return [&binner](const DataPoint<double>& point) {
+        if (!point.time.has_value()) return;
+        double t = *point.time;
+        if constexpr (std::is_same_v<typename Binner::Input, uint64_t>) {
+            binner.add_at(t, point.x, point.y, point.key);
+        } else if (point.value.has_value()) {
+            binner.add_at(t, point.x, point.y, *point.value);
+        } else {
+            binner.add_at(t, point.x, point.y);
+        }
+    };
+}
+
+// Sliding-window binner over the --xrange/--yrange bounds
+template<typename Acc>
+WindowedHeatmapBinner<Acc> make_windowed_binner(const Options& options, Acc acc, int width, int height) {
+    return WindowedHeatmapBinner<Acc>(width, height, options.x_range->min, options.x_range->max,
+                                      options.y_range->min, options.y_range->max, options.window, options.slices, acc);
+}
+
+// Aggregate the input into a width x height grid of cell states in O(grid)
+// memory. Bounds come from --xrange/--yrange, from a first pass over a
+// rescannable (possibly compressed) file, or are discovered on the fly for
+// streams. Uncompressed files are parsed and binned on multiple threads.
+// Returns nothing if no points were accepted. Stages and rows are recorded
+// into stats unless it is null.
+template<typename Acc>
+std::optional<HeatmapBinner<Acc>> aggregate(
+    DataReader& reader, const Options& options, Acc acc, int width, int height,
+    RunStats* stats = nullptr) {
+    
+    PointBounds bounds;
+    if (options.x_range) {
+        bounds.min_x = options.x_range->min;
+        bounds.max_x = options.x_range->max;
+    }
+    if (options.y_range) {
+        bounds.min_y = options.y_range->min;
+        bounds.max_y = options.y_range->max;
+    }
+    
+    auto make_binner = [&]() {
+        return HeatmapBinner<Acc>(width, height, bounds.min_x, bounds.max_x, bounds.min_y, bounds.max_y, acc);
+    };
+    
+    // Fill in the bounds not fixed by the user from the points that pass the fixed ones
+    auto widen = [&](const PointBounds& seen) {
+        if (!options.x_range) {
+            bounds.min_x = seen.min_x;
+            bounds.max_x = seen.max_x;
+        }
+        if (!options.y_range) {
+            bounds.min_y = seen.min_y;
+            bounds.max_y = seen.max_y;
+        }
+    };
     
-    return points;
+    std::optional<HeatmapBinner<Acc>> binner;
+    
+    if (options.window > 0) {
+        // Rows are read in order so the window slides forward with their times
+        WindowedHeatmapBinner<Acc> windowed = make_windowed_binner(options, acc, width, height);
+        reader.set_stats(stats);
+        {
+            RunStats::Scope timer(stats, Stage::Bin);
+            reader.for_each_point<double>(options, windowed_visitor(windowed));
+        }
+        if (stats) stats->rows_binned = windowed.points();
+        
+        if (windowed.points() == 0) return std::nullopt;
+        RunStats::Scope timer(stats, Stage::Merge);
+        return windowed.output();
+    } else if (!options.input_path.empty() && is_regular_file(options.input_path) &&
+               file_compression(options.input_path) == Compression::None) {
+        // Split the mapping into line-aligned chunks, one per thread. Each
+        // worker fills its own partial bounds/grid; partials are merged after.
+        MappedFile file(options.input_path);
+        size_t threads = thread_count(options);
+        
+        if (!options.x_range || !options.y_range) {
+            // First pass over the mapping finds the missing bounds. Rows are
+            // only counted on the binning pass, so the reader isn't attached yet.
+            RunStats::Scope timer(stats, Stage::Bounds);
+            auto bounds_visitor = [](PointBounds& seen) {
+                return [&seen](const DataPoint<double>& point) {
+                    seen.add(point.x, point.y);
+                };
+            };
+            
+            std::vector<PointBounds> partial_bounds(threads);
+            std::vector<decltype(bounds_visitor(partial_bounds[0]))> visitors;
+            for (auto& seen : partial_bounds) {
+                visitors.push_back(bounds_visitor(seen));
+            }
+            reader.for_each_point_parallel<double>(file.view(), options, visitors);
+            
+            PointBounds seen;
+            for (const auto& partial : partial_bounds) {
+                seen.merge(partial);
+            }
+            if (seen.empty()) return std::nullopt;
+            widen(seen);
+        }
+        
+        // Second pass (or the only one, with fixed bounds) bins the rows
+        reader.set_stats(stats);
+        std::vector<HeatmapBinner<Acc>> partial_grids(threads, make_binner());
+        {
+            RunStats::Scope timer(stats, Stage::Bin);
+            std::vector<decltype(binning_visitor(partial_grids[0]))> visitors;
+            for (auto& partial : partial_grids) {
+                visitors.push_back(binning_visitor(partial));
+            }
+            reader.for_each_point_parallel<double>(file.view(), options, visitors);
+        }
+        
+        RunStats::Scope timer(stats, Stage::Merge);
+        binner.emplace(make_binner());
+        for (const auto& partial : partial_grids) {
+            binner->merge(partial);
+        }
+    } else if ((options.x_range && options.y_range) ||
+               (!options.input_path.empty() && is_regular_file(options.input_path))) {
+        if (!options.x_range || !options.y_range) {
+            // A compressed file can be decompressed again, so a first pass
+            // finds the missing bounds as for an uncompressed one
+            RunStats::Scope timer(stats, Stage::Bounds);
+            PointBounds seen;
+            reader.for_each_point<double>(options, [&seen](const DataPoint<double>& point) {
+                seen.add(point.x, point.y);
+            });
+            if (seen.empty()) return std::nullopt;
+            widen(seen);
+        }
+        
+        // Rows go straight into the grid
+        reader.set_stats(stats);
+        RunStats::Scope timer(stats, Stage::Bin);
+        binner.emplace(make_binner());
+        reader.for_each_point<double>(options, binning_visitor(*binner));
+    } else {
+        // A stream can't be rescanned: bin adaptively as the range is discovered
+        AdaptiveHeatmapBinner<Acc> adaptive(width, height, adaptive_resolution<Acc>(width, height), 4096, acc);
+        if (options.x_range) adaptive.fix_x_bounds(options.x_range->min, options.x_range->max);
+        if (options.y_range) adaptive.fix_y_bounds(options.y_range->min, options.y_range->max);
+        
+        reader.set_stats(stats);
+        {
+            RunStats::Scope timer(stats, Stage::Bin);
+            reader.for_each_point<double>(options, binning_visitor(adaptive));
+        }
+        if (stats) stats->rows_binned = adaptive.points();
+        
+        if (adaptive.points() == 0) return std::nullopt;
+        RunStats::Scope timer(stats, Stage::Merge);
+        return adaptive.output();
+    }
+    
+    if (stats) stats->rows_binned = binner->points();
+    if (binner->points() == 0) return std::nullopt;
+    return binner;
 }
 
-// Main function
-int main(int argc, char* argv[]) {
+// Write binner's cell states, built by func, to path ("-" for stdout)
+template<typename Acc>
+void emit_grid(const HeatmapBinner<Acc>& binner, AggregateFunc func, double quantile, const std::string& path) {
+    if (path == "-") {
+        write_grid(std::cout, binner, func, quantile);
+        std::cout.flush();
+    } else {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create " + path);
+        }
+        write_grid(out, binner, func, quantile);
+    }
+    
+    PointBounds bounds = binner.bounds();
+    std::cerr << "Wrote " << binner.width() << "x" << binner.height() << " grid of " << binner.points()
+              << " points over x [" << bounds.min_x << "; " << bounds.max_x << "], y ["
+              << bounds.min_y << "; " << bounds.max_y << "]" << std::endl;
+}
+
+// Write the pyramid over binner's grid, built by func, to path
+template<typename Acc>
+void emit_pyramid(const GridPyramid<Acc>& pyramid, AggregateFunc func, double quantile, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Cannot create " + path);
+    }
+    pyramid.write(out, func, quantile);
+    
+    const auto& base = pyramid.base();
+    PointBounds bounds = base.bounds();
+    std::cerr << "Wrote " << pyramid.levels() << "-level pyramid over a " << base.width() << "x" << base.height()
+              << " grid of " << base.points() << " points over x [" << bounds.min_x << "; " << bounds.max_x
+              << "], y [" << bounds.min_y << "; " << bounds.max_y << "]" << std::endl;
+}
+
+// Bin points into binner on the calling thread while a second thread redraws
+// the map every options.refresh seconds. Ingestion never waits for a frame:
+// points are added under try_lock, and any that arrive while the renderer is
+// taking a snapshot are queued and added with the next point that gets in.
+// On a terminal each frame replaces the previous one in place.
+template<typename Binner, typename Bin>
+void follow_into(Binner& binner, Bin bin, DataReader& reader, const Options& options, std::istream& in,
+                 bool scaled, RunStats* stats) {
+    std::mutex grid_lock;
+    std::mutex signal_lock;
+    std::condition_variable wake;
+    bool done = false;
+    bool redraw_in_place = isatty(STDOUT_FILENO);
+    
+    auto draw = [&](size_t& drawn_lines) {
+        std::optional<Grid<typename Binner::Result>> snapshot;
+        size_t points;
+        double factor = 1.0;
+        {
+            std::lock_guard<std::mutex> guard(grid_lock);
+            points = binner.points();
+            if (points > 0) {
+                snapshot = binner.result();
+                factor = reader.sample_scale();
+            }
+        }
+        
+        RunStats::Scope timer(stats, Stage::Render);
+        std::string text;
+        if (snapshot) {
+            std::string error = options.sample_error ? error_frame(*snapshot, factor, options) : "";
+            if (scaled) scale_to_input(*snapshot, factor);
+            text = frame_for(*snapshot, options) + error;
+        }
+        text += "Points: " + std::to_string(points) + "\n";
+        
+        if (redraw_in_place && drawn_lines > 0) {
+            std::cout << "\033[" << drawn_lines << "A\033[J";
+        }
+        std::cout << text << std::flush;
+        drawn_lines = std::count(text.begin(), text.end(), '\n');
+    };
+    
+    std::thread renderer([&]() {
+        size_t drawn_lines = 0;
+        auto interval = std::chrono::duration<double>(options.refresh);
+        for (;;) {
+            bool finished;
+            {
+                std::unique_lock<std::mutex> guard(signal_lock);
+                finished = wake.wait_for(guard, interval, [&] { return done; });
+            }
+            draw(drawn_lines);
+            if (finished) return;
+        }
+    });
+    
+    auto stop_renderer = [&]() {
+        {
+            std::lock_guard<std::mutex> guard(signal_lock);
+            done = true;
+        }
+        wake.notify_one();
+        renderer.join();
+    };
+    
+    std::vector<DataPoint<double>> queued;
+    
     try {
-        // Parse command-line arguments
-        Options options = Options::parse(argc, argv);
+        RunStats::Scope timer(stats, Stage::Bin);
+        reader.for_each_point<double>(in, options, [&](const DataPoint<double>& point) {
+            std::unique_lock<std::mutex> guard(grid_lock, std::try_to_lock);
+            if (!guard.owns_lock()) {
+                queued.push_back(point);
+                return;
+            }
+            for (const auto& waiting : queued) bin(waiting);
+            queued.clear();
+            bin(point);
+        });
         
-        // Read data from stdin
-        DataReader reader(options.delimiter);
-        auto data_points = reader.read_data<double>(options);
+        std::lock_guard<std::mutex> guard(grid_lock);
+        for (const auto& waiting : queued) bin(waiting);
+    } catch (...) {
+        stop_renderer();
+        throw;
+    }
+    
+    // The final frame shows every point
+    stop_renderer();
+}
+
+// Live mode: accumulate the input incrementally and redraw as it streams.
+// Returns the number of points binned.
+template<typename Acc>
+size_t follow_heatmap(
+    DataReader& reader, const Options& options, Acc acc, int width, int height,
+    RunStats* stats = nullptr) {
+    
+    std::unique_ptr<std::istream> file;
+    std::istream* in = &std::cin;
+    if (!options.input_path.empty()) {
+        if (is_regular_file(options.input_path) && is_columnar(MappedFile(options.input_path).view())) {
+            throw std::runtime_error("--follow reads text; " + options.input_path + " is a columnar table");
+        }
+        if (file_compression(options.input_path) != Compression::None) {
+            file = std::make_unique<DecompressedStream>(options.input_path, static_cast<size_t>(options.threads));
+        } else {
+            file = std::make_unique<std::ifstream>(options.input_path);
+        }
+        if (!*file) {
+            throw std::runtime_error("Cannot open " + options.input_path);
+        }
+        in = file.get();
+    }
+    
+    reader.set_stats(stats);
+    if (options.window > 0) {
+        WindowedHeatmapBinner<Acc> windowed = make_windowed_binner(options, acc, width, height);
+        follow_into(windowed, windowed_visitor(windowed), reader, options, *in, scales_with_rows<Acc>, stats);
+        return windowed.points();
+    }
+    
+    if (options.x_range && options.y_range) {
+        HeatmapBinner<Acc> binner(width, height, options.x_range->min, options.x_range->max,
+                                  options.y_range->min, options.y_range->max, acc);
+        follow_into(binner, binning_visitor(binner), reader, options, *in, scales_with_rows<Acc>, stats);
+        return binner.points();
+    }
+    
+    AdaptiveHeatmapBinner<Acc> adaptive(width, height, adaptive_resolution<Acc>(width, height), 4096, acc);
+    if (options.x_range) adaptive.fix_x_bounds(options.x_range->min, options.x_range->max);
+    if (options.y_range) adaptive.fix_y_bounds(options.y_range->min, options.y_range->max);
+    follow_into(adaptive, binning_visitor(adaptive), reader, options, *in, scales_with_rows<Acc>, stats);
+    return adaptive.points();
+}
+
+// Print which header row was used, if any
+void report_headers(const DataReader& reader, const Options& options) {
+    if (reader.has_headers()) {
+        std::string headerMode;
+        switch (options.header_mode) {
+            case Options::HeaderMode::Auto:
+                headerMode = "auto-detected";
+                break;
+            case Options::HeaderMode::ForceOn:
+                headerMode = "enabled";
+                break;
+            default:
+                headerMode = "detected";
+        }
         
-        if (data_points.empty()) {
+        std::cout << "Header row " << headerMode << ": ";
+        const auto& headers = reader.get_headers();
+        for (size_t i = 0; i < headers.size(); ++i) {
+            std::cout << (i > 0 ? ", " : "") << headers[i];
+        }
+        std::cout << std::endl;
+    } else if (options.header_mode == Options::HeaderMode::ForceOn) {
+        std::cerr << "Warning: Header mode forced on, but no data was read" << std::endl;
+    }
+}
+
+// Aggregate and render the heatmap
+template<typename Acc>
+int run_heatmap(DataReader& reader, const Options& options, Acc acc, int width, int height) {
+    std::optional<RunStats> stats;
+    if (options.stats) stats.emplace();
+    RunStats* recorder = stats ? &*stats : nullptr;
+    
+    if (options.follow) {
+        size_t points = follow_heatmap(reader, options, acc, width, height, recorder);
+        if (stats) {
+            stats->rows_binned = points;
+            stats->print(std::cerr);
+        }
+        if (points == 0) {
             std::cerr << "No valid data points were read." << std::endl;
             return 1;
         }
-        
-        // Inform about header detection
-        if (reader.has_headers()) {
-            std::string headerMode;
-            switch (options.header_mode) {
-                case Options::HeaderMode::Auto:
-                    headerMode = "auto-detected";
-                    break;
-                case Options::HeaderMode::ForceOn:
-                    headerMode = "enabled";
-                    break;
-                default:
-                    headerMode = "detected";
+        return 0;
+    }
+    
+    // With --cache, read the selected columns from the sidecar instead
+    std::optional<Options> cached;
+    if (options.cache) {
+        if (auto sidecar = cached_columns(reader, options, thread_count(options), recorder)) {
+            cached = options;
+            cached->input_path = *sidecar;
+        }
+    }
+    
+    auto binner = aggregate(reader, cached ? *cached : options, acc, width, height, recorder);
+    
+    if (!binner) {
+        if (stats) stats->print(std::cerr);
+        std::cerr << "No valid data points were read." << std::endl;
+        return 1;
+    }
+    
+    if (!options.emit_grid.empty()) {
+        emit_grid(*binner, to_aggregate_func(options.aggregation), options.aggregation.quantile, options.emit_grid);
+        if (stats) stats->print(std::cerr);
+        return 0;
+    }
+    if (!options.pyramid.empty()) {
+        std::optional<GridPyramid<Acc>> pyramid;
+        {
+            RunStats::Scope timer(recorder, Stage::Merge);
+            pyramid.emplace(std::move(*binner));
+        }
+        emit_pyramid(*pyramid, to_aggregate_func(options.aggregation), options.aggregation.quantile, options.pyramid);
+        if (stats) stats->print(std::cerr);
+        return 0;
+    }
+    
+    // A sample's counts and sums are scaled up to estimates for the whole input
+    std::optional<Grid<typename Acc::Result>> heatmap;
+    std::string error;
+    {
+        RunStats::Scope timer(recorder, Stage::Merge);
+        heatmap = binner->result();
+        if (options.sample_error) error = error_frame(*heatmap, reader.sample_scale(), options);
+        if (scales_with_rows<Acc>) scale_to_input(*heatmap, reader.sample_scale());
+    }
+    
+    report_headers(reader, options);
+    std::cout << sample_note<Acc>(options, reader);
+    {
+        RunStats::Scope timer(recorder, Stage::Render);
+        std::cout << frame_for(*heatmap, options) << error << std::flush;
+    }
+    
+    if (stats) stats->print(std::cerr);
+    return 0;
+}
+
+// Write the text input as a columnar table, keeping options.columns (or
+// every field of the first row). Names come from the header row, if any.
+int run_convert(DataReader& reader, const Options& options) {
+    std::optional<ColumnarBuilder> builder;
+    reader.for_each_record(options, [&](const std::vector<std::string_view>& fields) {
+        if (!builder) {
+            // The first data row fixes the columns
+            std::vector<size_t> positions;
+            if (options.columns.empty()) {
+                for (size_t i = 0; i < fields.size(); ++i) positions.push_back(i);
+            } else {
+                for (const auto& column : options.columns) {
+                    positions.push_back(reader.field_index(column, fields.size()));
+                }
             }
             
-            std::cout << "Header row " << headerMode << ": ";
             const auto& headers = reader.get_headers();
-            for (size_t i = 0; i < headers.size(); ++i) {
-                std::cout << (i > 0 ? ", " : "") << headers[i];
+            std::vector<std::string> names;
+            for (size_t position : positions) {
+                names.push_back(position < headers.size() ? headers[position] : std::string());
+            }
+            builder.emplace(std::move(names), std::move(positions));
+        }
+        builder->add_row(fields);
+    });
+    
+    if (!builder) {
+        std::cerr << "No data rows were read." << std::endl;
+        return 1;
+    }
+    
+    if (options.output_path == "-") {
+        builder->write(std::cout);
+        std::cout.flush();
+    } else {
+        std::ofstream out(options.output_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot create " + options.output_path);
+        }
+        builder->write(out);
+    }
+    
+    std::cerr << "Wrote " << builder->rows() << " rows:";
+    for (const auto& column : builder->schema()) {
+        std::cerr << " " << (column.name.empty() ? "?" : column.name) << ":" << column_type_name(column.type);
+    }
+    std::cerr << std::endl;
+    if (builder->non_numeric() > 0) {
+        std::cerr << "Warning: " << builder->non_numeric()
+                  << " missing or non-numeric fields stored as NaN" << std::endl;
+    }
+    return 0;
+}
+
+// Merge the grid files in options.grid_paths, which must have been built
+// with the same aggregation, dimensions and bounds, then render the result
+// or write it with --emit-grid
+int run_merge(const Options& options) {
+    std::vector<MappedFile> files;
+    std::vector<GridFileHeader> headers;
+    for (const auto& path : options.grid_paths) {
+        files.emplace_back(path);
+        std::string_view view = files.back().view();
+        try {
+            headers.push_back(read_grid_header(view));
+        } catch (const std::exception& e) {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+        
+        const GridFileHeader& first = headers.front();
+        const GridFileHeader& header = headers.back();
+        if (header.func != first.func || header.quantile != first.quantile) {
+            throw std::runtime_error(path + " was built with a different aggregation than " + options.grid_paths[0]);
+        }
+        if (header.width != first.width || header.height != first.height ||
+            header.bounds.min_x != first.bounds.min_x || header.bounds.max_x != first.bounds.max_x ||
+            header.bounds.min_y != first.bounds.min_y || header.bounds.max_y != first.bounds.max_y) {
+            throw std::runtime_error(path + " doesn't align with " + options.grid_paths[0] +
+                                     "; build every grid with the same --xrange and --yrange");
+        }
+    }
+    
+    const GridFileHeader& first = headers.front();
+    return with_accumulator(first.func, [&](auto acc) {
+        using Acc = decltype(acc);
+        HeatmapBinner<Acc> merged(first.width, first.height, first.bounds.min_x, first.bounds.max_x,
+                                  first.bounds.min_y, first.bounds.max_y, acc);
+        for (size_t i = 0; i < files.size(); ++i) {
+            try {
+                merged.merge(read_grid<Acc>(files[i].view(), acc));
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error(options.grid_paths[i] + ": " + e.what());
             }
-            std::cout << std::endl;
-        } else if (options.header_mode == Options::HeaderMode::ForceOn) {
-            std::cerr << "Warning: Header mode forced on, but no data was read" << std::endl;
         }
+        
+        if (!options.emit_grid.empty()) {
+            emit_grid(merged, first.func, first.quantile, options.emit_grid);
+            return 0;
+        }
+        if (merged.points() == 0) {
+            std::cerr << "No data points in the merged grids." << std::endl;
+            return 1;
+        }
+        std::cout << frame_for(merged.result(), options);
+        std::cout << "Points: " << merged.points() << std::endl;
+        return 0;
+    }, first.quantile);
+}
+
+// Render options.width x options.height cells of the pyramid in
+// options.pyramid, over --xrange/--yrange or the pyramid's whole bounds
+int run_view(const Options& options) {
+    MappedFile file(options.pyramid);
+    GridFileHeader header;
+    try {
+        header = read_pyramid_header(file.view());
+    } catch (const std::exception& e) {
+        throw std::runtime_error(options.pyramid + ": " + e.what());
+    }
+    
+    return with_accumulator(header.func, [&](auto acc) {
+        using Acc = decltype(acc);
+        std::optional<GridPyramid<Acc>> pyramid;
+        try {
+            pyramid.emplace(GridPyramid<Acc>::read(file.view(), acc));
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(options.pyramid + ": " + e.what());
+        }
+        if (pyramid->points() == 0) {
+            std::cerr << "No data points in the pyramid." << std::endl;
+            return 1;
+        }
+        
+        PointBounds region = header.bounds;
+        if (options.x_range) {
+            region.min_x = options.x_range->min;
+            region.max_x = options.x_range->max;
+        }
+        if (options.y_range) {
+            region.min_y = options.y_range->min;
+            region.max_y = options.y_range->max;
+        }
+        
+        GlyphMode glyphs = to_glyph_mode(options.glyphs);
+        auto [columns, rows] = display_size(options);
+        int width = columns * glyph_cells_x(glyphs);
+        int height = rows * glyph_cells_y(glyphs);
+        size_t level = pyramid->level_for(width, height, region);
+        render_heatmap(pyramid->view(width, height, region).result(), true, std::cout, glyphs, to_color_table(options),
+                       to_scale_mode(options.scale));
+        std::cout << "Level " << level << " of " << pyramid->levels() << " ("
+                  << pyramid->level(level).width() << "x" << pyramid->level(level).height() << " cells)" << std::endl;
+        return 0;
+    }, header.quantile);
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+    try {
+        // Parse command-line arguments
+        Options options = Options::parse(argc, argv);
+        
+        DataReader reader(options.delimiter);
 
         // Process data based on command
         if (options.command == CommandType::Heatmap) {
-            // Default heatmap dimensions
-            const int width = 20;
-            const int height = 10;
-
-            // Check if we need aggregation
-            if (options.aggregation.function == AggregationSpec::Function::Count && 
-                !options.aggregation.field.has_value()) {
-                // Simple 2D heatmap with count aggregation
-                auto points_2d = convert_to_2d_points(data_points);
-                auto heatmap = build_heatmap_data(points_2d, width, height);
-                render_heatmap(heatmap, true);
-            } else {
-                // 3D heatmap with aggregation
-                auto points_3d = convert_to_3d_points(data_points);
-                
-                // Map aggregation function
-                AggregateFunc agg_func = AggregateFunc::Count;
-                switch (options.aggregation.function) {
-                    case AggregationSpec::Function::Sum:
-                        agg_func = AggregateFunc::Sum;
-                        break;
-                    case AggregationSpec::Function::Avg:
-                        agg_func = AggregateFunc::Avg;
-                        break;
-                    default:
-                        agg_func = AggregateFunc::Count;
-                        break;
-                }
-                
-                auto heatmap = build_heatmap_data(points_3d, agg_func, width, height);
-                render_heatmap(heatmap, true);
-            }
+            // Each character shows one or more cells; a pyramid or --pool
+            // aggregates into a fine base grid instead
+            bool fine = !options.pyramid.empty() || options.pool != Options::Pool::None;
+            GlyphMode glyphs = to_glyph_mode(options.glyphs);
+            auto [columns, rows] = display_size(options);
+            const int width = fine ? options.base_width : columns * glyph_cells_x(glyphs);
+            const int height = fine ? options.base_height : rows * glyph_cells_y(glyphs);
+
+            // Pick the per-cell accumulator once; everything below is compiled for it
+            return with_accumulator(to_aggregate_func(options.aggregation), [&](auto acc) {
+                return run_heatmap(reader, options, acc, width, height);
+            }, options.aggregation.quantile);
+        } else if (options.command == CommandType::Convert) {
+            return run_convert(reader, options);
+        } else if (options.command == CommandType::Merge) {
+            return run_merge(options);
+        } else if (options.command == CommandType::View) {
+            return run_view(options);
         } else {
             std::cerr << "Unsupported command." << std::endl;
             return 1;
@@ -119,15 +860,56 @@ int main(int argc, char* argv[]) {
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         std::cerr << "Usage: tplt [options] command [fields]" << std::endl;
+        std::cerr << "Commands:" << std::endl;
+        std::cerr << "  heatmap <x> <y> [agg(field)]  Render a heatmap (input may be a columnar table)" << std::endl;
+        std::cerr << "  convert <out> [fields]        Write text input as a columnar table for fast replots" << std::endl;
+        std::cerr << "  merge <grid>...               Combine grids written by --emit-grid and render them" << std::endl;
+        std::cerr << "  view <pyramid>                Render a pyramid at --width x --height over --xrange/--yrange" << std::endl;
         std::cerr << "Options:" << std::endl;
-        std::cerr << "  -d<char>      Set delimiter character" << std::endl;
-        std::cerr << "  --header      Force first row to be treated as header" << std::endl;
-        std::cerr << "  --no-header   Force data to be treated as having no header" << std::endl;
+        std::cerr << "  -d<char>            Set delimiter character" << std::endl;
+        std::cerr << "  -i <path>           Read data from a file (plain, gzip or zstd) instead of stdin" << std::endl;
+        std::cerr << "  --xrange <min:max>  Fix x bounds; points outside are dropped" << std::endl;
+        std::cerr << "  --yrange <min:max>  Fix y bounds; points outside are dropped" << std::endl;
+        std::cerr << "  -j <n>              Parser threads for file input (default: one per core)" << std::endl;
+        std::cerr << "  --follow            Redraw the map as input streams in" << std::endl;
+        std::cerr << "  --refresh <sec>     Seconds between redraws with --follow (default: 1)" << std::endl;
+        std::cerr << "  --time <field>      Time column for --window" << std::endl;
+        std::cerr << "  --window <len>      Only show rows from the last len time units" << std::endl;
+        std::cerr << "  --slices <k>        Sub-grids the window slides by (default: 12)" << std::endl;
+        std::cerr << "  --cache             Keep parsed columns in a sidecar so replots skip parsing" << std::endl;
+        std::cerr << "  --cache-dir <dir>   Like --cache, with sidecars in dir instead of next to the input" << std::endl;
+        std::cerr << "  --emit-grid <path>  Write the aggregated grid instead of rendering it" << std::endl;
+        std::cerr << "  --width <n|auto>    Heatmap width in characters, or the terminal's (default: 20)" << std::endl;
+        std::cerr << "  --height <n|auto>   Heatmap height in characters, or what fits (default: 10)" << std::endl;
+        std::cerr << "  --pool <mode>       Aggregate at --base size, then sum, max or mean pool to the display" << std::endl;
+        std::cerr << "  --glyphs <style>    block (1 cell per character), half (1x2) or braille (2x4)" << std::endl;
+        std::cerr << "  --color <palette>   Color the map: viridis, magma or gray (256 colors)" << std::endl;
+        std::cerr << "  --scale <mode>      Value to intensity: linear, log, sqrt or quantile (default: linear)" << std::endl;
+        std::cerr << "  --truecolor         Use 24-bit colors with --color" << std::endl;
+        std::cerr << "  --pyramid <path>    Write a zoomable multi-resolution pyramid instead of rendering" << std::endl;
+        std::cerr << "  --base <w>x<h>      Pyramid base or --pool grid size in cells (default: 512x256)" << std::endl;
+        std::cerr << "  --sample <rate>     Parse a random share of rows, 0 < rate <= 1; counts and sums scale up" << std::endl;
+        std::cerr << "  --max-rows <n>      Stop reading after the first n data rows" << std::endl;
+        std::cerr << "  --reservoir <n>     Parse a uniform random sample of n rows from the whole input" << std::endl;
+        std::cerr << "  --seed <n>          Random seed for --sample and --reservoir (default: 1)" << std::endl;
+        std::cerr << "  --error             Also map each cell's relative error under --sample/--reservoir" << std::endl;
+        std::cerr << "  --stats             Print stage timings and row counts to stderr" << std::endl;
+        std::cerr << "  --header            Force first row to be treated as header" << std::endl;
+        std::cerr << "  --no-header         Force data to be treated as having no header" << std::endl;
         std::cerr << "Examples:" << std::endl;
         std::cerr << "  cat data.txt | tplt -d',' heatmap f1 f2" << std::endl;
         std::cerr << "  cat data.txt | tplt heatmap f2 f4" << std::endl;
+        std::cerr << "  tplt -d',' -i data.csv heatmap f1 f2" << std::endl;
+        std::cerr << "  tail -f access.log | tplt --follow heatmap f1 f2" << std::endl;
         std::cerr << "  cat data.txt | tplt -d'|' heatmap f3 f5 avg(f7)" << std::endl;
+        std::cerr << "  cat data.txt | tplt -d'|' heatmap f3 f5 stddev(f7)" << std::endl;
+        std::cerr << "  cat data.txt | tplt -d'|' heatmap f3 f5 p99(f7)" << std::endl;
+        std::cerr << "  cat logs.csv | tplt -d',' heatmap region hour distinct(user)" << std::endl;
         std::cerr << "  cat data.csv | tplt -d',' --header heatmap xpos ypos avg(value)" << std::endl;
+        std::cerr << "  tplt -d',' -i data.csv convert data.tcol && tplt -i data.tcol heatmap xpos ypos" << std::endl;
+        std::cerr << "  tplt --xrange 0:1 --yrange 0:1 --emit-grid a.grid heatmap f1 f2 && tplt merge a.grid b.grid" << std::endl;
+        std::cerr << "  tplt -d',' -i huge.csv --sample 0.01 --error heatmap f1 f2" << std::endl;
+        std::cerr << "  tplt -i data.csv --pyramid data.tpyr heatmap f1 f2 && tplt --width 60 --xrange 0:5 view data.tpyr" << std::endl;
         return 1;
     }
     
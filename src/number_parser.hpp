@@ -0,0 +1,143 @@
+#pragma once
+
+#include <string_view>
+#include <system_error>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+
+namespace tplt {
+
+namespace detail {
+
+// Exactly representable powers of ten (10^22 is the largest that fits in a double)
+inline constexpr double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline uint64_t load_eight(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) {
+        v = __builtin_bswap64(v);
+    }
+    return v;
+}
+
+// True if all eight bytes of v are ASCII digits (SWAR: one check for 8 chars)
+inline bool is_eight_digits(uint64_t v) {
+    return (((v & 0xF0F0F0F0F0F0F0F0ULL) |
+             (((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+            0x3333333333333333ULL);
+}
+
+// Value of eight ASCII digits, first digit in the lowest byte
+inline uint32_t parse_eight_digits(uint64_t v) {
+    v = (v & 0x0F0F0F0F0F0F0F0FULL) * 2561 >> 8;
+    v = (v & 0x00FF00FF00FF00FFULL) * 6553601 >> 16;
+    return static_cast<uint32_t>((v & 0x0000FFFF0000FFFFULL) * 42949672960001ULL >> 32);
+}
+
+// Accumulate a run of digits into mantissa, eight at a time where possible
+inline const char* parse_digits(const char* p, const char* end, uint64_t& mantissa, int& digits) {
+    while (end - p >= 8) {
+        uint64_t chunk = load_eight(p);
+        if (!is_eight_digits(chunk)) break;
+        mantissa = mantissa * 100000000ULL + parse_eight_digits(chunk);
+        digits += 8;
+        p += 8;
+    }
+    while (p < end && static_cast<unsigned char>(*p - '0') <= 9) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        digits++;
+        p++;
+    }
+    return p;
+}
+
+// General case: anything the fast path can't round exactly, plus inf/nan
+inline std::errc parse_double_slow(const char* begin, const char* end, double& out) {
+    if (begin < end && *begin == '+') {
+        begin++;
+        if (begin < end && *begin == '-') return std::errc::invalid_argument;
+    }
+    auto [ptr, ec] = std::from_chars(begin, end, out);
+    if (ec != std::errc{}) return ec;
+    return ptr == end ? std::errc{} : std::errc::invalid_argument;
+}
+
+} // namespace detail
+
+// Parse the whole of text as a decimal floating-point number. Locale
+// independent, never allocates or throws. Returns std::errc{} on success,
+// std::errc::invalid_argument if text is not entirely a number and
+// std::errc::result_out_of_range if it doesn't fit in a double.
+//
+// Plain decimals ([+-]digits[.digits][e[+-]digits]) with at most 19
+// significant digits and a small enough exponent are converted directly,
+// reading digits eight at a time; the result is correctly rounded because
+// both the mantissa and the power of ten are exact doubles. Everything else
+// goes through std::from_chars.
+inline std::errc parse_double(std::string_view text, double& out) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const char* p = begin;
+
+    if (p == end) return std::errc::invalid_argument;
+
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    p = detail::parse_digits(p, end, mantissa, digits);
+
+    int exponent = 0;
+    if (p < end && *p == '.') {
+        p++;
+        const char* fraction = p;
+        p = detail::parse_digits(p, end, mantissa, digits);
+        exponent = -static_cast<int>(p - fraction);
+    }
+
+    if (digits > 0 && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            exp_negative = *q == '-';
+            q++;
+        }
+        int exp_value = 0;
+        const char* exp_digits = q;
+        while (q < end && static_cast<unsigned char>(*q - '0') <= 9) {
+            if (exp_value < 100000) exp_value = exp_value * 10 + (*q - '0');
+            q++;
+        }
+        if (q == exp_digits) return std::errc::invalid_argument;
+        exponent += exp_negative ? -exp_value : exp_value;
+        p = q;
+    }
+
+    if (p == end && digits > 0 && digits <= 19 &&
+        mantissa <= (uint64_t{1} << 53) && exponent >= -22 && exponent <= 22) {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / detail::POW10[-exponent] : value * detail::POW10[exponent];
+        out = negative ? -value : value;
+        return std::errc{};
+    }
+
+    return detail::parse_double_slow(begin, end, out);
+}
+
+// True if the whole of text parses as a number
+inline bool is_number(std::string_view text) {
+    double ignored;
+    return parse_double(text, ignored) == std::errc{};
+}
+
+} // namespace tplt
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "byte_io.hpp"
+
+// Mergeable quantile sketch with bounded memory (DDSketch). Values are counted
+// in logarithmic buckets: bucket i holds magnitudes in (gamma^(i-1), gamma^i],
+// so any quantile is returned within RELATIVE_ACCURACY of the true value.
+// Positive and negative values have separate bucket stores; zeros are counted
+// apart. Each store keeps at most MAX_BUCKETS contiguous buckets; past that,
+// the lowest buckets are folded together, which only degrades the smallest
+// magnitudes (a span of about eight orders of magnitude is kept intact).
+// Merging adds bucket counts, so it is exact and order-independent.
+class QuantileSketch {
+public:
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+    static constexpr int32_t MAX_BUCKETS = 1024;
+
+private:
+    static constexpr double GAMMA = (1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY);
+
+    static double inv_log_gamma() {
+        static const double value = 1.0 / std::log(GAMMA);
+        return value;
+    }
+
+    // Contiguous bucket counts, counts[i] for bucket offset + i
+    struct Store {
+        int32_t offset = 0;
+        std::vector<uint64_t> counts;
+
+        int32_t top() const { return offset + static_cast<int32_t>(counts.size()) - 1; }
+
+        // Fold every bucket below low into bucket low
+        void raise_floor(int32_t low) {
+            if (low <= offset) return;
+            size_t drop = std::min(static_cast<size_t>(low - offset), counts.size());
+            uint64_t folded = std::accumulate(counts.begin(), counts.begin() + drop, uint64_t{0});
+            counts.erase(counts.begin(), counts.begin() + drop);
+            offset = low;
+            if (counts.empty()) counts.push_back(0);
+            counts[0] += folded;
+        }
+
+        void add(int32_t index, uint64_t n) {
+            if (counts.empty()) {
+                offset = index;
+                counts.assign(1, n);
+                return;
+            }
+            if (index > top()) {
+                raise_floor(std::max(offset, index - MAX_BUCKETS + 1));
+                counts.resize(static_cast<size_t>(index - offset) + 1, 0);
+            } else if (index < offset) {
+                // Values below the kept span land in its lowest bucket
+                int32_t low = std::max(index, top() - MAX_BUCKETS + 1);
+                if (low < offset) {
+                    counts.insert(counts.begin(), static_cast<size_t>(offset - low), 0);
+                    offset = low;
+                }
+                index = low;
+            }
+            counts[static_cast<size_t>(index - offset)] += n;
+        }
+
+        void merge(const Store& other) {
+            for (size_t i = 0; i < other.counts.size(); ++i) {
+                if (other.counts[i] > 0) add(other.offset + static_cast<int32_t>(i), other.counts[i]);
+            }
+        }
+
+        void encode(std::string& out) const {
+            put_bytes(out, offset);
+            put_bytes(out, static_cast<uint32_t>(counts.size()));
+            for (uint64_t n : counts) put_bytes(out, n);
+        }
+
+        void decode(std::string_view& in) {
+            offset = take_bytes<int32_t>(in);
+            uint32_t size = take_bytes<uint32_t>(in);
+            // Buckets must lie where finite values can put them, which also
+            // keeps top() and the index arithmetic of add() from overflowing
+            if (size > static_cast<uint32_t>(MAX_BUCKETS) || offset < lowest_bucket() ||
+                static_cast<int64_t>(offset) + size - 1 > highest_bucket()) {
+                throw std::runtime_error("Corrupt quantile sketch");
+            }
+            counts.resize(size);
+            for (auto& n : counts) n = take_bytes<uint64_t>(in);
+        }
+    };
+
+    Store positive_;
+    Store negative_;        // Buckets of -v for negative values
+    uint64_t zeros_ = 0;
+    uint64_t count_ = 0;
+
+    static int32_t bucket_of(double magnitude) {
+        return static_cast<int32_t>(std::ceil(std::log(magnitude) * inv_log_gamma()));
+    }
+
+    // Buckets of the smallest and largest finite magnitudes
+    static int32_t lowest_bucket() {
+        static const int32_t value = bucket_of(std::numeric_limits<double>::denorm_min());
+        return value;
+    }
+
+    static int32_t highest_bucket() {
+        static const int32_t value = bucket_of(std::numeric_limits<double>::max());
+        return value;
+    }
+
+    // Value standing in for every magnitude in bucket i (relative error bound midpoint)
+    static double bucket_value(int32_t index) {
+        return 2.0 * std::pow(GAMMA, index) / (GAMMA + 1);
+    }
+
+public:
+    // Add a value; NaN and infinities are ignored
+    void add(double v) {
+        if (!std::isfinite(v)) return;
+        if (v > 0) {
+            positive_.add(bucket_of(v), 1);
+        } else if (v < 0) {
+            negative_.add(bucket_of(-v), 1);
+        } else {
+            zeros_++;
+        }
+        count_++;
+    }
+
+    void merge(const QuantileSketch& other) {
+        positive_.merge(other.positive_);
+        negative_.merge(other.negative_);
+        zeros_ += other.zeros_;
+        count_ += other.count_;
+    }
+
+    uint64_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    // Append a binary encoding of the sketch to out
+    void encode(std::string& out) const {
+        put_bytes(out, count_);
+        put_bytes(out, zeros_);
+        positive_.encode(out);
+        negative_.encode(out);
+    }
+
+    // Read a sketch written by encode from the front of in
+    static QuantileSketch decode(std::string_view& in) {
+        QuantileSketch sketch;
+        sketch.count_ = take_bytes<uint64_t>(in);
+        sketch.zeros_ = take_bytes<uint64_t>(in);
+        sketch.positive_.decode(in);
+        sketch.negative_.decode(in);
+
+        // quantile() walks the buckets for a rank below count_, so the
+        // buckets must hold exactly count_ values
+        uint64_t total = sketch.zeros_;
+        for (const Store* store : {&sketch.positive_, &sketch.negative_}) {
+            for (uint64_t n : store->counts) {
+                if (n > sketch.count_ - std::min(total, sketch.count_)) {
+                    throw std::runtime_error("Corrupt quantile sketch");
+                }
+                total += n;
+            }
+        }
+        if (total != sketch.count_) throw std::runtime_error("Corrupt quantile sketch");
+        return sketch;
+    }
+
+    // Value at quantile q in [0, 1]; the sketch must not be empty
+    double quantile(double q) const {
+        q = std::clamp(q, 0.0, 1.0);
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1));
+        uint64_t seen = 0;
+
+        // Negative values, most negative (largest magnitude) first
+        for (size_t i = negative_.counts.size(); i-- > 0;) {
+            seen += negative_.counts[i];
+            if (seen > rank) return -bucket_value(negative_.offset + static_cast<int32_t>(i));
+        }
+        seen += zeros_;
+        if (seen > rank) return 0.0;
+        for (size_t i = 0; i < positive_.counts.size(); ++i) {
+            seen += positive_.counts[i];
+            if (seen > rank) return bucket_value(positive_.offset + static_cast<int32_t>(i));
+        }
+        return positive_.counts.empty() ? 0.0 : bucket_value(positive_.top());
+    }
+};
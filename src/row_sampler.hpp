@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <algorithm>
+
+namespace tplt {
+
+// Decides which data rows a reader parses when only a sample is wanted
+// (--sample, --max-rows, --reservoir). The reader asks next() once per data
+// row, before tokenizing it, so a skipped row costs only finding its end.
+//
+// Bernoulli keeps each row with probability rate, drawing the gap to the
+// next kept row from a geometric distribution instead of a coin per row.
+// Prefix keeps the first rows and then stops the read. Reservoir keeps a
+// uniform sample of size rows from the whole input (Li's Algorithm L, which
+// also draws gaps), so only about size * log(rows / size) rows are parsed.
+class RowSampler {
+public:
+    enum class Mode {
+        All,
+        Bernoulli,
+        Prefix,
+        Reservoir
+    };
+
+    static constexpr uint64_t SKIP = std::numeric_limits<uint64_t>::max();  // Don't parse this row
+    static constexpr uint64_t STOP = SKIP - 1;                              // Don't read any further
+
+private:
+    Mode mode_ = Mode::All;
+    double rate_ = 1.0;
+    uint64_t size_ = 0;      // Prefix or reservoir rows
+    uint64_t seen_ = 0;      // Rows next() has been asked about
+    uint64_t next_ = 0;      // Index of the next row to keep
+    double weight_ = 0;      // Reservoir: Algorithm L's W
+    std::mt19937_64 rng_;
+
+    // Uniform in (0, 1]
+    double unit() {
+        return (static_cast<double>(rng_() >> 11) + 1) * 0x1.0p-53;
+    }
+
+    // Rows to pass over before the next kept one, keeping each with chance p
+    uint64_t gap(double p) {
+        if (p >= 1) return 0;
+        double rows = std::floor(std::log(unit()) / std::log1p(-p));
+        return rows < 9e18 ? static_cast<uint64_t>(rows) : STOP;
+    }
+
+    // Index of the row after from plus rows skipped ones
+    static uint64_t after(uint64_t from, uint64_t rows) {
+        return rows >= STOP - from ? STOP : from + rows;
+    }
+
+    RowSampler(Mode mode, double rate, uint64_t size, uint64_t seed)
+        : mode_(mode), rate_(rate), size_(size), rng_(seed) {
+        if (mode_ == Mode::Bernoulli) {
+            next_ = gap(rate_);
+        } else if (mode_ == Mode::Reservoir) {
+            weight_ = std::exp(std::log(unit()) / static_cast<double>(size_));
+            next_ = after(size_, gap(weight_));
+        }
+    }
+
+public:
+    RowSampler() = default;
+
+    static RowSampler bernoulli(double rate, uint64_t seed) { return {Mode::Bernoulli, rate, 0, seed}; }
+    static RowSampler prefix(uint64_t rows) { return {Mode::Prefix, 1.0, rows, 0}; }
+    static RowSampler reservoir(uint64_t size, uint64_t seed) { return {Mode::Reservoir, 1.0, size, seed}; }
+
+    Mode mode() const { return mode_; }
+
+    // Decision for the next data row: SKIP, STOP, or parse it. A kept row's
+    // result is the reservoir slot it replaces (the next free one while the
+    // reservoir fills up), 0 in the other modes.
+    uint64_t next() {
+        uint64_t row = seen_++;
+        switch (mode_) {
+            case Mode::Bernoulli:
+                if (row < next_) return SKIP;
+                next_ = after(row + 1, gap(rate_));
+                return 0;
+            case Mode::Prefix:
+                return row < size_ ? 0 : STOP;
+            case Mode::Reservoir: {
+                if (row < size_) return row;
+                if (row < next_) return SKIP;
+                uint64_t slot = rng_() % size_;
+                weight_ *= std::exp(std::log(unit()) / static_cast<double>(size_));
+                next_ = after(row + 1, gap(weight_));
+                return slot;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    // Rows from here that next() would skip, so block readers can pass over
+    // whole blocks without looking at them
+    uint64_t skippable() const {
+        if (mode_ != Mode::Bernoulli && mode_ != Mode::Reservoir) return 0;
+        if (mode_ == Mode::Reservoir && seen_ < size_) return 0;
+        return next_ > seen_ ? next_ - seen_ : 0;
+    }
+
+    // Pass over rows rows, which must not exceed skippable()
+    void skip(uint64_t rows) { seen_ += rows; }
+
+    // Rows next() has been asked about
+    uint64_t rows_seen() const { return seen_; }
+
+    // Input rows each kept row stands for: what counts and sums estimated
+    // from the sample are scaled up by. A prefix is not a random sample and
+    // isn't scaled.
+    double scale() const {
+        if (mode_ == Mode::Bernoulli) return 1.0 / rate_;
+        if (mode_ == Mode::Reservoir && seen_ > size_) return static_cast<double>(seen_) / size_;
+        return 1.0;
+    }
+};
+
+} // namespace tplt
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sys/resource.h>
+
+namespace tplt {
+
+// Pipeline stages timed by --stats
+enum class Stage {
+    Cache,      // Parse text columns into the column cache (--cache, on a miss)
+    Bounds,     // Parse-only pass over a file to find the data bounds
+    Bin,        // Parse rows and bin them into the grid
+    Merge,      // Combine per-thread grids and finalize aggregates
+    Render,     // Draw the heatmap
+    COUNT
+};
+
+inline const char* stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::Cache: return "cache fill";
+        case Stage::Bounds: return "bounds scan";
+        case Stage::Bin: return "parse + bin";
+        case Stage::Merge: return "merge";
+        case Stage::Render: return "render";
+        default: return "?";
+    }
+}
+
+// Timings and row accounting for one run. Everything that records into it
+// takes a RunStats*, and a null pointer means stats are disabled. Counters are
+// atomic because parser threads flush their totals concurrently (once per
+// chunk, not per row).
+class RunStats {
+public:
+    struct Timing {
+        double wall = 0;
+        double cpu = 0;
+        bool ran = false;
+    };
+
+    // Adds the wall and process CPU time of its lifetime to one stage
+    class Scope {
+    private:
+        RunStats* stats_;
+        Stage stage_;
+        std::chrono::steady_clock::time_point wall_start_;
+        std::clock_t cpu_start_ = 0;
+
+    public:
+        Scope(RunStats* stats, Stage stage) : stats_(stats), stage_(stage) {
+            if (!stats_) return;
+            wall_start_ = std::chrono::steady_clock::now();
+            cpu_start_ = std::clock();
+        }
+
+        ~Scope() {
+            if (!stats_) return;
+            Timing& timing = stats_->timings_[static_cast<size_t>(stage_)];
+            timing.wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start_).count();
+            timing.cpu += static_cast<double>(std::clock() - cpu_start_) / CLOCKS_PER_SEC;
+            timing.ran = true;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> rows_accepted{0};
+    std::atomic<uint64_t> rows_missing_field{0};
+    std::atomic<uint64_t> rows_bad_number{0};
+    std::atomic<uint64_t> rows_out_of_range{0};    // Dropped by the reader's range filter
+    std::atomic<uint64_t> rows_sampled_out{0};     // Passed over by --sample/--max-rows/--reservoir
+    uint64_t rows_binned = 0;
+
+    void add_rows(uint64_t accepted, uint64_t missing_field, uint64_t bad_number, uint64_t out_of_range = 0) {
+        rows_accepted.fetch_add(accepted, std::memory_order_relaxed);
+        rows_missing_field.fetch_add(missing_field, std::memory_order_relaxed);
+        rows_bad_number.fetch_add(bad_number, std::memory_order_relaxed);
+        rows_out_of_range.fetch_add(out_of_range, std::memory_order_relaxed);
+    }
+
+    const Timing& timing(Stage stage) const {
+        return timings_[static_cast<size_t>(stage)];
+    }
+
+    // Peak resident set size of the process in bytes
+    static uint64_t peak_rss_bytes() {
+        struct rusage usage {};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    // Print the stage table and counters
+    void print(std::ostream& out) const {
+        Timing total;
+        for (const auto& timing : timings_) {
+            total.wall += timing.wall;
+            total.cpu += timing.cpu;
+        }
+
+        uint64_t accepted = rows_accepted.load();
+        // Accepted rows the binner dropped (e.g. older than a window) count as outside too
+        uint64_t outside = rows_out_of_range.load() + (accepted > rows_binned ? accepted - rows_binned : 0);
+        auto per_second = [&](double amount) { return total.wall > 0 ? amount / total.wall : 0.0; };
+
+        out << "Stats:\n" << std::fixed << std::setprecision(4);
+        out << "  " << std::left << std::setw(14) << "stage"
+            << std::right << std::setw(10) << "wall s" << std::setw(10) << "cpu s" << "\n";
+        for (size_t i = 0; i < timings_.size(); ++i) {
+            if (!timings_[i].ran) continue;
+            out << "  " << std::left << std::setw(14) << stage_name(static_cast<Stage>(i))
+                << std::right << std::setw(10) << timings_[i].wall << std::setw(10) << timings_[i].cpu << "\n";
+        }
+        out << "  " << std::left << std::setw(14) << "total"
+            << std::right << std::setw(10) << total.wall << std::setw(10) << total.cpu << "\n";
+
+        out << std::setprecision(1);
+        out << "  bytes read:     " << bytes_read.load()
+            << " (" << per_second(static_cast<double>(bytes_read.load())) / 1e6 << " MB/s)\n";
+        out << "  rows accepted:  " << accepted
+            << " (" << per_second(static_cast<double>(accepted)) << " rows/s)\n";
+        out << "  rows binned:    " << rows_binned << "\n";
+        out << "  rows skipped:   " << rows_missing_field.load() << " missing field, "
+            << rows_bad_number.load() << " bad number, " << outside << " outside ranges\n";
+        if (rows_sampled_out.load() > 0) {
+            out << "  sampled out:    " << rows_sampled_out.load() << " rows\n";
+        }
+        out << "  peak RSS:       " << static_cast<double>(peak_rss_bytes()) / (1 << 20) << " MiB\n";
+        out << std::defaultfloat << std::right;
+    }
+
+private:
+    std::array<Timing, static_cast<size_t>(Stage::COUNT)> timings_{};
+};
+
+} // namespace tplt
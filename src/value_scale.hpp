@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "grid.hpp"
+#include "heatmap_builder.hpp"
+
+// How cell values map onto intensity, i.e. onto shades, dots and colors
+enum class ScaleMode {
+    Linear,     // Proportional between min and max
+    Log,        // log(v / min) for positive grids, log(1 + v - min) otherwise
+    Sqrt,       // Square root of the offset from min
+    Quantile    // Equal population: each shade covers as many cells as the next
+};
+
+// Normalization of one grid's values to [0, 1] under a ScaleMode, and back
+// (value_at) for the legend's breakpoints. Building it costs two passes over
+// the cells, none of them a sort: one for min and max and, for quantiles, one
+// filling a histogram whose cumulative counts stand in for the sorted cells.
+//
+// The histogram's bins are even in log(1 + (v - min) / delta), delta being a
+// millionth of the range, so skewed grids (a few hot cells over a long tail
+// of small ones) still get fine bins where most cells are. Within a bin the
+// cumulative count is interpolated linearly.
+class ValueScale {
+public:
+    static constexpr int BINS = 4096;
+    static constexpr double DYNAMIC_RANGE = 1e6;
+
+private:
+    ScaleMode mode_;
+    double min_;
+    double max_;
+    std::vector<double> cdf_;  // Quantile: share of cells below each bin edge, BINS + 1 entries
+
+    // Offset of v from min in the histogram's bin units
+    double bin_position(double v) const {
+        double span = std::log1p(DYNAMIC_RANGE);
+        return std::log1p((v - min_) / (max_ - min_) * DYNAMIC_RANGE) / span * BINS;
+    }
+
+public:
+    template<Numeric T>
+    ValueScale(const Grid<T>& data, ScaleMode mode) : mode_(mode) {
+        auto [low, high] = data.min_max();
+        min_ = static_cast<double>(low);
+        max_ = static_cast<double>(high);
+        // All values the same: stretch below so they render at the top
+        if (min_ == max_) min_ = max_ - 1;
+
+        if (mode_ != ScaleMode::Quantile) return;
+        std::vector<double> counts(BINS, 0.0);
+        for (int y = 0; y < data.height(); ++y) {
+            for (int x = 0; x < data.width(); ++x) {
+                int bin = static_cast<int>(bin_position(static_cast<double>(data(x, y))));
+                counts[std::clamp(bin, 0, BINS - 1)] += 1;
+            }
+        }
+        cdf_.assign(BINS + 1, 0.0);
+        double total = static_cast<double>(data.width()) * data.height();
+        for (int i = 0; i < BINS; ++i) {
+            cdf_[i + 1] = cdf_[i] + counts[i] / total;
+        }
+    }
+
+    ScaleMode mode() const { return mode_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+
+    // Intensity of v in [0, 1]
+    double normalize(double v) const {
+        double range = max_ - min_;
+        switch (mode_) {
+            case ScaleMode::Log:
+                if (min_ > 0) return std::log(v / min_) / std::log(max_ / min_);
+                return std::log1p(v - min_) / std::log1p(range);
+            case ScaleMode::Sqrt:
+                return std::sqrt(std::max(v - min_, 0.0) / range);
+            case ScaleMode::Quantile: {
+                double position = std::clamp(bin_position(v), 0.0, static_cast<double>(BINS));
+                int bin = std::min(static_cast<int>(position), BINS - 1);
+                return cdf_[bin] + (cdf_[bin + 1] - cdf_[bin]) * (position - bin);
+            }
+            default:
+                return (v - min_) / range;
+        }
+    }
+
+    // Value whose intensity is t: the breakpoint between shades at t
+    double value_at(double t) const {
+        if (t <= 0) return min_;
+        if (t >= 1) return max_;
+        double range = max_ - min_;
+        switch (mode_) {
+            case ScaleMode::Log:
+                if (min_ > 0) return min_ * std::pow(max_ / min_, t);
+                return min_ + std::expm1(t * std::log1p(range));
+            case ScaleMode::Sqrt:
+                return min_ + t * t * range;
+            case ScaleMode::Quantile: {
+                // First bin whose upper edge passes t
+                int bin = static_cast<int>(std::upper_bound(cdf_.begin() + 1, cdf_.end(), t) - cdf_.begin()) - 1;
+                bin = std::clamp(bin, 0, BINS - 1);
+                double width = cdf_[bin + 1] - cdf_[bin];
+                double position = bin + (width > 0 ? (t - cdf_[bin]) / width : 0.0);
+                double span = std::log1p(DYNAMIC_RANGE);
+                return min_ + std::expm1(position / BINS * span) / DYNAMIC_RANGE * range;
+            }
+            default:
+                return min_ + t * range;
+        }
+    }
+};
@@ -0,0 +1,159 @@
+#include "test_framework.hpp"
+#include "../src/accumulator.hpp"
+#include "../src/heatmap_builder.hpp"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Fold values into a fresh state of acc
+template<typename Acc>
+typename Acc::State fold(const Acc& acc, const std::vector<double>& values, size_t begin, size_t end) {
+    auto state = acc.init();
+    for (size_t i = begin; i < end; ++i) {
+        acc.add(state, values[i]);
+    }
+    return state;
+}
+
+// Check that merging two halves finalizes like adding everything to one state
+template<typename Acc>
+bool merge_matches_single_pass(const Acc& acc, const std::vector<double>& values, double tolerance) {
+    auto whole = fold(acc, values, 0, values.size());
+    auto merged = fold(acc, values, 0, values.size() / 3);
+    acc.merge(merged, fold(acc, values, values.size() / 3, values.size()));
+
+    double expected = static_cast<double>(acc.finalize(whole));
+    double actual = static_cast<double>(acc.finalize(merged));
+    if (std::abs(expected - actual) > tolerance * std::max(1.0, std::abs(expected))) {
+        std::cout << "Merged result " << actual << " differs from single pass " << expected << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Test the basic accumulators on a small set
+bool test_basic_accumulators() {
+    std::vector<double> values = {4.0, -2.0, 7.5, 1.0};
+
+    bool test1 = test::assert_equal(CountAccumulator().finalize(fold(CountAccumulator(), values, 0, 4)),
+                                    static_cast<int64_t>(4));
+    bool test2 = test::assert_equal(SumAccumulator().finalize(fold(SumAccumulator(), values, 0, 4)), 10.5);
+    bool test3 = test::assert_equal(AvgAccumulator().finalize(fold(AvgAccumulator(), values, 0, 4)), 2.625);
+    bool test4 = test::assert_equal(MinAccumulator().finalize(fold(MinAccumulator(), values, 0, 4)), -2.0);
+    bool test5 = test::assert_equal(MaxAccumulator().finalize(fold(MaxAccumulator(), values, 0, 4)), 7.5);
+
+    // Empty cells render as 0 whatever the aggregate
+    bool test6 = test::assert_equal(MinAccumulator().finalize(MinAccumulator().init()), 0.0);
+    bool test7 = test::assert_equal(MaxAccumulator().finalize(MaxAccumulator().init()), 0.0);
+    bool test8 = test::assert_equal(AvgAccumulator().finalize(AvgAccumulator().init()), 0.0);
+    bool test9 = test::assert_equal(StddevAccumulator().finalize(StddevAccumulator().init()), 0.0);
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8 && test9;
+}
+
+// Test Welford variance against the two-pass formula on values with a large mean
+bool test_variance() {
+    std::mt19937_64 rng(7);
+    std::normal_distribution<double> dist(1e9, 3.0);
+    std::vector<double> values(10000);
+    for (auto& v : values) v = dist(rng);
+
+    double mean = 0;
+    for (double v : values) mean += v;
+    mean /= values.size();
+    double m2 = 0;
+    for (double v : values) m2 += (v - mean) * (v - mean);
+    double expected = m2 / values.size();
+
+    VarianceAccumulator variance;
+    StddevAccumulator stddev;
+    double actual = variance.finalize(fold(variance, values, 0, values.size()));
+
+    bool test1 = test::assert_true(std::abs(actual - expected) < 1e-6 * expected);
+    bool test2 = test::assert_true(
+        std::abs(stddev.finalize(fold(stddev, values, 0, values.size())) - std::sqrt(expected)) < 1e-6);
+
+    return test1 && test2;
+}
+
+// Test that merging partial states matches a single pass for every accumulator
+bool test_merge_exact() {
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> dist(-50.0, 150.0);
+    std::vector<double> values(5001);
+    for (auto& v : values) v = dist(rng);
+
+    bool result = merge_matches_single_pass(CountAccumulator(), values, 0.0);
+    result = merge_matches_single_pass(SumAccumulator(), values, 1e-12) && result;
+    result = merge_matches_single_pass(AvgAccumulator(), values, 1e-12) && result;
+    result = merge_matches_single_pass(MinAccumulator(), values, 0.0) && result;
+    result = merge_matches_single_pass(MaxAccumulator(), values, 0.0) && result;
+    result = merge_matches_single_pass(VarianceAccumulator(), values, 1e-12) && result;
+    result = merge_matches_single_pass(StddevAccumulator(), values, 1e-12) && result;
+
+    // Merging into or from an empty state is the identity
+    VarianceAccumulator variance;
+    auto empty = variance.init();
+    auto full = fold(variance, values, 0, values.size());
+    variance.merge(empty, full);
+    variance.merge(full, variance.init());
+    result = test::assert_equal(variance.finalize(empty), variance.finalize(full)) && result;
+
+    return result;
+}
+
+// Test that partial binners merge into the same heatmap as one binner
+bool test_binner_merge() {
+    std::mt19937_64 rng(3);
+    std::uniform_real_distribution<double> coord(0.0, 10.0);
+    std::uniform_real_distribution<double> value(0.0, 100.0);
+
+    HeatmapBinner<StddevAccumulator> whole(4, 4, 0.0, 10.0, 0.0, 10.0);
+    HeatmapBinner<StddevAccumulator> left(4, 4, 0.0, 10.0, 0.0, 10.0);
+    HeatmapBinner<StddevAccumulator> right(4, 4, 0.0, 10.0, 0.0, 10.0);
+    for (int i = 0; i < 2000; ++i) {
+        double x = coord(rng), y = coord(rng), v = value(rng);
+        whole.add(x, y, v);
+        (i % 2 ? left : right).add(x, y, v);
+    }
+    left.merge(right);
+
+    auto expected = whole.result();
+    auto actual = left.result();
+    bool result = test::assert_equal(left.points(), whole.points());
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 4; ++x) {
+            if (std::abs(expected[y][x] - actual[y][x]) > 1e-9) {
+                std::cout << "Mismatch at [" << y << "][" << x << "]\n";
+                result = false;
+            }
+        }
+    }
+
+    // The runtime choice maps onto the matching accumulator
+    double max = with_accumulator(AggregateFunc::Max, [](auto acc) {
+        auto state = acc.init();
+        acc.add(state, 3.0);
+        acc.add(state, 9.0);
+        return static_cast<double>(acc.finalize(state));
+    });
+
+    return result && test::assert_equal(max, 9.0);
+}
+
+// Main test function
+int main() {
+    test::TestSuite accumulator_tests("Accumulator Tests");
+
+    // Add test cases
+    accumulator_tests.add_test("Basic Accumulators", test_basic_accumulators);
+    accumulator_tests.add_test("Welford Variance", test_variance);
+    accumulator_tests.add_test("Exact Merge", test_merge_exact);
+    accumulator_tests.add_test("Binner Merge", test_binner_merge);
+
+    // Run tests
+    accumulator_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return accumulator_tests.all_passed() ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#include "test_framework.hpp"
+#include "../src/color_palette.hpp"
+#include <string>
+
+// Test that palettes run between their end colors
+bool test_palettes() {
+    const ColorTable& viridis = color_table(Palette::Viridis, ColorDepth::TrueColor);
+    Rgb first = viridis.rgb(0);
+    Rgb last = viridis.rgb(ColorTable::LEVELS - 1);
+    bool test1 = test::assert_true(first.r == 68 && first.g == 1 && first.b == 84);
+    bool test2 = test::assert_true(last.r == 253 && last.g == 231 && last.b == 37);
+
+    // Gray gets brighter level by level
+    const ColorTable& gray = color_table(Palette::Gray, ColorDepth::TrueColor);
+    bool rising = true;
+    for (int i = 1; i < ColorTable::LEVELS; ++i) rising = rising && gray.rgb(i).r >= gray.rgb(i - 1).r;
+    bool test3 = test::assert_true(rising);
+
+    bool test4 = test::assert_equal(ColorTable::level(0.0), 0);
+    bool test5 = test::assert_equal(ColorTable::level(1.0), ColorTable::LEVELS - 1);
+    bool test6 = test::assert_equal(ColorTable::level(0.5), ColorTable::LEVELS / 2);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test the preformatted escape parameters at both depths
+bool test_escapes() {
+    const ColorTable& truecolor = color_table(Palette::Magma, ColorDepth::TrueColor);
+    bool test1 = test::assert_equal(std::string(truecolor.fg(0)), std::string("38;2;0;0;4"));
+    bool test2 = test::assert_equal(std::string(truecolor.bg(ColorTable::LEVELS - 1)), std::string("48;2;252;253;191"));
+
+    // Near black is the cube's black, pure gray ramps use the gray range
+    const ColorTable& ansi = color_table(Palette::Magma, ColorDepth::Ansi256);
+    bool test3 = test::assert_equal(std::string(ansi.fg(0)), std::string("38;5;16"));
+    const ColorTable& gray = color_table(Palette::Gray, ColorDepth::Ansi256);
+    bool test4 = test::assert_equal(std::string(gray.bg(0)), std::string("48;5;234"));
+
+    // 256 colors give fewer distinct ids than levels; equal ids mean equal escapes
+    int distinct = 1;
+    bool consistent = true;
+    for (int i = 1; i < ColorTable::LEVELS; ++i) {
+        if (ansi.id(i) != ansi.id(i - 1)) distinct++;
+        consistent = consistent && (ansi.id(i) == ansi.id(i - 1)) == (ansi.fg(i) == ansi.fg(i - 1));
+    }
+    bool test5 = test::assert_true(distinct > 8 && distinct < ColorTable::LEVELS / 4);
+    bool test6 = test::assert_true(consistent);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Main test function
+int main() {
+    test::TestSuite palette_tests("Color Palette Tests");
+
+    // Add test cases
+    palette_tests.add_test("Palettes", test_palettes);
+    palette_tests.add_test("Escapes", test_escapes);
+
+    // Run tests
+    palette_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return palette_tests.all_passed() ? 0 : 1;
+}
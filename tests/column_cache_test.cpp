@@ -0,0 +1,185 @@
+#include "test_framework.hpp"
+#include "../src/column_cache.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace tplt;
+namespace fs = std::filesystem;
+
+// Scratch directory, emptied for each test
+static fs::path scratch_dir() {
+    fs::path dir = fs::temp_directory_path() / ("tplt_cache_test_" + std::to_string(getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+static void write_file(const fs::path& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << text;
+}
+
+static Options cache_options(const fs::path& input, const std::string& x, const std::string& y,
+                             const std::string& aggregation = "") {
+    Options options;
+    options.delimiter = ',';
+    options.input_path = input.string();
+    options.cache = true;
+    options.x_field = FieldSpec(x);
+    options.y_field = FieldSpec(y);
+    if (!aggregation.empty()) options.aggregation = AggregationSpec::parse(aggregation);
+    return options;
+}
+
+// Every point of the input (or of the sidecar, when given), as x;y;value lines
+static std::string points_of(const Options& options, const std::optional<std::string>& sidecar = std::nullopt) {
+    Options read = options;
+    if (sidecar) read.input_path = *sidecar;
+    DataReader reader(options.delimiter);
+    std::string out;
+    reader.for_each_point<double>(read, [&](const DataPoint<double>& point) {
+        out += std::to_string(point.x) + ";" + std::to_string(point.y) + ";" +
+               (point.value ? std::to_string(*point.value) : "-") + "\n";
+    });
+    return out;
+}
+
+static size_t sidecars_in(const fs::path& dir) {
+    size_t count = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.path().extension() == ".tcol") count++;
+    }
+    return count;
+}
+
+// Test that a first run creates the sidecar and it reads like the text
+bool test_fill_and_hit() {
+    fs::path dir = scratch_dir();
+    fs::path input = dir / "data.csv";
+    write_file(input, "a,b,c,d\n1,2,3,4\n5,6,x,8\n, 9,10,11\n12,13,14,15\n");
+    Options options = cache_options(input, "a", "d", "sum(b)");
+
+    DataReader reader(',');
+    auto sidecar = cached_columns(reader, options, 2);
+    bool test1 = test::assert_true(sidecar.has_value() && fs::exists(*sidecar));
+    bool test2 = test::assert_equal(fs::path(*sidecar).parent_path(), dir);
+    bool test3 = test::assert_equal(points_of(options, sidecar), points_of(options));
+
+    // Only the selected columns are stored
+    MappedFile mapped(*sidecar);
+    ColumnarView table(mapped.view());
+    bool test4 = test::assert_equal(table.columns().size(), static_cast<size_t>(4));
+    bool test5 = test::assert_true(table.stored(0) && table.stored(1) && !table.stored(2) && table.stored(3));
+    bool test6 = test::assert_equal(table.columns()[2].name, std::string("c"));
+
+    // A second run hits without rewriting
+    auto written = fs::last_write_time(*sidecar);
+    auto again = cached_columns(reader, options, 2);
+    bool test7 = test::assert_equal(*again, *sidecar);
+    bool test8 = test::assert_true(fs::last_write_time(*again) == written);
+
+    fs::remove_all(dir);
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8;
+}
+
+// Test that other columns are added to the sidecar on later runs
+bool test_extend() {
+    fs::path dir = scratch_dir();
+    fs::path input = dir / "data.csv";
+    write_file(input, "1,2,3\n4,5,6\n7,8,9\n");
+
+    DataReader reader(',');
+    Options first = cache_options(input, "f1", "f2");
+    Options second = cache_options(input, "f3", "f1", "avg(f2)");
+    auto sidecar = cached_columns(reader, first, 1);
+    auto extended = cached_columns(reader, second, 1);
+
+    bool test1 = test::assert_equal(*extended, *sidecar);
+    bool test2 = test::assert_equal(points_of(second, extended), points_of(second));
+    bool test3 = test::assert_equal(points_of(first, extended), points_of(first));
+    bool test4 = test::assert_equal(sidecars_in(dir), static_cast<size_t>(1));
+
+    fs::remove_all(dir);
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that a changed file or delimiter gets a fresh sidecar
+bool test_key() {
+    fs::path dir = scratch_dir();
+    fs::path input = dir / "data.csv";
+    write_file(input, "1,2\n3,4\n");
+
+    DataReader reader(',');
+    Options options = cache_options(input, "f1", "f2");
+    auto before = cached_columns(reader, options, 1);
+
+    write_file(input, "1,2\n3,4\n5,6\n");
+    auto after = cached_columns(reader, options, 1);
+    bool test1 = test::assert_true(*before != *after);
+    bool test2 = test::assert_equal(points_of(options, after), points_of(options));
+    bool test3 = test::assert_equal(sidecars_in(dir), static_cast<size_t>(1));
+
+    Options other_delimiter = options;
+    other_delimiter.delimiter = ';';
+    bool test4 = test::assert_true(column_cache_path(other_delimiter) != fs::path(*after));
+
+    // A cache dir keeps sidecars out of the data directory
+    Options elsewhere = options;
+    elsewhere.cache_dir = (dir / "cache").string();
+    auto in_dir = cached_columns(reader, elsewhere, 1);
+    bool test5 = test::assert_equal(fs::path(*in_dir).parent_path(), dir / "cache");
+
+    fs::remove_all(dir);
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that refreshing a file's sidecar leaves the sidecars of files whose
+// names extend its name alone
+bool test_prefix_names() {
+    fs::path dir = scratch_dir();
+    fs::path input = dir / "a.csv";
+    fs::path backup = dir / "a.csv.bak";
+    write_file(input, "1,2\n3,4\n");
+    write_file(backup, "5,6\n7,8\n");
+
+    DataReader reader(',');
+    auto kept = cached_columns(reader, cache_options(backup, "f1", "f2"), 1);
+    cached_columns(reader, cache_options(input, "f1", "f2"), 1);
+    write_file(input, "1,2\n3,4\n9,9\n");
+    auto refreshed = cached_columns(reader, cache_options(input, "f1", "f2"), 1);
+
+    bool test1 = test::assert_true(kept.has_value() && fs::exists(*kept));
+    bool test2 = test::assert_true(refreshed.has_value() && fs::exists(*refreshed));
+    bool test3 = test::assert_equal(sidecars_in(dir), static_cast<size_t>(2));
+
+    // The same holds in a shared cache dir
+    Options shared_backup = cache_options(backup, "f1", "f2");
+    Options shared_input = cache_options(input, "f1", "f2");
+    shared_backup.cache_dir = shared_input.cache_dir = (dir / "cache").string();
+    auto kept_shared = cached_columns(reader, shared_backup, 1);
+    write_file(input, "1,2\n");
+    cached_columns(reader, shared_input, 1);
+    bool test4 = test::assert_true(kept_shared.has_value() && fs::exists(*kept_shared));
+
+    fs::remove_all(dir);
+    return test1 && test2 && test3 && test4;
+}
+
+// Main test function
+int main() {
+    test::TestSuite cache_tests("Column Cache Tests");
+
+    // Add test cases
+    cache_tests.add_test("Fill And Hit", test_fill_and_hit);
+    cache_tests.add_test("Extend", test_extend);
+    cache_tests.add_test("Key", test_key);
+    cache_tests.add_test("Prefix Names", test_prefix_names);
+
+    // Run tests
+    cache_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return cache_tests.all_passed() ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "test_framework.hpp"
+#include "../src/columnar.hpp"
+#include "../src/data_reader.hpp"
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tplt;
+
+// Serialize a table and copy it into 8-byte aligned storage, like a mapping
+static std::vector<uint64_t> write_table(const std::vector<ColumnInfo>& schema,
+                                         const std::vector<std::vector<double>>& columns) {
+    std::ostringstream out;
+    write_columnar(out, schema, columns);
+    std::string bytes = out.str();
+    std::vector<uint64_t> storage((bytes.size() + 7) / 8);
+    std::memcpy(storage.data(), bytes.data(), bytes.size());
+    return storage;
+}
+
+static std::string_view view_of(const std::vector<uint64_t>& storage) {
+    return std::string_view(reinterpret_cast<const char*>(storage.data()), storage.size() * 8);
+}
+
+static Options heatmap_options(const std::string& x, const std::string& y, const std::string& aggregation = "") {
+    Options options;
+    options.x_field = FieldSpec(x);
+    options.y_field = FieldSpec(y);
+    if (!aggregation.empty()) options.aggregation = AggregationSpec::parse(aggregation);
+    return options;
+}
+
+// Test that every column type reads back as the values written
+bool test_round_trip() {
+    std::vector<ColumnInfo> schema = {
+        {"a", ColumnType::F32}, {"b", ColumnType::F64}, {"c", ColumnType::I32}, {"d", ColumnType::I64}};
+    std::vector<std::vector<double>> columns = {
+        {0.5, -1.25, 3.0}, {0.1, 1e300, -2.5}, {-7, 0, 2147483647}, {1e15, -3, 5}};
+    auto storage = write_table(schema, columns);
+
+    bool test1 = test::assert_true(is_columnar(view_of(storage)));
+    ColumnarView table(view_of(storage));
+    bool test2 = test::assert_equal(table.rows(), static_cast<size_t>(3));
+    bool test3 = test::assert_equal(table.columns().size(), static_cast<size_t>(4));
+    bool test4 = test::assert_equal(table.columns()[2].name, std::string("c"));
+
+    bool test5 = true;
+    for (size_t c = 0; c < schema.size(); ++c) {
+        test5 = test::assert_true(table.columns()[c].type == schema[c].type) && test5;
+        double values[3];
+        table.read(c, 0, 3, values);
+        for (size_t r = 0; r < 3; ++r) {
+            test5 = test::assert_equal(values[r], columns[c][r]) && test5;
+        }
+    }
+
+    double tail;
+    table.read(0, 2, 3, &tail);
+    bool test6 = test::assert_equal(tail, 3.0);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test the narrowest exact type chosen for each column
+bool test_type_inference() {
+    double nan = std::numeric_limits<double>::quiet_NaN();
+    bool test1 = test::assert_true(infer_column_type({1, -2, 3}) == ColumnType::I32);
+    bool test2 = test::assert_true(infer_column_type({1, 5e9}) == ColumnType::I64);
+    bool test3 = test::assert_true(infer_column_type({1, 2.5}) == ColumnType::F64);
+    bool test4 = test::assert_true(infer_column_type({1, nan}) == ColumnType::F64);
+    bool test5 = test::assert_true(infer_column_type({1e17}) == ColumnType::F64);
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that points read from a table match the same data read as text
+bool test_reader_matches_text() {
+    std::string text = "x,y,v\n1,2,10\n3,4,20\n5,nope,30\n7,8,abc\n9,10,40\n";
+    Options options = heatmap_options("y", "x", "sum(v)");
+    options.delimiter = ',';
+
+    DataReader text_reader(',');
+    std::vector<DataPoint<double>> expected;
+    text_reader.for_each_point<double>(std::string_view(text), options, [&](const DataPoint<double>& point) {
+        expected.push_back(point);
+    });
+
+    // Convert the way `tplt convert` does: every field, NaN where not a number
+    ColumnarBuilder builder({"x", "y", "v"}, {0, 1, 2});
+    for (std::string row : {"1,2,10", "3,4,20", "5,nope,30", "7,8,abc", "9,10,40"}) {
+        std::vector<std::string_view> fields;
+        text_reader.split_fields(row, fields);
+        builder.add_row(fields);
+    }
+    std::ostringstream out;
+    builder.write(out);
+    std::string bytes = out.str();
+    std::vector<uint64_t> storage((bytes.size() + 7) / 8);
+    std::memcpy(storage.data(), bytes.data(), bytes.size());
+
+    RunStats stats;
+    DataReader reader;
+    reader.set_stats(&stats);
+    std::vector<DataPoint<double>> actual;
+    reader.for_each_point<double>(view_of(storage), options, [&](const DataPoint<double>& point) {
+        actual.push_back(point);
+    });
+
+    bool test1 = test::assert_equal(actual.size(), expected.size());
+    bool test2 = true;
+    for (size_t i = 0; i < std::min(actual.size(), expected.size()); ++i) {
+        test2 = test::assert_equal(actual[i].x, expected[i].x) && test2;
+        test2 = test::assert_equal(actual[i].y, expected[i].y) && test2;
+        test2 = test::assert_equal(*actual[i].value, *expected[i].value) && test2;
+    }
+    bool test3 = test::assert_equal(builder.non_numeric(), static_cast<uint64_t>(2));
+    bool test4 = test::assert_true(builder.schema()[0].type == ColumnType::I32);
+    bool test5 = test::assert_true(builder.schema()[1].type == ColumnType::F64);
+    bool test6 = test::assert_equal(stats.rows_accepted.load(), static_cast<uint64_t>(3));
+    bool test7 = test::assert_equal(stats.rows_bad_number.load(), static_cast<uint64_t>(2));
+    bool test8 = test::assert_true(reader.has_headers());
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8;
+}
+
+// Test field lookup by name and index against the schema
+bool test_field_resolution() {
+    auto storage = write_table({{"lat", ColumnType::F64}, {"lon", ColumnType::F64}},
+                               {{1.0, 2.0}, {3.0, 4.0}});
+    DataReader reader;
+
+    double sum = 0;
+    reader.for_each_point<double>(view_of(storage), heatmap_options("lon", "f1"), [&](const DataPoint<double>& point) {
+        sum += point.x * 10 + point.y;
+    });
+    bool test1 = test::assert_equal(sum, 31.0 + 42.0);
+
+    bool test2 = false;
+    try {
+        reader.for_each_point<double>(view_of(storage), heatmap_options("f1", "alt"), [](const DataPoint<double>&) {});
+    } catch (const std::runtime_error&) {
+        test2 = true;
+    }
+
+    bool test3 = false;
+    try {
+        reader.for_each_point<double>(view_of(storage), heatmap_options("f1", "f3"), [](const DataPoint<double>&) {});
+    } catch (const std::runtime_error&) {
+        test3 = true;
+    }
+
+    return test1 && test2 && test3;
+}
+
+// Test that parallel scans see every row exactly once
+bool test_parallel_scan() {
+    std::vector<double> xs, ys;
+    for (int i = 0; i < 100000; ++i) {
+        xs.push_back(i);
+        ys.push_back(i % 7);
+    }
+    auto storage = write_table({{"", ColumnType::I32}, {"", ColumnType::F32}}, {xs, ys});
+    Options options = heatmap_options("f1", "f2");
+
+    DataReader reader;
+    std::vector<double> sums(4, 0.0);
+    std::vector<size_t> counts(4, 0);
+    std::vector<std::function<void(const DataPoint<double>&)>> visitors;
+    for (size_t i = 0; i < 4; ++i) {
+        visitors.push_back([&sums, &counts, i](const DataPoint<double>& point) {
+            sums[i] += point.x;
+            counts[i]++;
+        });
+    }
+    reader.for_each_point_parallel<double>(view_of(storage), options, visitors, 1);
+
+    double total = sums[0] + sums[1] + sums[2] + sums[3];
+    bool test1 = test::assert_equal(counts[0] + counts[1] + counts[2] + counts[3], static_cast<size_t>(100000));
+    bool test2 = test::assert_equal(total, 99999.0 * 100000 / 2);
+    bool test3 = test::assert_true(counts[3] > 0);
+    bool test4 = test::assert_false(reader.has_headers());
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that the range filters apply to columnar input, skipping whole blocks
+bool test_range_filter() {
+    std::vector<double> xs, ys, vs;
+    for (int i = 0; i < 5000; ++i) {
+        xs.push_back(i);
+        ys.push_back(i % 10);
+        vs.push_back(i % 3 == 0 ? std::numeric_limits<double>::quiet_NaN() : 1.0);
+    }
+    auto storage = write_table({{"x", ColumnType::I32}, {"y", ColumnType::I32}, {"v", ColumnType::F64}},
+                               {xs, ys, vs});
+    Options options = heatmap_options("x", "y", "sum(v)");
+    options.x_range = AxisRange::parse("2000:2999");
+    options.y_range = AxisRange::parse("0:4");
+
+    RunStats stats;
+    DataReader reader;
+    reader.set_stats(&stats);
+    size_t points = 0;
+    double sum = 0;
+    reader.for_each_point<double>(view_of(storage), options, [&](const DataPoint<double>& point) {
+        points++;
+        sum += point.x;
+    });
+
+    // Of x in [2000, 2999] with y < 5, one in three has no value
+    size_t expected = 0;
+    double expected_sum = 0;
+    for (int i = 2000; i < 3000; ++i) {
+        if (i % 10 < 5 && i % 3 != 0) {
+            expected++;
+            expected_sum += i;
+        }
+    }
+    bool test1 = test::assert_equal(points, expected);
+    bool test2 = test::assert_equal(sum, expected_sum);
+    bool test3 = test::assert_equal(stats.rows_out_of_range.load(), static_cast<uint64_t>(4500));
+    bool test4 = test::assert_equal(stats.rows_accepted.load() + stats.rows_bad_number.load(), static_cast<uint64_t>(500));
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that truncated or foreign data is rejected
+bool test_corrupt_input() {
+    auto storage = write_table({{"x", ColumnType::F64}}, {{1, 2, 3, 4}});
+    std::string_view whole = view_of(storage);
+
+    bool test1 = false;
+    try {
+        ColumnarView table(whole.substr(0, whole.size() - 8));
+    } catch (const std::runtime_error&) {
+        test1 = true;
+    }
+
+    bool test2 = test::assert_false(is_columnar("x,y\n1,2\n"));
+    return test1 && test2;
+}
+
+// Main test function
+int main() {
+    test::TestSuite columnar_tests("Columnar Tests");
+
+    // Add test cases
+    columnar_tests.add_test("Round Trip", test_round_trip);
+    columnar_tests.add_test("Type Inference", test_type_inference);
+    columnar_tests.add_test("Reader Matches Text", test_reader_matches_text);
+    columnar_tests.add_test("Field Resolution", test_field_resolution);
+    columnar_tests.add_test("Parallel Scan", test_parallel_scan);
+    columnar_tests.add_test("Range Filter", test_range_filter);
+    columnar_tests.add_test("Corrupt Input", test_corrupt_input);
+
+    // Run tests
+    columnar_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return columnar_tests.all_passed() ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#include "test_framework.hpp"
+#include "../src/compressed_input.hpp"
+#include "../src/data_reader.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <stdexcept>
+
+using namespace tplt;
+
+// Rows "i,i%7" for i in [from, to)
+static std::string rows(int from, int to) {
+    std::string text;
+    for (int i = from; i < to; ++i) text += std::to_string(i) + "," + std::to_string(i % 7) + "\n";
+    return text;
+}
+
+static void write_file(const std::string& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    out << bytes;
+}
+
+// Everything a stream over path yields
+static std::string read_all(const std::string& path, size_t threads = 0) {
+    DecompressedStream in(path, threads);
+    std::ostringstream text;
+    std::string line;
+    while (std::getline(in, line)) text << line << '\n';
+    return text.str();
+}
+
+// Message of the error reading path throws, if any
+static std::string read_error(const std::string& path) {
+    try {
+        read_all(path);
+    } catch (const std::runtime_error& e) {
+        return e.what();
+    }
+    return "";
+}
+
+#ifdef TPLT_HAVE_ZLIB
+// One gzip member holding text
+static std::string gzip(const std::string& text) {
+    z_stream stream{};
+    deflateInit2(&stream, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(text.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+#endif
+
+#ifdef TPLT_HAVE_ZSTD
+// One zstd frame holding text, recording its size or not
+static std::string zstd_frame(const std::string& text, bool sized = true) {
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(context, ZSTD_c_contentSizeFlag, sized ? 1 : 0);
+    std::string out(ZSTD_compressBound(text.size()), '\0');
+    ZSTD_outBuffer output{out.data(), out.size(), 0};
+    ZSTD_inBuffer input{text.data(), text.size(), 0};
+    // Streamed input leaves the size out of the frame
+    ZSTD_EndDirective mode = sized ? ZSTD_e_end : ZSTD_e_continue;
+    ZSTD_compressStream2(context, &output, &input, mode);
+    if (!sized) ZSTD_compressStream2(context, &output, &input, ZSTD_e_end);
+    ZSTD_freeCCtx(context);
+    out.resize(output.pos);
+    return out;
+}
+#endif
+
+// Test that compression is told by magic bytes and that only regular files
+// are checked
+bool test_detection() {
+    bool test1 = test::assert_true(detect_compression(std::string_view("\x1f\x8b\x08\x00", 4)) == Compression::Gzip);
+    bool test2 = test::assert_true(detect_compression(std::string_view("\x28\xb5\x2f\xfd\x00", 5)) == Compression::Zstd);
+    bool test3 = test::assert_true(detect_compression("1,2\n3,4\n") == Compression::None);
+    bool test4 = test::assert_true(detect_compression(std::string_view("\x1f", 1)) == Compression::None);
+
+    std::string path = "compressed_input_test_plain.csv";
+    write_file(path, "1,2\n");
+    bool test5 = test::assert_true(file_compression(path) == Compression::None);
+    std::remove(path.c_str());
+    bool test6 = test::assert_true(file_compression("") == Compression::None);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test that gzip text spanning several ring blocks and members reads back
+// whole, through the stream and through DataReader
+bool test_gzip() {
+    std::string path = "compressed_input_test.csv.gz";
+    // About 11 MB, so the text fills three blocks
+    std::string first = "x,y\n" + rows(0, 700000);
+    std::string second = rows(700000, 1000000);
+#ifdef TPLT_HAVE_ZLIB
+    write_file(path, gzip(first) + gzip(second));
+
+    bool test1 = test::assert_true(file_compression(path) == Compression::Gzip);
+    bool test2 = test::assert_true(read_all(path) == first + second);
+
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.input_path = path;
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    size_t points = 0;
+    double last = 0;
+    reader.for_each_point<double>(options, [&](const DataPoint<double>& point) {
+        points++;
+        last = point.x;
+    });
+    bool test3 = test::assert_true(reader.has_headers());
+    bool test4 = test::assert_equal(points, static_cast<size_t>(1000000));
+    bool test5 = test::assert_equal(last, 999999.0);
+
+    // A truncated file is an error, not a shorter input
+    std::string whole = gzip(first);
+    write_file(path, whole.substr(0, whole.size() / 2));
+    bool test6 = test::assert_true(read_error(path).find("truncated gzip data") != std::string::npos);
+
+    write_file(path, whole.substr(0, 10) + std::string(100, 'x'));
+    bool test7 = test::assert_true(read_error(path).find("corrupt gzip data") != std::string::npos);
+    std::remove(path.c_str());
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+#else
+    write_file(path, "\x1f\x8b\x08\x00");
+    bool test1 = test::assert_true(read_error(path).find("built with zlib") != std::string::npos);
+    std::remove(path.c_str());
+    return test1;
+#endif
+}
+
+// Test that multi-frame zstd files decode frames in parallel yet in order,
+// and that other zstd files stream
+bool test_zstd() {
+    std::string path = "compressed_input_test.csv.zst";
+#ifdef TPLT_HAVE_ZSTD
+    std::string text;
+    std::string frames;
+    for (int i = 0; i < 20; ++i) {
+        std::string part = rows(i * 50000, (i + 1) * 50000);
+        text += part;
+        frames += zstd_frame(part);
+    }
+    write_file(path, frames);
+    bool test1 = test::assert_true(file_compression(path) == Compression::Zstd);
+    bool test2 = test::assert_true(read_all(path, 8) == text);
+    bool test3 = test::assert_true(read_all(path, 1) == text);
+
+    // Frames without sizes are streamed
+    write_file(path, zstd_frame(text.substr(0, text.size() / 2), false) + zstd_frame(text.substr(text.size() / 2), false));
+    bool test4 = test::assert_true(read_all(path, 8) == text);
+
+    std::string whole = zstd_frame(text);
+    write_file(path, whole.substr(0, whole.size() / 2));
+    bool test5 = test::assert_true(read_error(path).find("zstd data") != std::string::npos);
+
+    // Frames larger than the ring's whole budget (two decoders: 4 blocks)
+    // are let in one at a time, when they are next to be read
+    std::string large;
+    std::string large_frames;
+    for (int i = 0; i < 3; ++i) {
+        std::string part = rows(i * 2000000, (i + 1) * 2000000);
+        large += part;
+        large_frames += zstd_frame(part);
+    }
+    write_file(path, large_frames);
+    bool test6 = test::assert_true(large.size() / 3 > DecompressedInput::RING * DecompressedInput::BLOCK_SIZE);
+    bool test7 = test::assert_true(read_all(path, 2) == large);
+    std::remove(path.c_str());
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+#else
+    write_file(path, std::string("\x28\xb5\x2f\xfd", 4));
+    bool test1 = test::assert_true(read_error(path).find("built with libzstd") != std::string::npos);
+    std::remove(path.c_str());
+    return test1;
+#endif
+}
+
+// Test that a reader that stops early doesn't wait for the rest
+bool test_early_stop() {
+    std::string path = "compressed_input_test_stop.csv.gz";
+#ifdef TPLT_HAVE_ZLIB
+    write_file(path, gzip(rows(0, 2000000)));
+    std::string line;
+    {
+        DecompressedStream in(path);
+        std::getline(in, line);
+    }
+    std::remove(path.c_str());
+    return test::assert_equal(line, std::string("0,0"));
+#else
+    return true;
+#endif
+}
+
+// Main test function
+int main() {
+    test::TestSuite compressed_input_tests("Compressed Input Tests");
+
+    // Add test cases
+    compressed_input_tests.add_test("Detection", test_detection);
+    compressed_input_tests.add_test("Gzip", test_gzip);
+    compressed_input_tests.add_test("Zstd", test_zstd);
+    compressed_input_tests.add_test("Early Stop", test_early_stop);
+
+    // Run tests
+    compressed_input_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return compressed_input_tests.all_passed() ? 0 : 1;
+}
@@ -2,6 +2,10 @@
 #include "../src/data_reader.hpp"
 #include "../src/arg_parser.hpp"
 #include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <functional>
+#include <algorithm>
 
 using namespace tplt;
 
@@ -320,6 +324,313 @@ bool test_quote_stripping_function() {
     return test1 && test2 && test3 && test4 && test5 && test6 && test7;
 }
 
+// Test reading from a memory-mapped file instead of stdin
+bool test_read_from_file() {
+    std::string path = "data_reader_test_input.csv";
+    {
+        std::ofstream out(path);
+        out << "# comment\r\nx,y,value\r\n1,2,3\r\n\r\n4, 5 ,\"6\"\n7,8,9";  // No trailing newline
+    }
+    
+    DataReader reader(',');
+    
+    Options options;
+    options.delimiter = ',';
+    options.input_path = path;
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    options.aggregation.function = AggregationSpec::Function::Sum;
+    options.aggregation.field = FieldSpec("value");
+    
+    auto data_points = reader.read_data<double>(options);
+    std::remove(path.c_str());
+    
+    bool test1 = test::assert_true(reader.has_headers());
+    bool test2 = test::assert_equal(reader.get_headers()[2], std::string("value"));
+    bool test3 = test::assert_equal(data_points.size(), static_cast<size_t>(3));
+    bool test4 = test::assert_equal(data_points[0].value.value(), 3.0);
+    bool test5 = test::assert_equal(data_points[1].y, 5.0);
+    bool test6 = test::assert_equal(data_points[1].value.value(), 6.0);
+    bool test7 = test::assert_equal(data_points[2].x, 7.0);
+    bool test8 = test::assert_equal(data_points[2].value.value(), 9.0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8;
+}
+
+// Test line splitting on raw buffers
+bool test_for_each_line() {
+    std::vector<std::string> lines;
+    for_each_line("a\r\nb\n\nc", [&](std::string_view line) {
+        lines.emplace_back(line);
+    });
+    
+    bool test1 = test::assert_equal(lines.size(), static_cast<size_t>(4));
+    bool test2 = test::assert_equal(lines[0], std::string("a"));
+    bool test3 = test::assert_equal(lines[2], std::string(""));
+    bool test4 = test::assert_equal(lines[3], std::string("c"));
+    
+    return test1 && test2 && test3 && test4;
+}
+
+// Test splitting a buffer into line-aligned chunks
+bool test_split_lines_evenly() {
+    std::string_view buffer = "1,1\n2,2\n3,3\n4,4\n5,5";
+    auto chunks = split_lines_evenly(buffer, 3, 1);
+    
+    std::string joined;
+    bool aligned = true;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        joined += chunks[i];
+        if (i + 1 < chunks.size() && chunks[i].back() != '\n') aligned = false;
+    }
+    
+    bool test1 = test::assert_equal(chunks.size(), static_cast<size_t>(3));
+    bool test2 = test::assert_true(aligned);
+    bool test3 = test::assert_equal(joined, std::string(buffer));
+    
+    // Chunks below the minimum size are not split further
+    bool test4 = test::assert_equal(split_lines_evenly(buffer, 3).size(), static_cast<size_t>(1));
+    
+    return test1 && test2 && test3 && test4;
+}
+
+// Test parsing a buffer on several threads with per-thread visitors
+bool test_parallel_parsing() {
+    std::string input = "x,y,value\n";
+    double expected_sum = 0;
+    for (int i = 1; i <= 1000; ++i) {
+        input += std::to_string(i) + "," + std::to_string(i % 7) + "," + std::to_string(i * 2) + "\n";
+        expected_sum += i * 2;
+    }
+    
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    options.aggregation.function = AggregationSpec::Function::Sum;
+    options.aggregation.field = FieldSpec("value");
+    
+    std::vector<double> sums(4, 0.0);
+    std::vector<size_t> counts(4, 0);
+    std::vector<std::function<void(const DataPoint<double>&)>> visitors;
+    for (size_t i = 0; i < 4; ++i) {
+        visitors.push_back([&sums, &counts, i](const DataPoint<double>& point) {
+            sums[i] += point.value.value();
+            counts[i]++;
+        });
+    }
+    reader.for_each_point_parallel<double>(input, options, visitors, 64);
+    
+    double total = sums[0] + sums[1] + sums[2] + sums[3];
+    size_t rows = counts[0] + counts[1] + counts[2] + counts[3];
+    
+    bool test1 = test::assert_true(reader.has_headers());
+    bool test2 = test::assert_equal(rows, static_cast<size_t>(1000));
+    bool test3 = test::assert_equal(total, expected_sum);
+    bool test4 = test::assert_true(counts[3] > 0);  // Every worker got a chunk
+    
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that only the selected columns of wide rows are extracted
+bool test_column_projection() {
+    DataReader reader(',');
+    
+    // Blank fields don't count as columns; short rows are skipped
+    std::string input = "a,b,c,d,e,f\n1,2,3,4,5,6\n7,, 8 ,\"9\",10,11\n12,13\n14,15,16,17,x,y";
+    std::istringstream iss(input);
+    
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("d");
+    options.y_field = FieldSpec("b");
+    options.aggregation.function = AggregationSpec::Function::Sum;
+    options.aggregation.field = FieldSpec("d");  // Same column twice
+    
+    std::vector<DataPoint<double>> points;
+    reader.for_each_point<double>(iss, options, [&](const DataPoint<double>& point) {
+        points.push_back(point);
+    });
+    
+    bool test1 = test::assert_equal(points.size(), static_cast<size_t>(3));
+    bool test2 = test::assert_equal(points[0].x, 4.0);
+    bool test3 = test::assert_equal(points[0].y, 2.0);
+    bool test4 = test::assert_equal(points[0].value.value(), 4.0);
+    bool test5 = test::assert_equal(points[1].x, 10.0);
+    bool test6 = test::assert_equal(points[1].y, 8.0);
+    bool test7 = test::assert_equal(points[2].x, 17.0);  // Fields past the last selected one are ignored
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+}
+
+// Test that unknown field names are reported once, when the header is read
+bool test_unknown_field_name() {
+    DataReader reader(',');
+    std::istringstream iss("x,y\n1,2\n3,4");
+    
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("nope");
+    
+    try {
+        reader.for_each_point<double>(iss, options, [](const DataPoint<double>&) {});
+    } catch (const std::runtime_error& e) {
+        return test::assert_equal(std::string(e.what()), std::string("Field name not found in headers: nope"));
+    }
+    return false;
+}
+
+// Test that bytes and rows by outcome are counted into attached stats
+bool test_row_accounting() {
+    std::string input = "x,y\n1,2\n3\n4,oops\n5,6\n";
+    
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    
+    RunStats stats;
+    reader.set_stats(&stats);
+    size_t points = 0;
+    
+    std::streambuf* old_cerr = std::cerr.rdbuf();
+    std::ostringstream warnings;
+    std::cerr.rdbuf(warnings.rdbuf());
+    reader.for_each_point<double>(input, options, [&](const DataPoint<double>&) { points++; });
+    std::cerr.rdbuf(old_cerr);
+    
+    bool test1 = test::assert_equal(points, static_cast<size_t>(2));
+    bool test2 = test::assert_equal(stats.rows_accepted.load(), static_cast<uint64_t>(2));
+    bool test3 = test::assert_equal(stats.rows_missing_field.load(), static_cast<uint64_t>(1));
+    bool test4 = test::assert_equal(stats.rows_bad_number.load(), static_cast<uint64_t>(1));
+    bool test5 = test::assert_equal(stats.bytes_read.load(), static_cast<uint64_t>(input.size()));
+    
+    // Detached readers record nothing
+    reader.set_stats(nullptr);
+    reader.for_each_point<double>(std::string_view("x,y\n1,2\n"), options, [](const DataPoint<double>&) {});
+    bool test6 = test::assert_equal(stats.rows_accepted.load(), static_cast<uint64_t>(2));
+    
+    // Blank CRLF lines are skipped by the stream and buffer paths alike
+    std::string crlf = "x,y\r\n\r\n1,2\r\n\r\n3,4\r\n";
+    RunStats mapped;
+    reader.set_stats(&mapped);
+    reader.for_each_point<double>(std::string_view(crlf), options, [](const DataPoint<double>&) {});
+    RunStats streamed;
+    reader.set_stats(&streamed);
+    std::istringstream in(crlf);
+    reader.for_each_point<double>(in, options, [](const DataPoint<double>&) {});
+    bool test7 = test::assert_true(streamed.rows_accepted.load() == 2 && mapped.rows_accepted.load() == 2 &&
+                                   streamed.rows_missing_field.load() == 0 && mapped.rows_missing_field.load() == 0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+}
+
+// Test that rows outside --xrange/--yrange are dropped once x or y is parsed,
+// before the value field is converted
+bool test_range_pushdown() {
+    // x, value, y: the value sits between the two filtered fields
+    std::string input = "x,v,y\n1,10,1\n50,oops,1\n2,oops,90\n3,30,2\nbad,40,2\n4\n";
+    
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    options.aggregation = AggregationSpec::parse("sum(v)");
+    options.x_range = AxisRange::parse("0:10");
+    options.y_range = AxisRange::parse("0:10");
+    
+    RunStats stats;
+    reader.set_stats(&stats);
+    std::vector<DataPoint<double>> points;
+    
+    std::streambuf* old_cerr = std::cerr.rdbuf();
+    std::ostringstream warnings;
+    std::cerr.rdbuf(warnings.rdbuf());
+    reader.for_each_point<double>(input, options, [&](const DataPoint<double>& point) { points.push_back(point); });
+    std::cerr.rdbuf(old_cerr);
+    
+    bool test1 = test::assert_equal(points.size(), static_cast<size_t>(2));
+    bool test2 = test::assert_equal(*points[1].value, 30.0);
+    // The bad values of rows outside the ranges are never looked at
+    bool test3 = test::assert_equal(stats.rows_out_of_range.load(), static_cast<uint64_t>(2));
+    bool test4 = test::assert_equal(stats.rows_bad_number.load(), static_cast<uint64_t>(1));
+    bool test5 = test::assert_equal(stats.rows_missing_field.load(), static_cast<uint64_t>(1));
+    bool test6 = test::assert_true(warnings.str().find("oops") == std::string::npos);
+    
+    // Bounds are closed, as for binning
+    options.x_range = AxisRange::parse("1:3");
+    options.y_range.reset();
+    size_t count = 0;
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>&) { count++; });
+    bool test7 = test::assert_equal(count, static_cast<size_t>(2));
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+}
+
+// Test that --sample, --max-rows and --reservoir parse only the rows they
+// keep, from text buffers, streams and parallel chunks alike
+bool test_sampling() {
+    std::string input = "x,y\n";
+    for (int i = 0; i < 20000; ++i) input += std::to_string(i) + "," + std::to_string(i % 7) + "\n";
+    
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    options.sample = 0.1;
+    
+    RunStats stats;
+    reader.set_stats(&stats);
+    size_t kept = 0;
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>&) { kept++; });
+    bool test1 = test::assert_true(kept > 1700 && kept < 2300);
+    bool test2 = test::assert_equal(stats.rows_accepted.load() + stats.rows_sampled_out.load(), static_cast<uint64_t>(20000));
+    bool test3 = test::assert_equal(reader.sample_scale(), 10.0);
+    
+    // The same seed keeps the same rows, read from a stream too
+    std::vector<double> from_buffer;
+    std::vector<double> from_stream;
+    reader.set_stats(nullptr);
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>& p) { from_buffer.push_back(p.x); });
+    std::istringstream in(input);
+    reader.for_each_point<double>(in, options, [&](const DataPoint<double>& p) { from_stream.push_back(p.x); });
+    bool test4 = test::assert_true(from_buffer == from_stream);
+    
+    // Parallel chunks sample independently at the same rate
+    std::vector<size_t> counts(4, 0);
+    std::vector<std::function<void(const DataPoint<double>&)>> visitors;
+    for (size_t i = 0; i < 4; ++i) {
+        visitors.push_back([&counts, i](const DataPoint<double>&) { counts[i]++; });
+    }
+    reader.for_each_point_parallel<double>(input, options, visitors, 64);
+    size_t parallel = counts[0] + counts[1] + counts[2] + counts[3];
+    bool test5 = test::assert_true(parallel > 1700 && parallel < 2300 && counts[3] > 0);
+    
+    // A prefix stops at its last row
+    options.sample = 1.0;
+    options.max_rows = 5;
+    std::vector<double> first;
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>& p) { first.push_back(p.x); });
+    bool test6 = test::assert_true(first == std::vector<double>({0, 1, 2, 3, 4}));
+    bool test7 = test::assert_equal(reader.sample_scale(), 1.0);
+    
+    // A reservoir keeps its size in rows from all over the input
+    options.max_rows = 0;
+    options.reservoir = 1000;
+    std::vector<double> sample;
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>& p) { sample.push_back(p.x); });
+    bool test8 = test::assert_equal(sample.size(), static_cast<size_t>(1000));
+    bool test9 = test::assert_true(*std::max_element(sample.begin(), sample.end()) > 19000);
+    bool test10 = test::assert_equal(reader.sample_scale(), 20.0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8 && test9 && test10;
+}
+
 // Main test function
 int main() {
     test::TestSuite data_reader_tests("DataReader Tests");
@@ -333,6 +644,15 @@ int main() {
     data_reader_tests.add_test("Quoted Numeric Values (Single Quotes)", test_quoted_numeric_values_single);
     data_reader_tests.add_test("Mixed Quoted and Unquoted Values", test_mixed_quoted_unquoted_values);
     data_reader_tests.add_test("Quote Stripping Function", test_quote_stripping_function);
+    data_reader_tests.add_test("Read From File", test_read_from_file);
+    data_reader_tests.add_test("Line Splitting", test_for_each_line);
+    data_reader_tests.add_test("Line-Aligned Chunks", test_split_lines_evenly);
+    data_reader_tests.add_test("Parallel Parsing", test_parallel_parsing);
+    data_reader_tests.add_test("Column Projection", test_column_projection);
+    data_reader_tests.add_test("Unknown Field Name", test_unknown_field_name);
+    data_reader_tests.add_test("Row Accounting", test_row_accounting);
+    data_reader_tests.add_test("Range Pushdown", test_range_pushdown);
+    data_reader_tests.add_test("Sampling", test_sampling);
     
     // Run tests
     data_reader_tests.run();
@@ -0,0 +1,167 @@
+#include "test_framework.hpp"
+#include "../src/grid_file.hpp"
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Points with values in [0, 100) over the unit square
+static std::vector<std::tuple<double, double, double>> sample_points(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<std::tuple<double, double, double>> points;
+    for (size_t i = 0; i < n; ++i) {
+        points.emplace_back(unit(rng), unit(rng), std::floor(unit(rng) * 100));
+    }
+    return points;
+}
+
+template<typename Acc>
+static HeatmapBinner<Acc> bin(const std::vector<std::tuple<double, double, double>>& points,
+                              size_t begin, size_t end, Acc acc) {
+    using Binner = HeatmapBinner<Acc>;
+    Binner binner(8, 4, 0.0, 1.0, 0.0, 1.0, acc);
+    for (size_t i = begin; i < end; ++i) {
+        auto [x, y, v] = points[i];
+        binner.add(x, y, static_cast<typename Binner::Input>(v));
+    }
+    return binner;
+}
+
+template<typename Acc>
+static std::string serialize(const HeatmapBinner<Acc>& binner, AggregateFunc func, double quantile = 0.5) {
+    std::ostringstream out;
+    write_grid(out, binner, func, quantile);
+    return out.str();
+}
+
+// Test that every accumulator's grid survives a round trip, and that merging
+// grids of two halves read back from files equals binning everything at once
+bool test_round_trip_and_merge() {
+    auto points = sample_points(5000, 3);
+    bool result = true;
+
+    for (AggregateFunc func : {AggregateFunc::Count, AggregateFunc::Sum, AggregateFunc::Avg,
+                               AggregateFunc::Min, AggregateFunc::Max, AggregateFunc::Variance,
+                               AggregateFunc::Stddev, AggregateFunc::Quantile, AggregateFunc::Distinct}) {
+        result = with_accumulator(func, [&](auto acc) {
+            using Acc = decltype(acc);
+            auto whole = bin(points, 0, points.size(), acc);
+            auto left = bin(points, 0, 2000, acc);
+            auto right = bin(points, 2000, points.size(), acc);
+
+            std::string whole_bytes = serialize(whole, func, 0.9);
+            auto reread = read_grid<Acc>(whole_bytes, acc);
+            bool same = true;
+            auto expected = whole.result();
+            auto actual = reread.result();
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 8; ++x) {
+                    same = same && actual(x, y) == expected(x, y);
+                }
+            }
+
+            std::string left_bytes = serialize(left, func);
+            std::string right_bytes = serialize(right, func);
+            auto merged = read_grid<Acc>(left_bytes, acc);
+            merged.merge(read_grid<Acc>(right_bytes, acc));
+            merged.merge(read_grid<Acc>(serialize(HeatmapBinner<Acc>(8, 4, 0.0, 1.0, 0.0, 1.0, acc), func), acc));
+            auto combined = merged.result();
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 8; ++x) {
+                    // Float sums may differ in the last bits with the order of addition
+                    same = same && std::abs(static_cast<double>(combined(x, y) - expected(x, y))) <=
+                                   1e-9 * std::max(1.0, std::abs(static_cast<double>(expected(x, y))));
+                }
+            }
+            same = same && merged.points() == whole.points() && reread.points() == whole.points();
+            if (!same) std::cout << "Mismatch for aggregation " << static_cast<int>(func) << "\n";
+            return same;
+        }, 0.9) && result;
+    }
+    return result;
+}
+
+// Test the header fields
+bool test_header() {
+    HeatmapBinner<AvgAccumulator> binner(5, 3, -2.0, 2.0, 10.0, 10.0);
+    binner.add(0.0, 10.0, 4.0);
+    std::string bytes = serialize(binner, AggregateFunc::Avg, 0.25);
+
+    std::string_view view = bytes;
+    GridFileHeader header = read_grid_header(view);
+    bool test1 = test::assert_true(is_grid_file(bytes));
+    bool test2 = test::assert_true(header.func == AggregateFunc::Avg);
+    bool test3 = test::assert_equal(header.quantile, 0.25);
+    bool test4 = test::assert_equal(header.width, 5);
+    bool test5 = test::assert_equal(header.height, 3);
+    bool test6 = test::assert_equal(header.bounds.min_x, -2.0);
+    // An empty y range is widened by the binner, and saved that way
+    bool test7 = test::assert_equal(header.bounds.max_y, 11.0);
+    bool test8 = test::assert_equal(header.points, static_cast<uint64_t>(1));
+    bool test9 = test::assert_equal(view.size(), static_cast<size_t>(15 * sizeof(AvgAccumulator::State)));
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8 && test9;
+}
+
+// Test that damaged files are rejected rather than misread or over-allocated
+bool test_corrupt() {
+    auto points = sample_points(500, 7);
+    auto binner = bin(points, 0, points.size(), QuantileAccumulator{0.5});
+    std::string bytes = serialize(binner, AggregateFunc::Quantile);
+
+    int rejected = 0;
+    for (size_t cut : {size_t{4}, size_t{40}, bytes.size() - 1}) {
+        try {
+            read_grid<QuantileAccumulator>(std::string_view(bytes).substr(0, cut));
+        } catch (const std::runtime_error&) {
+            rejected++;
+        }
+    }
+    try {
+        read_grid<QuantileAccumulator>(bytes + "x");
+    } catch (const std::runtime_error&) {
+        rejected++;
+    }
+    bool test1 = test::assert_equal(rejected, 4);
+
+    // A header claiming far more cells than the file holds is rejected
+    // before the cells are allocated
+    auto oversized = [](std::string file) {
+        size_t dims = 8 + 4 + 4 + 8;    // Magic, version, aggregation, quantile
+        for (size_t i = 0; i < 2; i++) {
+            std::string side;
+            put_bytes(side, uint32_t{1} << 16);
+            file.replace(dims + 4 * i, 4, side);
+        }
+        try {
+            read_grid<CountAccumulator>(file);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what()) == "Grid file size doesn't match its header";
+        }
+        return false;
+    };
+    HeatmapBinner<CountAccumulator> counts(4, 4, 0.0, 1.0, 0.0, 1.0);
+    counts.add(0.5, 0.5);
+    bool test2 = test::assert_true(oversized(serialize(counts, AggregateFunc::Count)));
+
+    return test1 && test2;
+}
+
+// Main test function
+int main() {
+    test::TestSuite grid_file_tests("Grid File Tests");
+
+    // Add test cases
+    grid_file_tests.add_test("Round Trip And Merge", test_round_trip_and_merge);
+    grid_file_tests.add_test("Header", test_header);
+    grid_file_tests.add_test("Corrupt Input", test_corrupt);
+
+    // Run tests
+    grid_file_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return grid_file_tests.all_passed() ? 0 : 1;
+}
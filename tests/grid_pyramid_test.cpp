@@ -0,0 +1,161 @@
+#include "test_framework.hpp"
+#include "../src/grid_pyramid.hpp"
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+
+// Base grid of n points with values in [0, 100) over [0, 10] x [0, 5]
+template<typename Acc>
+static HeatmapBinner<Acc> base_grid(int width, int height, size_t n, Acc acc = Acc{}) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    HeatmapBinner<Acc> binner(width, height, 0.0, 10.0, 0.0, 5.0, acc);
+    for (size_t i = 0; i < n; ++i) {
+        double x = 10 * unit(rng) * unit(rng);
+        double y = 5 * unit(rng);
+        binner.add(x, y, std::floor(100 * unit(rng)));
+    }
+    return binner;
+}
+
+template<typename T>
+static bool same_cells(const Grid<T>& a, const Grid<T>& b) {
+    if (!a.same_shape(b)) return false;
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            if (a(x, y) != b(x, y)) return false;
+        }
+    }
+    return true;
+}
+
+// Test that levels halve down to one cell and keep every point
+bool test_levels() {
+    auto base = base_grid<AvgAccumulator>(64, 24, 20000);
+    auto whole = base_grid<AvgAccumulator>(1, 1, 20000);
+    GridPyramid<AvgAccumulator> pyramid(base);
+
+    bool test1 = test::assert_equal(pyramid.levels(), static_cast<size_t>(7));
+    bool test2 = test::assert_equal(pyramid.level(1).width(), 32);
+    bool test3 = test::assert_equal(pyramid.level(1).height(), 12);
+    bool test4 = test::assert_equal(pyramid.level(4).height(), 2);
+    bool test5 = test::assert_equal(pyramid.level(6).width(), 1);
+
+    // The top cell is the average over all points, exactly
+    const auto& top = pyramid.level(pyramid.levels() - 1);
+    bool test6 = test::assert_equal(top.result()(0, 0), whole.result()(0, 0));
+    bool test7 = test::assert_equal(top.points(), static_cast<size_t>(20000));
+
+    // A level bins like a grid of its own size: cell (i, j) holds base cells [2i, 2i + 1]
+    bool same = true;
+    auto counts = base_grid<CountAccumulator>(64, 24, 20000);
+    GridPyramid<CountAccumulator> count_pyramid(counts);
+    for (int y = 0; y < 12; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            auto expected = counts.result()(2 * x, 2 * y) + counts.result()(2 * x + 1, 2 * y) +
+                            counts.result()(2 * x, 2 * y + 1) + counts.result()(2 * x + 1, 2 * y + 1);
+            same = same && count_pyramid.level(1).result()(x, y) == expected;
+        }
+    }
+    bool test8 = test::assert_true(same);
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8;
+}
+
+// Test views of the whole bounds and of a sub-rectangle
+bool test_views() {
+    auto base = base_grid<CountAccumulator>(256, 128, 50000);
+    GridPyramid<CountAccumulator> pyramid(base);
+    PointBounds all = base.bounds();
+
+    // At the base size the view is the base
+    auto full = pyramid.view(256, 128, all);
+    bool test1 = test::assert_equal(pyramid.level_for(256, 128, all), static_cast<size_t>(0));
+    bool test2 = test::assert_true(same_cells(full.result(), base.result()));
+
+    // A small view comes from a coarser level and still holds every point
+    auto small = pyramid.view(16, 8, all);
+    bool test3 = test::assert_equal(pyramid.level_for(16, 8, all), static_cast<size_t>(1));
+    size_t total = 0;
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 16; ++x) total += small.result()(x, y);
+    }
+    bool test4 = test::assert_equal(total, static_cast<size_t>(50000));
+
+    // A zoomed view matches binning just the points inside it, up to the base
+    // cells straddling its edges
+    PointBounds region;
+    region.add(2.0, 1.0);
+    region.add(4.0, 3.0);
+    auto zoomed = pyramid.view(8, 4, region);
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    HeatmapBinner<CountAccumulator> exact(8, 4, 2.0, 4.0, 1.0, 3.0);
+    for (size_t i = 0; i < 50000; ++i) {
+        double x = 10 * unit(rng) * unit(rng);
+        double y = 5 * unit(rng);
+        unit(rng);
+        if (exact.contains(x, y)) exact.add(x, y);
+    }
+    bool close = true;
+    for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 7; ++x) {
+            double want = static_cast<double>(exact.result()(x, y));
+            close = close && std::abs(static_cast<double>(zoomed.result()(x, y)) - want) <= 0.25 * want;
+        }
+    }
+    bool test5 = test::assert_true(close);
+
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that a pyramid survives a round trip and damaged files are rejected
+bool test_round_trip() {
+    auto base = base_grid<QuantileAccumulator>(20, 10, 5000, QuantileAccumulator{0.9});
+    GridPyramid<QuantileAccumulator> pyramid(base);
+    std::ostringstream out;
+    pyramid.write(out, AggregateFunc::Quantile, 0.9);
+    std::string bytes = out.str();
+
+    bool test1 = test::assert_true(is_pyramid_file(bytes));
+    GridFileHeader header = read_pyramid_header(bytes);
+    bool test2 = test::assert_true(header.func == AggregateFunc::Quantile);
+    bool test3 = test::assert_equal(header.quantile, 0.9);
+    bool test4 = test::assert_equal(header.width, 20);
+
+    auto reread = GridPyramid<QuantileAccumulator>::read(bytes, QuantileAccumulator{0.9});
+    bool same = reread.levels() == pyramid.levels();
+    for (size_t k = 0; same && k < pyramid.levels(); ++k) {
+        same = same_cells(reread.level(k).result(), pyramid.level(k).result());
+    }
+    bool test5 = test::assert_true(same);
+
+    int rejected = 0;
+    for (size_t cut : {size_t{12}, bytes.size() / 2, bytes.size() - 1}) {
+        try {
+            GridPyramid<QuantileAccumulator>::read(std::string_view(bytes).substr(0, cut));
+        } catch (const std::runtime_error&) {
+            rejected++;
+        }
+    }
+    bool test6 = test::assert_equal(rejected, 3);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Main test function
+int main() {
+    test::TestSuite pyramid_tests("Grid Pyramid Tests");
+
+    // Add test cases
+    pyramid_tests.add_test("Levels", test_levels);
+    pyramid_tests.add_test("Views", test_views);
+    pyramid_tests.add_test("Round Trip", test_round_trip);
+
+    // Run tests
+    pyramid_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return pyramid_tests.all_passed() ? 0 : 1;
+}
@@ -3,6 +3,9 @@
 #include <tuple>
 #include <vector>
 #include <iostream>
+#include <cstdint>
+#include <stdexcept>
+#include <cmath>
 
 // Test the map_range function
 bool test_map_range() {
@@ -150,6 +153,250 @@ bool test_build_heatmap_3d_avg() {
     return result;
 }
 
+// Test streaming binner with fixed bounds
+bool test_binner_fixed_bounds() {
+    // Bounds [0, 2] on both axes over a 3x3 grid
+    HeatmapBinner<AvgAccumulator> binner(3, 3, 0.0, 2.0, 0.0, 2.0);
+    
+    binner.add(0.0, 0.0, 10.0);
+    binner.add(0.2, 0.1, 20.0);
+    binner.add(1.0, 2.0, 30.0);
+    
+    bool test1 = test::assert_true(binner.contains(2.0, 0.0));
+    bool test2 = test::assert_false(binner.contains(2.5, 0.0));
+    bool test3 = test::assert_equal(binner.points(), static_cast<size_t>(3));
+    
+    auto heatmap = binner.result();
+    bool test4 = test::assert_equal(heatmap[0][0], 15.0);
+    bool test5 = test::assert_equal(heatmap[2][1], 30.0);
+    bool test6 = test::assert_equal(heatmap[1][1], 0.0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test bounds tracking
+bool test_point_bounds() {
+    PointBounds bounds;
+    bool test1 = test::assert_true(bounds.empty());
+    
+    bounds.add(1.0, -2.0);
+    bounds.add(-3.0, 4.0);
+    
+    bool test2 = test::assert_false(bounds.empty());
+    bool test3 = test::assert_equal(bounds.min_x, -3.0);
+    bool test4 = test::assert_equal(bounds.max_x, 1.0);
+    bool test5 = test::assert_equal(bounds.min_y, -2.0);
+    bool test6 = test::assert_equal(bounds.max_y, 4.0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test that the adaptive binner is exact while the input fits the warm-up buffer
+bool test_adaptive_binner_warmup() {
+    std::vector<std::tuple<double, double, double>> points = {
+        {0.0, 0.0, 10.0}, {0.5, 0.5, 20.0}, {1.0, 1.0, 30.0},
+        {0.0, 0.0, 40.0}
+    };
+    
+    AdaptiveHeatmapBinner<AvgAccumulator> binner(3, 3);
+    for (const auto& [x, y, v] : points) {
+        binner.add(x, y, v);
+    }
+    
+    auto adaptive = binner.result();
+    auto exact = build_heatmap_data(points, AggregateFunc::Avg, 3, 3);
+    
+    bool result = true;
+    for (size_t y = 0; y < 3; y++) {
+        for (size_t x = 0; x < 3; x++) {
+            if (!test::assert_equal(adaptive[y][x], exact[y][x])) {
+                std::cout << "Mismatch at [" << y << "][" << x << "]: "
+                          << "Expected " << exact[y][x] << ", got " << adaptive[y][x] << "\n";
+                result = false;
+            }
+        }
+    }
+    
+    return result && test::assert_equal(binner.points(), static_cast<size_t>(4));
+}
+
+// Test that the adaptive grid grows to take in points outside its range
+bool test_adaptive_binner_growth() {
+    // Tiny warm-up so the grid starts over [0, 1] and has to grow
+    AdaptiveHeatmapBinner<CountAccumulator> binner(3, 3, 8, 2);
+    binner.add(0.0, 0.0);
+    binner.add(1.0, 1.0);
+    binner.add(100.0, 100.0);
+    binner.add(-100.0, 50.0);
+    
+    auto heatmap = binner.result().convert<int>();
+    
+    int total = heatmap.reduce(0, [](int acc, int v) { return acc + v; });
+    
+    bool test1 = test::assert_equal(total, 4);
+    bool test2 = test::assert_equal(heatmap[0][1], 2);    // (0,0) and (1,1)
+    bool test3 = test::assert_equal(heatmap[2][2], 1);    // (100,100)
+    bool test4 = test::assert_equal(heatmap[1][0], 1);    // (-100,50)
+    
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that the adaptive grid matches exact binning once it has grown past
+// the warm-up range: every cell of a 20x10 count heatmap over 100k Gaussian
+// points must lie within 2% of the largest exact cell
+bool test_adaptive_binner_accuracy() {
+    // Box-Muller over a fixed LCG, so the points are the same everywhere
+    uint64_t state = 42;
+    auto uniform = [&state]() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (static_cast<double>(state >> 11) + 0.5) / 9007199254740992.0;
+    };
+    std::vector<std::tuple<double, double>> points;
+    for (int i = 0; i < 100000; i++) {
+        double r = std::sqrt(-2.0 * std::log(uniform()));
+        double a = 2.0 * M_PI * uniform();
+        points.emplace_back(r * std::cos(a), r * std::sin(a));
+    }
+    
+    AdaptiveHeatmapBinner<CountAccumulator> binner(20, 10, 16, 1024);
+    for (const auto& [x, y] : points) {
+        binner.add(x, y);
+    }
+    
+    auto adaptive = binner.result();
+    auto exact = build_heatmap_data<double, double, int64_t>(points, 20, 10);
+    
+    int64_t peak = exact.reduce(int64_t{0}, [](int64_t acc, int64_t v) { return std::max(acc, v); });
+    int64_t worst = 0;
+    int64_t total = 0;
+    for (int y = 0; y < 10; y++) {
+        for (int x = 0; x < 20; x++) {
+            worst = std::max(worst, std::abs(adaptive(x, y) - exact(x, y)));
+            total += adaptive(x, y);
+        }
+    }
+    if (worst * 50 > peak) {
+        std::cout << "Largest cell error " << worst << " exceeds 2% of " << peak << "\n";
+    }
+    
+    bool test1 = test::assert_true(worst * 50 <= peak);
+    bool test2 = test::assert_equal(total, static_cast<int64_t>(points.size()));
+    
+    return test1 && test2;
+}
+
+// Test grid layout and cell access
+bool test_grid_layout() {
+    Grid<int> grid(5, 3, 7);
+    grid(4, 2) = 1;
+    grid[1][3] = 2;
+    
+    bool test1 = test::assert_equal(grid.width(), 5);
+    bool test2 = test::assert_equal(grid.height(), 3);
+    bool test3 = test::assert_true(grid.stride() >= 5);
+    bool test4 = test::assert_equal(reinterpret_cast<uintptr_t>(grid.row(1)) % 64, static_cast<uintptr_t>(0));
+    bool test5 = test::assert_equal(grid[2][4], 1);
+    bool test6 = test::assert_equal(grid(3, 1), 2);
+    bool test7 = test::assert_equal(grid(0, 0), 7);
+    
+    // Negative dimensions throw before any allocation is attempted
+    bool threw = false;
+    try {
+        Grid<int> bad(-1, 3);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test::assert_true(threw);
+}
+
+// Test whole-grid merge and reduce
+bool test_grid_merge_reduce() {
+    Grid<double> a(3, 2, 1.0);
+    Grid<double> b(3, 2, 2.0);
+    b(1, 1) = 10.0;
+    
+    a += b;
+    double sum = a.reduce(0.0, [](double acc, double v) { return acc + v; });
+    auto [lo, hi] = a.min_max();
+    
+    a.merge(b, [](double x, double y) { return std::max(x, y); });
+    
+    bool test1 = test::assert_equal(sum, 26.0);
+    bool test2 = test::assert_equal(lo, 3.0);
+    bool test3 = test::assert_equal(hi, 11.0);
+    bool test4 = test::assert_equal(a(1, 1), 11.0);
+    bool test5 = test::assert_equal(a(0, 0), 3.0);
+    
+    bool threw = false;
+    try {
+        a += Grid<double>(2, 2);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    
+    return test1 && test2 && test3 && test4 && test5 && test::assert_true(threw);
+}
+
+// Test that the sliding window evicts whole slices and keeps Avg exact
+bool test_windowed_binner() {
+    // Window of 10 time units in 5 slices of 2 over a 2x1 grid
+    WindowedHeatmapBinner<AvgAccumulator> binner(2, 1, 0.0, 1.0, 0.0, 1.0, 10.0, 5);
+    
+    binner.add_at(0.0, 0.0, 0.0, 100.0);   // slice 0
+    binner.add_at(3.0, 0.0, 0.0, 10.0);    // slice 1
+    binner.add_at(9.0, 0.0, 0.0, 20.0);    // slice 4
+    binner.add_at(9.5, 1.0, 0.0, 5.0);     // slice 4
+    
+    bool test1 = test::assert_equal(binner.points(), static_cast<size_t>(4));
+    bool test2 = test::assert_equal(binner.result()[0][0], 130.0 / 3);
+    
+    // Moving into slice 5 evicts slice 0; late points for slice 0 are dropped
+    binner.add_at(10.0, 1.0, 0.0, 7.0);
+    binner.add_at(1.0, 0.0, 0.0, 1000.0);
+    auto heatmap = binner.result();
+    bool test3 = test::assert_equal(binner.points(), static_cast<size_t>(4));
+    bool test4 = test::assert_equal(heatmap[0][0], 15.0);
+    bool test5 = test::assert_equal(heatmap[0][1], 6.0);
+    
+    // A jump past the whole window leaves only the new point
+    binner.add_at(100.0, 1.0, 0.0, 1.0);
+    bool test6 = test::assert_equal(binner.points(), static_cast<size_t>(1));
+    bool test7 = test::assert_equal(binner.result()[0][0], 0.0);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+}
+
+// Test that sampled counts and sums scale up and that the relative error
+// of a count falls with the rows sampled into its cell
+bool test_sample_scaling() {
+    Grid<int64_t> counts(3, 1);
+    counts(0, 0) = 0;
+    counts(1, 0) = 3;
+    counts(2, 0) = 100;
+    
+    Grid<double> error = sampling_error(counts, 4.0);
+    bool test1 = test::assert_equal(error(0, 0), 0.0);
+    bool test2 = test::assert_true(std::abs(error(1, 0) - 50.0) < 1e-9);
+    bool test3 = test::assert_true(std::abs(error(2, 0) - 100.0 * std::sqrt(0.0075)) < 1e-9);
+    
+    // Nothing sampled out, nothing to estimate
+    Grid<double> exact = sampling_error(counts, 1.0);
+    bool test4 = test::assert_equal(exact(2, 0), 0.0);
+    
+    scale_to_input(counts, 2.5);
+    bool test5 = test::assert_true(counts(1, 0) == 8 && counts(2, 0) == 250);
+    
+    Grid<double> sums(1, 1, 1.5);
+    scale_to_input(sums, 3.0);
+    bool test6 = test::assert_equal(sums(0, 0), 4.5);
+    
+    bool test7 = test::assert_true(scales_with_rows<CountAccumulator> && scales_with_rows<SumAccumulator> &&
+                                   !scales_with_rows<AvgAccumulator> && !scales_with_rows<DistinctAccumulator>);
+    
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7;
+}
+
 // Main test function
 int main() {
     test::TestSuite heatmap_builder_tests("HeatmapBuilder Tests");
@@ -160,6 +407,15 @@ int main() {
     heatmap_builder_tests.add_test("build_heatmap_3d_count", test_build_heatmap_3d_count);
     heatmap_builder_tests.add_test("build_heatmap_3d_sum", test_build_heatmap_3d_sum);
     heatmap_builder_tests.add_test("build_heatmap_3d_avg", test_build_heatmap_3d_avg);
+    heatmap_builder_tests.add_test("binner_fixed_bounds", test_binner_fixed_bounds);
+    heatmap_builder_tests.add_test("point_bounds", test_point_bounds);
+    heatmap_builder_tests.add_test("adaptive_binner_warmup", test_adaptive_binner_warmup);
+    heatmap_builder_tests.add_test("adaptive_binner_growth", test_adaptive_binner_growth);
+    heatmap_builder_tests.add_test("adaptive_binner_accuracy", test_adaptive_binner_accuracy);
+    heatmap_builder_tests.add_test("grid_layout", test_grid_layout);
+    heatmap_builder_tests.add_test("grid_merge_reduce", test_grid_merge_reduce);
+    heatmap_builder_tests.add_test("windowed_binner", test_windowed_binner);
+    heatmap_builder_tests.add_test("sample_scaling", test_sample_scaling);
     
     // Run tests
     heatmap_builder_tests.run();
@@ -0,0 +1,232 @@
+#include "test_framework.hpp"
+#include "../src/heatmap_renderer.hpp"
+#include <sstream>
+#include <map>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// Grid from rows of values
+static Grid<int> grid_of(std::initializer_list<std::initializer_list<int>> rows) {
+    int height = static_cast<int>(rows.size());
+    int width = static_cast<int>(rows.begin()->size());
+    Grid<int> grid(width, height);
+    int y = 0;
+    for (const auto& row : rows) {
+        int x = 0;
+        for (int v : row) grid(x++, y) = v;
+        y++;
+    }
+    return grid;
+}
+
+// True if every cell of a block-mode frame with a legend is drawn with the
+// shade whose legend entry, "[a; b)" or the maximum alone, holds its value
+static bool cells_match_legend(const Grid<int>& grid, const std::string& frame) {
+    size_t split = frame.find("\n\nLegend:\n");
+    if (split == std::string::npos) return false;
+
+    // A glyph is a space or a 3-byte block character
+    auto glyph_at = [](const std::string& text, size_t pos) {
+        return text.substr(pos, text[pos] == ' ' ? 1 : 3);
+    };
+
+    std::map<std::string, std::pair<double, double>> ranges;
+    std::istringstream legend(frame.substr(split + 10));
+    std::string line;
+    while (std::getline(legend, line)) {
+        std::string glyph = glyph_at(line, 0);
+        std::string rest = line.substr(glyph.size() + 1);
+        if (rest[0] == '[') {
+            size_t sep = rest.find(';');
+            ranges[glyph] = {std::stod(rest.substr(1, sep - 1)), std::stod(rest.substr(sep + 2))};
+        } else {
+            double max = std::stod(rest);
+            ranges[glyph] = {max, std::nextafter(max, max + 1)};
+        }
+    }
+
+    std::istringstream map(frame.substr(0, split));
+    for (int y = 0; y < grid.height(); ++y) {
+        if (!std::getline(map, line)) return false;
+        size_t pos = 0;
+        for (int x = 0; x < grid.width(); ++x) {
+            std::string glyph = glyph_at(line, pos);
+            pos += glyph.size();
+            auto range = ranges.find(glyph);
+            if (range == ranges.end() || grid(x, y) < range->second.first || grid(x, y) >= range->second.second) {
+                std::cout << "Cell " << grid(x, y) << " drawn as '" << glyph << "' is outside its legend range\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Test that block mode shades each cell by the quarter of the range it falls
+// in, with the full block for the maximum only, as the legend says
+bool test_block() {
+    Grid<int> grid = grid_of({{0, 10, 30}, {50, 70, 100}});
+    std::string frame = render_frame(grid, true);
+
+    bool test1 = test::assert_equal(frame.substr(0, frame.find("\n\n")), std::string("  ░\n▒▒█"));
+    bool test2 = test::assert_true(frame.find("▒ [50; 75)\n▓ [75; 100)\n█ 100\n") != std::string::npos);
+    bool test3 = test::assert_true(cells_match_legend(grid, frame));
+
+    // The stream overload writes the same frame
+    std::ostringstream out;
+    render_heatmap(grid, true, out);
+    bool test4 = test::assert_equal(out.str(), frame);
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that half blocks pair cells vertically, padding an odd last row
+bool test_half_block() {
+    Grid<int> grid = grid_of({{9, 0, 9}, {0, 0, 9}, {9, 0, 0}});
+    std::string frame = render_frame(grid, false, GlyphMode::HalfBlock);
+    return test::assert_equal(frame, std::string("▀ █\n▀  \n"));
+}
+
+// Test braille dot placement and ordered dithering of mid values
+bool test_braille() {
+    Grid<int> full = grid_of({{0, 8}, {8, 8}, {8, 8}, {8, 8}, {8, 0}});
+    std::string frame = render_frame(full, false, GlyphMode::Braille);
+    // All dots but the top left, then the top left dot only
+    bool test1 = test::assert_equal(frame, std::string("⣾\n⠁\n"));
+
+    // A uniform half-intensity area lights half of its dots
+    Grid<int> half(8, 8, 50);
+    half(0, 0) = 0;
+    half(7, 7) = 100;
+    std::string dithered = render_frame(half, false, GlyphMode::Braille);
+    int dots = 0;
+    for (size_t i = 0; i + 2 < dithered.size(); ++i) {
+        if (static_cast<unsigned char>(dithered[i]) == 0xE2) {
+            unsigned bits = (static_cast<unsigned char>(dithered[i + 1]) & 0x03) << 6 |
+                            (static_cast<unsigned char>(dithered[i + 2]) & 0x3F);
+            for (; bits; bits &= bits - 1) dots++;
+        }
+    }
+    bool test2 = test::assert_true(dots >= 28 && dots <= 36);
+
+    std::string legend = render_frame(half, true, GlyphMode::Braille);
+    bool test3 = test::assert_true(legend.find("none at 0 to all at 100") != std::string::npos);
+
+    return test1 && test2 && test3;
+}
+
+// Test that a log scale keeps cells next to a hot one visible and that the
+// legend shows the smallest value of each shade
+bool test_log_scale() {
+    Grid<int> grid = grid_of({{0, 1, 10, 100, 1000}});
+    std::string linear = render_frame(grid, false);
+    std::string log = render_frame(grid, true, GlyphMode::Block, nullptr, ScaleMode::Log);
+
+    bool test1 = test::assert_equal(linear, std::string("    █\n"));
+    bool test2 = test::assert_equal(log.substr(0, log.find('\n')), std::string("  ░▒█"));
+    bool test3 = test::assert_true(log.find("  [0; 5)\n░ [5; 31)\n▒ [31; 177)\n▓ [177; 1000)\n█ 1000\n") != std::string::npos);
+    bool test4 = test::assert_true(cells_match_legend(grid, log));
+
+    // Sub-cell legends add the quarter marks
+    std::string dots = render_frame(grid, true, GlyphMode::Braille, nullptr, ScaleMode::Log);
+    bool test5 = test::assert_true(dots.find("; a quarter at 5, half at 31, three quarters at 177\n") != std::string::npos);
+
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test sum, max and mean pooling, uneven blocks and upsampling
+bool test_pooling() {
+    Grid<int> grid = grid_of({{1, 2, 3, 4, 5, 6}, {1, 1, 1, 1, 1, 9}});
+
+    Grid<int> sum = pool_grid<int>(grid, 2, 1, PoolMode::Sum);
+    bool test1 = test::assert_true(sum(0, 0) == 9 && sum(1, 0) == 26);
+    Grid<int> peak = pool_grid<int>(grid, 3, 1, PoolMode::Max);
+    bool test2 = test::assert_true(peak(0, 0) == 2 && peak(1, 0) == 4 && peak(2, 0) == 9);
+    Grid<double> mean = pool_grid<double>(grid, 2, 2, PoolMode::Mean);
+    bool test3 = test::assert_true(mean(0, 0) == 2.0 && mean(1, 1) == 11.0 / 3);
+
+    // Uneven: 6 columns into 4 takes blocks of 1, 2, 1 and 2
+    Grid<int> uneven = pool_grid<int>(grid, 4, 1, PoolMode::Sum);
+    bool test4 = test::assert_true(uneven(0, 0) == 2 && uneven(1, 0) == 7 && uneven(2, 0) == 5 && uneven(3, 0) == 21);
+
+    // A display larger than the grid repeats its cells
+    Grid<int> large = pool_grid<int>(grid, 12, 4, PoolMode::Max);
+    bool test5 = test::assert_true(large(0, 0) == 1 && large(11, 3) == 9 && large(10, 1) == 6);
+
+    // Sum pooling keeps the total
+    Grid<int> whole = pool_grid<int>(grid, 1, 1, PoolMode::Sum);
+    bool test6 = test::assert_equal(whole(0, 0), 35);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Number of escape sequences in a frame
+static size_t escapes(const std::string& frame) {
+    size_t count = 0;
+    for (size_t at = frame.find('\033'); at != std::string::npos; at = frame.find('\033', at + 1)) count++;
+    return count;
+}
+
+// Test that colored blocks emit an escape per run of equal colors, not per cell
+bool test_color_runs() {
+    const ColorTable& colors = color_table(Palette::Viridis, ColorDepth::TrueColor);
+    Grid<int> grid = grid_of({{0, 0, 0, 100, 100}, {0, 0, 0, 0, 0}});
+    std::string frame = render_frame(grid, false, GlyphMode::Block, &colors);
+
+    std::string dark = "\033[" + std::string(colors.bg(0)) + "m";
+    std::string bright = "\033[" + std::string(colors.bg(ColorTable::LEVELS - 1)) + "m";
+    bool test1 = test::assert_equal(frame, dark + "   " + bright + "  \033[0m\n" + dark + "     \033[0m\n");
+    bool test2 = test::assert_equal(escapes(frame), static_cast<size_t>(5));
+
+    // Levels that map to one xterm color share a run at 256 colors
+    const ColorTable& ansi = color_table(Palette::Viridis, ColorDepth::Ansi256);
+    Grid<int> ramp(256, 1);
+    for (int x = 0; x < 256; ++x) ramp(x, 0) = x;
+    std::string coarse = render_frame(ramp, false, GlyphMode::Block, &ansi);
+    std::string fine = render_frame(ramp, false, GlyphMode::Block, &colors);
+    bool test3 = test::assert_true(escapes(coarse) < escapes(fine) / 4);
+    bool test4 = test::assert_true(coarse.find("\033[48;5;") != std::string::npos);
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that colored half blocks put the upper cell in the foreground and the
+// lower one in the background, with spaces where both match
+bool test_color_half_block() {
+    const ColorTable& colors = color_table(Palette::Magma, ColorDepth::Ansi256);
+    Grid<int> grid = grid_of({{100, 0}, {0, 0}, {100, 100}});
+    std::string frame = render_frame(grid, false, GlyphMode::HalfBlock, &colors);
+
+    std::string top = std::string(colors.fg(ColorTable::LEVELS - 1));
+    std::string low = std::string(colors.bg(0));
+    std::string expected = "\033[" + top + ";" + low + "m▀ \033[0m\n" +
+                           "\033[" + top + "m▀▀\033[0m\n";
+    bool test1 = test::assert_equal(frame, expected);
+
+    std::string legend = render_frame(grid, true, GlyphMode::HalfBlock, &colors);
+    bool test2 = test::assert_true(legend.find("\nLegend:\n0 \033[") != std::string::npos);
+    bool test3 = test::assert_true(legend.find("\033[49m 100\n") != std::string::npos);
+
+    return test1 && test2 && test3;
+}
+
+// Main test function
+int main() {
+    test::TestSuite renderer_tests("Heatmap Renderer Tests");
+
+    // Add test cases
+    renderer_tests.add_test("Block", test_block);
+    renderer_tests.add_test("Half Block", test_half_block);
+    renderer_tests.add_test("Braille", test_braille);
+    renderer_tests.add_test("Log Scale", test_log_scale);
+    renderer_tests.add_test("Pooling", test_pooling);
+    renderer_tests.add_test("Color Runs", test_color_runs);
+    renderer_tests.add_test("Color Half Block", test_color_half_block);
+
+    // Run tests
+    renderer_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return renderer_tests.all_passed() ? 0 : 1;
+}
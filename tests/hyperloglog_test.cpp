@@ -0,0 +1,160 @@
+#include "test_framework.hpp"
+#include "../src/hyperloglog.hpp"
+#include "../src/accumulator.hpp"
+#include "../src/heatmap_builder.hpp"
+#include "../src/data_reader.hpp"
+#include <cmath>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+
+using namespace tplt;
+
+// Estimate of n distinct keys starting at first
+static double estimate_of(uint64_t first, uint64_t n) {
+    HyperLogLog hll;
+    for (uint64_t i = first; i < first + n; ++i) {
+        hll.add_hash(mix64(i));
+    }
+    return hll.estimate();
+}
+
+// Test accuracy across cardinalities, from exact-ish small sets to large ones
+bool test_accuracy() {
+    bool result = true;
+    for (uint64_t n : {1ULL, 10ULL, 100ULL, 1000ULL, 20000ULL, 500000ULL}) {
+        double estimate = estimate_of(0, n);
+        // Four standard errors (1.04 / sqrt(m) = 1.6%)
+        double tolerance = std::max(1.0, 4 * 0.0163 * n);
+        if (std::abs(estimate - n) > tolerance) {
+            std::cout << "n = " << n << ": estimate " << estimate << "\n";
+            result = false;
+        }
+    }
+    return result;
+}
+
+// Test that duplicates don't count and small sets stay sparse
+bool test_sparse_representation() {
+    HyperLogLog hll;
+    bool test1 = test::assert_true(hll.empty());
+
+    for (int repeat = 0; repeat < 10; ++repeat) {
+        for (uint64_t i = 0; i < 50; ++i) hll.add_hash(mix64(i));
+    }
+    bool test2 = test::assert_true(hll.is_sparse());
+    bool test3 = test::assert_true(std::abs(hll.estimate() - 50) < 1.5);
+
+    for (uint64_t i = 50; i < 5000; ++i) hll.add_hash(mix64(i));
+    bool test4 = test::assert_false(hll.is_sparse());
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that merging gives the estimate of the union, in every representation
+bool test_merge() {
+    HyperLogLog small_a, small_b, large_a, large_b, whole;
+    for (uint64_t i = 0; i < 100; ++i) small_a.add_hash(mix64(i));
+    for (uint64_t i = 50; i < 150; ++i) small_b.add_hash(mix64(i));
+    for (uint64_t i = 0; i < 30000; ++i) large_a.add_hash(mix64(i));
+    for (uint64_t i = 20000; i < 60000; ++i) large_b.add_hash(mix64(i));
+    for (uint64_t i = 0; i < 60000; ++i) whole.add_hash(mix64(i));
+
+    small_a.merge(small_b);
+    bool test1 = test::assert_true(small_a.is_sparse());
+    bool test2 = test::assert_true(std::abs(small_a.estimate() - 150) < 3);
+
+    // Sparse into dense, dense into dense
+    large_a.merge(small_a);
+    large_a.merge(large_b);
+    bool test3 = test::assert_equal(large_a.estimate(), whole.estimate());
+
+    // Dense into sparse
+    HyperLogLog tiny;
+    tiny.add_hash(mix64(7));
+    tiny.merge(whole);
+    bool test4 = test::assert_equal(tiny.estimate(), whole.estimate());
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test distinct keys read from text and numeric fields
+bool test_distinct_from_reader() {
+    std::string input =
+        "x,y,user\n"
+        "0,0,alice\n0,0,bob\n0,0,alice\n0,0,\"bob\"\n"
+        "1,1,1\n1,1,1.0\n1,1,+1e0\n1,1,2\n";
+
+    DataReader reader(',');
+    Options options;
+    options.delimiter = ',';
+    options.x_field = FieldSpec("x");
+    options.y_field = FieldSpec("y");
+    options.aggregation = AggregationSpec::parse("distinct(user)");
+
+    HeatmapBinner<DistinctAccumulator> binner(2, 2, 0.0, 1.0, 0.0, 1.0);
+    reader.for_each_point<double>(std::string_view(input), options, [&](const DataPoint<double>& point) {
+        binner.add(point.x, point.y, point.key);
+    });
+
+    auto heatmap = binner.result();
+    bool test1 = test::assert_equal(binner.points(), static_cast<size_t>(8));
+    bool test2 = test::assert_equal(heatmap[0][0], static_cast<int64_t>(2));
+    bool test3 = test::assert_equal(heatmap[1][1], static_cast<int64_t>(2));
+    bool test4 = test::assert_equal(DataReader::field_key("-0"), DataReader::field_key("0"));
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that decoding rejects sparse entries that would index past the
+// registers, carry impossible ranks (0 or too large), or break the sorted order
+bool test_corrupt_sparse() {
+    // A sparse blob of (index, rank) entries
+    auto sparse = [](std::initializer_list<std::pair<uint32_t, uint32_t>> entries) {
+        std::string blob;
+        put_bytes(blob, uint8_t{0});
+        put_bytes(blob, static_cast<uint32_t>(entries.size()));
+        for (auto [index, rank] : entries) put_bytes(blob, (index << 8) | rank);
+        return blob;
+    };
+    auto rejected = [](std::string blob) {
+        std::string_view view = blob;
+        try {
+            HyperLogLog::decode(view);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what()) == "Corrupt distinct counter";
+        }
+        return false;
+    };
+
+    std::string valid = sparse({{3, 1}, {4000, 53}});
+    std::string_view in = valid;
+    bool test1 = test::assert_true(HyperLogLog::decode(in).estimate() > 1.5);
+
+    bool test2 = test::assert_true(rejected(sparse({{4096, 1}})));
+    bool test3 = test::assert_true(rejected(sparse({{7, 54}})));
+    bool test4 = test::assert_true(rejected(sparse({{9, 1}, {5, 1}})));
+    bool test5 = test::assert_true(rejected(sparse({{5, 1}, {5, 2}})));
+    bool test6 = test::assert_true(rejected(sparse({{3, 0}})));
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Main test function
+int main() {
+    test::TestSuite hyperloglog_tests("HyperLogLog Tests");
+
+    // Add test cases
+    hyperloglog_tests.add_test("Accuracy", test_accuracy);
+    hyperloglog_tests.add_test("Sparse Representation", test_sparse_representation);
+    hyperloglog_tests.add_test("Merge", test_merge);
+    hyperloglog_tests.add_test("Distinct From Reader", test_distinct_from_reader);
+    hyperloglog_tests.add_test("Corrupt Sparse", test_corrupt_sparse);
+
+    // Run tests
+    hyperloglog_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return hyperloglog_tests.all_passed() ? 0 : 1;
+}
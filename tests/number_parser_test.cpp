@@ -0,0 +1,110 @@
+#include "test_framework.hpp"
+#include "../src/number_parser.hpp"
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tplt;
+
+// Check that text parses to exactly the expected value
+static bool parses_to(std::string_view text, double expected) {
+    double value = 0;
+    if (parse_double(text, value) != std::errc{}) {
+        std::cout << "Failed to parse '" << text << "'\n";
+        return false;
+    }
+    if (value != expected) {
+        std::cout << "Parsed '" << text << "' as " << value << ", expected " << expected << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Test plain decimals handled by the fast path
+bool test_plain_decimals() {
+    bool test1 = parses_to("0", 0.0);
+    bool test2 = parses_to("42", 42.0);
+    bool test3 = parses_to("-3.25", -3.25);
+    bool test4 = parses_to("+1.5", 1.5);
+    bool test5 = parses_to(".5", 0.5);
+    bool test6 = parses_to("7.", 7.0);
+    bool test7 = parses_to("12345678.87654321", 12345678.87654321);
+    bool test8 = parses_to("1e3", 1000.0);
+    bool test9 = parses_to("2.5E-2", 0.025);
+
+    return test1 && test2 && test3 && test4 && test5 && test6 && test7 && test8 && test9;
+}
+
+// Test inputs that take the from_chars path
+bool test_slow_path() {
+    bool test1 = parses_to("12345678901234567890123", 12345678901234567890123.0);
+    bool test2 = parses_to("1e300", 1e300);
+    bool test3 = parses_to("4.9e-324", 4.9e-324);
+
+    double value = 0;
+    bool test4 = test::assert_true(parse_double("inf", value) == std::errc{} && value > 1e308);
+    bool test5 = test::assert_true(parse_double("1e400", value) == std::errc::result_out_of_range);
+
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that malformed input is reported through error codes
+bool test_invalid_input() {
+    const std::vector<std::string> invalid = {
+        "", "abc", "1.5x", "+-1", "1e", "1e+", "--1", ".", "-", "1,5", " 1"
+    };
+
+    bool result = true;
+    for (const auto& text : invalid) {
+        double value = 0;
+        if (parse_double(text, value) != std::errc::invalid_argument) {
+            std::cout << "Accepted invalid input '" << text << "'\n";
+            result = false;
+        }
+    }
+
+    return result && test::assert_false(is_number("12abc")) && test::assert_true(is_number("-0.5"));
+}
+
+// Test the fast path against strtod on random decimals
+bool test_matches_strtod() {
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<int> digit(0, 9);
+    std::uniform_int_distribution<int> length(1, 18);
+    std::uniform_int_distribution<int> exponent(-30, 30);
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string text = (i % 2) ? "-" : "";
+        int int_digits = length(rng);
+        for (int d = 0; d < int_digits; ++d) text += static_cast<char>('0' + digit(rng));
+        if (i % 3) {
+            text += '.';
+            int frac_digits = length(rng) % (19 - int_digits + 1);
+            for (int d = 0; d < frac_digits; ++d) text += static_cast<char>('0' + digit(rng));
+        }
+        if (i % 5 == 0) text += "e" + std::to_string(exponent(rng));
+
+        double expected = std::strtod(text.c_str(), nullptr);
+        if (!parses_to(text, expected)) return false;
+    }
+
+    return true;
+}
+
+// Main test function
+int main() {
+    test::TestSuite number_parser_tests("NumberParser Tests");
+
+    // Add test cases
+    number_parser_tests.add_test("Plain Decimals", test_plain_decimals);
+    number_parser_tests.add_test("Slow Path", test_slow_path);
+    number_parser_tests.add_test("Invalid Input", test_invalid_input);
+    number_parser_tests.add_test("Matches strtod", test_matches_strtod);
+
+    // Run tests
+    number_parser_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return number_parser_tests.all_passed() ? 0 : 1;
+}
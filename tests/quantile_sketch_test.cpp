@@ -0,0 +1,208 @@
+#include "test_framework.hpp"
+#include "../src/quantile_sketch.hpp"
+#include "../src/accumulator.hpp"
+#include "../src/arg_parser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <limits>
+
+using namespace tplt;
+
+// Check the sketch against exact quantiles of values, within the relative accuracy
+static bool within_accuracy(const QuantileSketch& sketch, std::vector<double> values, double q) {
+    std::sort(values.begin(), values.end());
+    double exact = values[static_cast<size_t>(q * (values.size() - 1))];
+    double estimate = sketch.quantile(q);
+    double tolerance = QuantileSketch::RELATIVE_ACCURACY * std::abs(exact) + 1e-12;
+    if (std::abs(estimate - exact) > tolerance) {
+        std::cout << "p" << q * 100 << ": estimate " << estimate << ", exact " << exact << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Test quantiles of a heavy-tailed latency-like distribution
+bool test_relative_accuracy() {
+    std::mt19937_64 rng(5);
+    std::lognormal_distribution<double> dist(3.0, 1.2);
+    std::vector<double> values(100000);
+    QuantileSketch sketch;
+    for (auto& v : values) {
+        v = dist(rng);
+        sketch.add(v);
+    }
+
+    bool result = test::assert_equal(sketch.count(), static_cast<uint64_t>(values.size()));
+    for (double q : {0.0, 0.1, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+        result = within_accuracy(sketch, values, q) && result;
+    }
+    return result;
+}
+
+// Test negative values, zeros and ignored non-finite input
+bool test_signed_values() {
+    std::vector<double> values;
+    QuantileSketch sketch;
+    for (int i = -500; i <= 500; ++i) {
+        values.push_back(i * 0.25);
+        sketch.add(i * 0.25);
+    }
+    sketch.add(std::nan(""));
+    sketch.add(INFINITY);
+
+    bool result = test::assert_equal(sketch.count(), static_cast<uint64_t>(1001));
+    for (double q : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+        result = within_accuracy(sketch, values, q) && result;
+    }
+    return result;
+}
+
+// Test that merged sketches answer like one sketch over all values
+bool test_merge() {
+    std::mt19937_64 rng(9);
+    std::exponential_distribution<double> dist(0.01);
+
+    QuantileSketch whole, a, b;
+    for (int i = 0; i < 20000; ++i) {
+        double v = dist(rng);
+        whole.add(v);
+        (i % 3 ? a : b).add(v);
+    }
+    a.merge(b);
+
+    bool result = test::assert_equal(a.count(), whole.count());
+    for (double q : {0.01, 0.5, 0.99}) {
+        result = test::assert_equal(a.quantile(q), whole.quantile(q)) && result;
+    }
+    return result;
+}
+
+// Test that memory stays bounded on values spanning a huge range
+bool test_bounded_buckets() {
+    QuantileSketch sketch;
+    for (int e = -300; e <= 300; ++e) {
+        sketch.add(std::pow(10.0, e));
+    }
+
+    // The top of the range is still accurate; the bottom is folded together
+    double top = sketch.quantile(1.0);
+    bool test1 = test::assert_true(std::abs(top - 1e300) <= 0.01 * 1e300);
+    bool test2 = test::assert_true(sketch.quantile(0.0) > 1e-300);
+    return test1 && test2;
+}
+
+// Test parsing of pNN aggregations
+bool test_quantile_spec() {
+    auto p99 = AggregationSpec::parse("p99(f7)");
+    auto p999 = AggregationSpec::parse("P99.9(latency)");
+
+    bool test1 = test::assert_true(p99.function == AggregationSpec::Function::Quantile);
+    bool test2 = test::assert_equal(p99.quantile, 0.99);
+    bool test3 = test::assert_equal(p999.quantile, 0.999);
+    bool test4 = test::assert_equal(p999.field->name, std::string("latency"));
+
+    double median = with_accumulator(AggregateFunc::Quantile, [](auto acc) {
+        auto state = acc.init();
+        for (double v : {1.0, 2.0, 3.0, 100.0, 200.0}) acc.add(state, v);
+        return static_cast<double>(acc.finalize(state));
+    }, 0.5);
+    bool test5 = test::assert_true(std::abs(median - 3.0) <= 0.03);
+
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that decoding rejects sketches whose count disagrees with their buckets
+bool test_corrupt_decode() {
+    QuantileSketch sketch;
+    for (double v : {-2.0, 0.0, 1.0, 5.0, 5.0}) sketch.add(v);
+    std::string bytes;
+    sketch.encode(bytes);
+
+    std::string_view in = bytes;
+    bool test1 = test::assert_equal(QuantileSketch::decode(in).count(), static_cast<uint64_t>(5));
+
+    auto rejected = [](std::string blob) {
+        std::string_view view = blob;
+        try {
+            QuantileSketch::decode(view);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what()) == "Corrupt quantile sketch";
+        }
+        return false;
+    };
+
+    // A count larger than the buckets hold would send quantile() past them
+    std::string inflated;
+    put_bytes(inflated, uint64_t{50});
+    bool test2 = test::assert_true(rejected(inflated + bytes.substr(8)));
+
+    // Bucket counts that only add up after wrapping around are caught too
+    std::string wrapped;
+    put_bytes(wrapped, uint64_t{1});
+    put_bytes(wrapped, uint64_t{0});
+    put_bytes(wrapped, int32_t{0});
+    put_bytes(wrapped, uint32_t{2});
+    put_bytes(wrapped, uint64_t{2});
+    put_bytes(wrapped, ~uint64_t{0});
+    put_bytes(wrapped, int32_t{0});
+    put_bytes(wrapped, uint32_t{0});
+    bool test3 = test::assert_true(rejected(wrapped));
+
+    // Buckets no finite value reaches, where top() would overflow an int32
+    std::string shifted;
+    put_bytes(shifted, uint64_t{1});
+    put_bytes(shifted, uint64_t{0});
+    put_bytes(shifted, std::numeric_limits<int32_t>::max() - 1);
+    put_bytes(shifted, uint32_t{4});
+    for (uint64_t n : {1, 0, 0, 0}) put_bytes(shifted, n);
+    put_bytes(shifted, int32_t{0});
+    put_bytes(shifted, uint32_t{0});
+    bool test4 = test::assert_true(rejected(shifted));
+
+    // The same for an offset below the smallest denormal's bucket
+    std::string sunk;
+    put_bytes(sunk, uint64_t{1});
+    put_bytes(sunk, uint64_t{0});
+    put_bytes(sunk, int32_t{0});
+    put_bytes(sunk, uint32_t{0});
+    put_bytes(sunk, std::numeric_limits<int32_t>::min());
+    put_bytes(sunk, uint32_t{1});
+    put_bytes(sunk, uint64_t{1});
+    bool test5 = test::assert_true(rejected(sunk));
+
+    // Extreme but finite values still round-trip
+    QuantileSketch extremes;
+    for (double v : {std::numeric_limits<double>::max(), std::numeric_limits<double>::denorm_min(),
+                     -std::numeric_limits<double>::max()}) {
+        extremes.add(v);
+    }
+    std::string extreme_bytes;
+    extremes.encode(extreme_bytes);
+    std::string_view extreme_in = extreme_bytes;
+    bool test6 = test::assert_equal(QuantileSketch::decode(extreme_in).count(), static_cast<uint64_t>(3));
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Main test function
+int main() {
+    test::TestSuite quantile_sketch_tests("QuantileSketch Tests");
+
+    // Add test cases
+    quantile_sketch_tests.add_test("Relative Accuracy", test_relative_accuracy);
+    quantile_sketch_tests.add_test("Signed Values", test_signed_values);
+    quantile_sketch_tests.add_test("Merge", test_merge);
+    quantile_sketch_tests.add_test("Bounded Buckets", test_bounded_buckets);
+    quantile_sketch_tests.add_test("Quantile Spec", test_quantile_spec);
+    quantile_sketch_tests.add_test("Corrupt Decode", test_corrupt_decode);
+
+    // Run tests
+    quantile_sketch_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return quantile_sketch_tests.all_passed() ? 0 : 1;
+}
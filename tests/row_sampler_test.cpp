@@ -0,0 +1,134 @@
+#include "test_framework.hpp"
+#include "../src/row_sampler.hpp"
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+using namespace tplt;
+
+// Test that Bernoulli sampling keeps close to rate of the rows, the same
+// rows for the same seed, and different ones for another seed
+bool test_bernoulli() {
+    const uint64_t rows = 1000000;
+    auto kept_rows = [&](uint64_t seed) {
+        RowSampler sampler = RowSampler::bernoulli(0.01, seed);
+        std::vector<uint64_t> kept;
+        for (uint64_t row = 0; row < rows; ++row) {
+            if (sampler.next() != RowSampler::SKIP) kept.push_back(row);
+        }
+        return kept;
+    };
+
+    std::vector<uint64_t> kept = kept_rows(7);
+    // 10000 expected, standard deviation about 100
+    bool test1 = test::assert_true(kept.size() > 9500 && kept.size() < 10500);
+    bool test2 = test::assert_true(kept == kept_rows(7));
+    bool test3 = test::assert_true(kept != kept_rows(8));
+
+    // Kept rows spread over the whole input
+    bool test4 = test::assert_true(kept.front() < 1000 && kept.back() > rows - 1000);
+
+    RowSampler sampler = RowSampler::bernoulli(0.25, 1);
+    bool test5 = test::assert_equal(sampler.scale(), 4.0);
+
+    // A rate of 1 keeps every row
+    RowSampler all = RowSampler::bernoulli(1.0, 1);
+    bool test6 = true;
+    for (int row = 0; row < 100; ++row) test6 = test6 && all.next() == 0;
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Test that a prefix keeps its rows and then stops the read
+bool test_prefix() {
+    RowSampler sampler = RowSampler::prefix(3);
+    bool test1 = test::assert_true(sampler.next() == 0 && sampler.next() == 0 && sampler.next() == 0);
+    bool test2 = test::assert_equal(sampler.next(), RowSampler::STOP);
+    bool test3 = test::assert_equal(sampler.scale(), 1.0);
+    bool test4 = test::assert_equal(sampler.skippable(), static_cast<uint64_t>(0));
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that a reservoir fills its slots in order, then keeps every row with
+// about the same chance and reports how many rows each kept one stands for
+bool test_reservoir() {
+    const uint64_t size = 100;
+    const uint64_t rows = 10000;
+    const int trials = 200;
+
+    // Times each tenth of the input ends up in the reservoir
+    std::vector<double> hits(10, 0.0);
+    bool fills = true;
+    bool in_slots = true;
+    for (int trial = 0; trial < trials; ++trial) {
+        RowSampler sampler = RowSampler::reservoir(size, trial + 1);
+        std::vector<uint64_t> slots(size);
+        for (uint64_t row = 0; row < rows; ++row) {
+            uint64_t slot = sampler.next();
+            if (slot == RowSampler::SKIP) continue;
+            if (row < size) fills = fills && slot == row;
+            in_slots = in_slots && slot < size;
+            if (slot < size) slots[slot] = row;
+        }
+        for (uint64_t row : slots) hits[row * 10 / rows] += 1;
+    }
+    bool test1 = test::assert_true(fills && in_slots);
+
+    // Each tenth expects 2000 hits, standard deviation about 42
+    bool test2 = true;
+    for (double h : hits) test2 = test2 && h > 1800 && h < 2200;
+
+    RowSampler sampler = RowSampler::reservoir(size, 1);
+    for (uint64_t row = 0; row < rows; ++row) sampler.next();
+    bool test3 = test::assert_equal(sampler.scale(), 100.0);
+
+    // Inputs smaller than the reservoir are kept whole
+    RowSampler small = RowSampler::reservoir(size, 1);
+    for (int row = 0; row < 10; ++row) small.next();
+    bool test4 = test::assert_equal(small.scale(), 1.0);
+
+    return test1 && test2 && test3 && test4;
+}
+
+// Test that skipping the skippable rows keeps the same rows as asking
+// about each one
+bool test_skippable() {
+    RowSampler asked = RowSampler::bernoulli(0.05, 3);
+    RowSampler skipped = RowSampler::bernoulli(0.05, 3);
+    std::vector<uint64_t> one_by_one;
+    std::vector<uint64_t> blocks;
+    for (uint64_t row = 0; row < 100000; ++row) {
+        if (asked.next() != RowSampler::SKIP) one_by_one.push_back(row);
+    }
+    while (skipped.rows_seen() < 100000) {
+        uint64_t gap = std::min<uint64_t>(skipped.skippable(), 100000 - skipped.rows_seen());
+        skipped.skip(gap);
+        if (skipped.rows_seen() == 100000) break;
+        uint64_t row = skipped.rows_seen();
+        if (skipped.next() != RowSampler::SKIP) blocks.push_back(row);
+    }
+    bool test1 = test::assert_true(!one_by_one.empty() && one_by_one == blocks);
+
+    // Nothing is skippable while a reservoir fills
+    RowSampler reservoir = RowSampler::reservoir(10, 1);
+    bool test2 = test::assert_equal(reservoir.skippable(), static_cast<uint64_t>(0));
+
+    return test1 && test2;
+}
+
+// Main test function
+int main() {
+    test::TestSuite row_sampler_tests("Row Sampler Tests");
+
+    // Add test cases
+    row_sampler_tests.add_test("Bernoulli", test_bernoulli);
+    row_sampler_tests.add_test("Prefix", test_prefix);
+    row_sampler_tests.add_test("Reservoir", test_reservoir);
+    row_sampler_tests.add_test("Skippable", test_skippable);
+
+    // Run tests
+    row_sampler_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return row_sampler_tests.all_passed() ? 0 : 1;
+}
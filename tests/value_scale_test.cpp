@@ -0,0 +1,87 @@
+#include "test_framework.hpp"
+#include "../src/value_scale.hpp"
+#include <cmath>
+#include <random>
+
+// Test the closed-form scales and their inverses
+bool test_curves() {
+    Grid<double> grid(2, 1);
+    grid(0, 0) = 0;
+    grid(1, 0) = 99;
+
+    ValueScale linear(grid, ScaleMode::Linear);
+    bool test1 = test::assert_true(std::abs(linear.normalize(33) - 1.0 / 3) < 1e-12);
+    ValueScale root(grid, ScaleMode::Sqrt);
+    bool test2 = test::assert_true(std::abs(root.normalize(24.75) - 0.5) < 1e-12);
+    // With zeros, log scales log(1 + v)
+    ValueScale log(grid, ScaleMode::Log);
+    bool test3 = test::assert_true(std::abs(log.normalize(9) - 0.5) < 1e-12);
+
+    // Positive grids use log(v / min)
+    grid(0, 0) = 10;
+    grid(1, 0) = 1000;
+    ValueScale ratio(grid, ScaleMode::Log);
+    bool test4 = test::assert_true(std::abs(ratio.normalize(100) - 0.5) < 1e-12);
+
+    bool round_trips = true;
+    for (const ValueScale* scale : {&linear, &root, &log, &ratio}) {
+        for (double t : {0.0, 0.2, 0.5, 0.9, 1.0}) {
+            round_trips = round_trips && std::abs(scale->normalize(scale->value_at(t)) - t) < 1e-9;
+        }
+    }
+    bool test5 = test::assert_true(round_trips);
+
+    return test1 && test2 && test3 && test4 && test5;
+}
+
+// Test that quantile breakpoints split skewed cells into equal shares
+bool test_quantiles() {
+    // Heavy-tailed cells, as counts of skewed traffic are
+    std::mt19937 rng(5);
+    std::lognormal_distribution<double> skewed(0.0, 2.0);
+    Grid<double> grid(500, 400);
+    for (int y = 0; y < grid.height(); ++y) {
+        for (int x = 0; x < grid.width(); ++x) grid(x, y) = skewed(rng);
+    }
+    grid(0, 0) = 1e7;
+
+    ValueScale scale(grid, ScaleMode::Quantile);
+    bool even = true;
+    for (double t : {0.2, 0.4, 0.6, 0.8}) {
+        double at = scale.value_at(t);
+        size_t below = 0;
+        for (int y = 0; y < grid.height(); ++y) {
+            for (int x = 0; x < grid.width(); ++x) below += grid(x, y) < at;
+        }
+        even = even && std::abs(static_cast<double>(below) / grid.cells() - t) < 0.005;
+    }
+    bool test1 = test::assert_true(even);
+
+    // The median is exp(0) = 1; linearly it would sit at the bottom
+    bool test2 = test::assert_true(std::abs(scale.value_at(0.5) - 1.0) < 0.05);
+    bool test3 = test::assert_true(std::abs(scale.normalize(1.0) - 0.5) < 0.01);
+    bool test4 = test::assert_equal(scale.value_at(0.0), scale.min());
+    bool test5 = test::assert_equal(scale.value_at(1.0), 1e7);
+
+    // Equal cells share an intensity; a constant grid renders at the top
+    Grid<int> flat(3, 3, 7);
+    ValueScale constant(flat, ScaleMode::Quantile);
+    bool test6 = test::assert_true(constant.normalize(7) > 0.99);
+
+    return test1 && test2 && test3 && test4 && test5 && test6;
+}
+
+// Main test function
+int main() {
+    test::TestSuite scale_tests("Value Scale Tests");
+
+    // Add test cases
+    scale_tests.add_test("Curves", test_curves);
+    scale_tests.add_test("Quantiles", test_quantiles);
+
+    // Run tests
+    scale_tests.run();
+
+    // Return 0 if all tests passed, 1 otherwise
+    return scale_tests.all_passed() ? 0 : 1;
+}